@@ -33,6 +33,7 @@ Basic steering macro for running CyMiniAna
 #include <math.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <boost/algorithm/string/join.hpp>
 
@@ -40,10 +41,13 @@ Basic steering macro for running CyMiniAna
 #include "Analysis/CyMiniAna/interface/configuration.h"
 #include "Analysis/CyMiniAna/interface/Event.h"
 #include "Analysis/CyMiniAna/interface/eventSelection.h"
+#include "Analysis/CyMiniAna/interface/selectionEngine.h"
+#include "Analysis/CyMiniAna/interface/regionCategoriser.h"
 #include "Analysis/CyMiniAna/interface/miniTree.h"
 #include "Analysis/CyMiniAna/interface/metadataTree.h"
 #include "Analysis/CyMiniAna/interface/histogrammer.h"
 #include "Analysis/CyMiniAna/interface/efficiency.h"
+#include "Analysis/CyMiniAna/interface/entryListCache.h"
 
 
 int main(int argc, char** argv) {
@@ -55,7 +59,6 @@ int main(int argc, char** argv) {
 
     unsigned long long maxEntriesToRun(0);                           // maximum number of entries in TTree
     unsigned int numberOfEventsToRun(0);                             // number of events to run
-    bool passEvent(false);                                           // event passed selection
 
     // configuration
     configuration config(argv[1]);                                   // configuration file
@@ -77,6 +80,11 @@ int main(int argc, char** argv) {
     bool makeHistograms   = config.makeHistograms();
     bool makeEfficiencies = config.makeEfficiencies();
     bool doSystWeights    = config.calcWeightSystematics();          // systemaics associated with scale factors
+    bool useEntryListCache = (config.entryListCache().size()>0);    // re-use selection results from previous runs
+    bool useQCDRegions    = config.useQCDRegions();                  // categorise events in (n_btag,n_toptag) regions
+
+    if (config.asyncOutput())
+        ROOT::EnableThreadSafety();                                  // output trees are filled on another thread
 
     std::string customDirectory( config.customDirectory() );
     if (customDirectory.length()>0  && customDirectory.substr(0,1).compare("_")!=0){
@@ -84,19 +92,22 @@ int main(int argc, char** argv) {
     }
 
     // event selection(s) -- support for multiple event selections simulataneously
-    std::vector<eventSelection> evtSels;
-    std::vector<unsigned int> ncuts;                         // number of cuts in selection
-    std::vector< std::vector<std::string> > namesOfCuts;     // names of cuts in selection
-    for (unsigned int ss=0, size=selections.size(); ss<size; ss++) {
-        std::string sel      = selections.at(ss);
-        std::string cutsfile = (generateCutsFiles) ? "config/cuts_"+sel+".txt" : cutfiles.at(ss);
+    // -- evaluated together: shared cuts are only calculated once per event
+    std::vector<std::string> selectionCutsfiles;
+    for (const auto& sel : selections)
+        selectionCutsfiles.push_back( (generateCutsFiles) ? "config/cuts_"+sel+".txt" : cutfiles.at(selectionCutsfiles.size()) );
+
+    selectionEngine evtSelEngine( config );
+    evtSelEngine.initialize( selections, selectionCutsfiles );
+    std::vector<eventSelection>& evtSels = evtSelEngine.selections();
 
-        eventSelection evtSel_tmp( config );
-        evtSel_tmp.initialize( sel, cutsfile );
+    regionCategoriser qcdRegions( config );                  // QCD/ABCD regions of the selected events
 
-        evtSels.push_back(evtSel_tmp);
-        ncuts.push_back(evtSel_tmp.numberOfCuts());
-        namesOfCuts.push_back( evtSel_tmp.cutNames() );
+    std::vector<unsigned int> ncuts;                         // number of cuts in selection
+    std::vector< std::vector<std::string> > namesOfCuts;     // names of cuts in selection
+    for (auto& evtSel : evtSels) {
+        ncuts.push_back(evtSel.numberOfCuts());
+        namesOfCuts.push_back( evtSel.cutNames() );
     }
 
 
@@ -136,6 +147,8 @@ int main(int argc, char** argv) {
 
         std::string fullOutputFilename = outpath+"/"+outputFilename+".root";
         std::unique_ptr<TFile> outputFile(TFile::Open( fullOutputFilename.c_str(), "RECREATE"));
+        if (config.compressionSettings()>=0)
+            outputFile->SetCompressionSettings( config.compressionSettings() );
         cma::INFO("RUN :   >> Saving to "+fullOutputFilename);
 
         // Inspecting the file
@@ -179,7 +192,9 @@ int main(int argc, char** argv) {
         if (makeEfficiencies)
             effMaker.bookEffs( *outputFile );
 
-        for (auto& x : evtSels) x.setCutflowHistograms( *outputFile );  // setup cutflow histograms
+        evtSelEngine.setCutflowHistograms( *outputFile );  // setup cutflow histograms
+        if (useQCDRegions)
+            qcdRegions.setCutflowHistograms( *outputFile );
 
         // -- Loop over treenames -> usually only one tree
         for (const auto& treename : treenames) {
@@ -194,6 +209,7 @@ int main(int argc, char** argv) {
             // -- Load TTree to loop over
             cma::INFO("RUN :      TTree "+treename);
             TTreeReader myReader(treename.c_str(), file);
+            config.setTreename( treename );
 
             // -- Make new Tree in Root file
             miniTree miniTTree(config);          // initialize TTree for new file
@@ -206,7 +222,7 @@ int main(int argc, char** argv) {
                     subdir = treename.substr(0,found);
                     if (!outputFile->GetDirectory(subdir.c_str())) gDirectory->mkdir(subdir.c_str());
                 }
-                miniTTree.initialize( myReader.GetTree(), *outputFile, subdir );
+                miniTTree.initialize( *outputFile, subdir );
             }
 
             // -- Number of Entries to Process -- //
@@ -217,16 +233,25 @@ int main(int argc, char** argv) {
             numberOfEventsToRun = (nEvents<0 || ((unsigned int)nEvents+firstEvent)>maxEntriesToRun) ? maxEntriesToRun - firstEvent : nEvents;
             cma::INFO("RUN :      Processing "+std::to_string(numberOfEventsToRun)+" events ");
 
+            // -- Cached selection results: only process entries that passed before
+            entryListCache entryCache(config);
+            bool cachedEntries(false);
+            if (useEntryListCache)
+                cachedEntries = entryCache.initialize( *file, evtSels );
+
             // -- Event Loop -- //
             Long64_t imod = 1;                     // print to the terminal
             Event event = Event(myReader, config);
 
             Long64_t eventCounter = 0;    // counting the events processed
             Long64_t entry = firstEvent;  // start at a different event!
-            while (myReader.Next()) {
+            while ( (cachedEntries) ? entryCache.next(myReader) : myReader.Next() ) {
+
+                if (cachedEntries)
+                    entry = firstEvent + myReader.GetCurrentEntry();
 
                 // Check number of events processed against number of events to run
-                if (eventCounter+1 > numberOfEventsToRun){
+                if (!cachedEntries && eventCounter+1 > numberOfEventsToRun){
                     cma::INFO("RUN :      Processed the desired number of events: "+std::to_string(eventCounter)+"/"+std::to_string(numberOfEventsToRun));
                     break;
                 }
@@ -240,28 +265,26 @@ int main(int argc, char** argv) {
                 // -- Build Event -- //
                 cma::DEBUG("RUN : Execute event");
                 event.execute(entry);
-                // now we have event object that has the event-level objects in it
-                // pass this to the selection tools
+                // now we have event object with the filters & triggers decoded -- the physics
+                // objects are built by the selection tools when a cut needs them
 
                 // -- Event Selection -- //
                 // can do separate cutflows by creating multiple instances of eventSelection()
                 cma::DEBUG("RUN : Apply event selection");
-                std::vector<unsigned int> passEvents;
-                unsigned int passedEvents(0);
-                for (unsigned int ss=0,size=selections.size();ss<size;ss++){
-                    passEvent = evtSels.at(ss).applySelection(event);
-                    passEvents.push_back( passEvent );
-                    passedEvents += passEvent;
-                }
+                unsigned int passEvents = evtSelEngine.execute(event);   // bit 'ss' = selection 'ss' passed
+                if (useEntryListCache) entryCache.fill( myReader.GetCurrentEntry(), passEvents );
 
-                if (passedEvents>0){
+                if (passEvents>0){
                     // at least 1 selection passed
                     // share information on which selection passed in case these classes
                     // want to use that information, e.g., special branch or histogram name
                     cma::DEBUG("RUN : Passed selection, now reconstruct ttbar & save information");
+                    event.buildObjects();     // if the cuts didn't need them
+
+                    int region = (useQCDRegions) ? qcdRegions.execute(event,passEvents) : -1;
 
                     if (makeTTree)        miniTTree.saveEvent(event,passEvents);
-                    if (makeHistograms)   histMaker.fill(event,passEvents);
+                    if (makeHistograms)   histMaker.fill(event,passEvents,region);
                     if (makeEfficiencies) effMaker.fill(event,passEvents);
                 }
 
@@ -270,12 +293,17 @@ int main(int argc, char** argv) {
                 ++eventCounter;
             } // end event loop
 
+            if (useEntryListCache) entryCache.finalize( evtSels );
+
             event.finalize();
             miniTTree.finalize();
         } // end tree loop
 
-        // put overflow/underflow content into the first and last bins
-        histMaker.overUnderFlow();
+        // make the ROOT histograms (histograms with over/underflow in the last/first bins, cutflows, efficiencies)
+        histMaker.finalize( *outputFile );
+        evtSelEngine.finalizeCutflowHistograms( *outputFile );
+        if (makeEfficiencies)
+            effMaker.finalize( *outputFile );
 
         cma::INFO("RUN :   END Running  "+filename);
         cma::INFO("RUN :   >> Output at "+fullOutputFilename);
@@ -288,11 +316,13 @@ int main(int argc, char** argv) {
         file = ((TFile *)0);  // (no errors for too many root files open)
     } // end file loop
 
-    for (auto& evtSel : evtSels)
-        evtSel.finalize();
-    evtSels.clear();
+    evtSelEngine.finalize();
 
     cma::INFO("RUN : *** End of file loop *** ");
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF,&usage)==0)
+        cma::INFO("RUN : Peak memory (RSS) "+std::to_string(usage.ru_maxrss/1024)+" MB");
 }
 
 // THE END
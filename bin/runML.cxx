@@ -37,6 +37,7 @@ Basic steering macro for running CyMiniAna
 #include "Analysis/CyMiniAna/interface/configuration.h"
 #include "Analysis/CyMiniAna/interface/Event.h"
 #include "Analysis/CyMiniAna/interface/eventSelection.h"
+#include "Analysis/CyMiniAna/interface/selectionEngine.h"
 #include "Analysis/CyMiniAna/interface/flatTree4ML.h"
 #include "Analysis/CyMiniAna/interface/tools.h"
 #include "Analysis/CyMiniAna/interface/histogrammer4ML.h"
@@ -69,25 +70,28 @@ int main(int argc, char** argv) {
     bool generateCutsFiles = (cutfiles.size()!=selections.size());   // user did not provide different cuts files
     std::string treename( treenames.at(0) );
 
+    if (config.asyncOutput())
+        ROOT::EnableThreadSafety();                                  // output trees are filled on another thread
+
     std::string customDirectory( config.customDirectory() );
     if (customDirectory.length()>0  && customDirectory.substr(0,1).compare("_")!=0){
         customDirectory = "_"+customDirectory; // add '_' to beginning of string, if needed
     }
 
     // event selection(s) -- support for multiple event selections simulataneously
-    std::vector<eventSelection> evtSels;
-    std::vector<unsigned int> ncuts;                         // number of cuts in selection
-    std::vector< std::vector<std::string> > namesOfCuts;     // names of cuts in selection
-    for (unsigned int ss=0, size=selections.size(); ss<size; ss++) {
-        std::string sel      = selections.at(ss);
-        std::string cutsfile = (generateCutsFiles) ? "config/cuts_"+sel+".txt" : cutfiles.at(ss);
+    // -- evaluated together: shared cuts are only calculated once per event
+    std::vector<std::string> selectionCutsfiles;
+    for (const auto& sel : selections)
+        selectionCutsfiles.push_back( (generateCutsFiles) ? "config/cuts_"+sel+".txt" : cutfiles.at(selectionCutsfiles.size()) );
 
-        eventSelection evtSel_tmp( config );
-        evtSel_tmp.initialize( sel, cutsfile );
+    selectionEngine evtSelEngine( config );
+    evtSelEngine.initialize( selections, selectionCutsfiles );
 
-        evtSels.push_back(evtSel_tmp);
-        ncuts.push_back(evtSel_tmp.numberOfCuts());
-        namesOfCuts.push_back( evtSel_tmp.cutNames() );
+    std::vector<unsigned int> ncuts;                         // number of cuts in selection
+    std::vector< std::vector<std::string> > namesOfCuts;     // names of cuts in selection
+    for (auto& evtSel : evtSelEngine.selections()) {
+        ncuts.push_back(evtSel.numberOfCuts());
+        namesOfCuts.push_back( evtSel.cutNames() );
     }
 
 
@@ -140,12 +144,14 @@ int main(int argc, char** argv) {
 
         std::string fullOutputFilename = outpath+"/"+outputFilename+".root";
         std::unique_ptr<TFile> outputFile(TFile::Open( fullOutputFilename.c_str(), "RECREATE"));
+        if (config.compressionSettings()>=0)
+            outputFile->SetCompressionSettings( config.compressionSettings() );
         cma::INFO("RUNML :   >> Saving to "+fullOutputFilename);
 
         histogrammer4ML histMaker(config,"ML");      // initialize histogrammer
         histMaker.initialize( *outputFile );
 
-        for (auto& x : evtSels) x.setCutflowHistograms( *outputFile );  // setup cutflow histograms
+        evtSelEngine.setCutflowHistograms( *outputFile );  // setup cutflow histograms
 
         // check that the ttree exists in this file before proceeding
         if (std::find(fileKeys.begin(), fileKeys.end(), treename) == fileKeys.end()){
@@ -194,23 +200,18 @@ int main(int argc, char** argv) {
             // -- Build Event -- //
             cma::DEBUG("RUNML : Execute event");
             event.execute(entry);
-            // now we have event object that has the event-level objects in it
-            // pass this to the selection tools
+            // now we have event object with the filters & triggers decoded -- the physics
+            // objects are built by the selection tools when a cut needs them
 
             // -- Event Selection -- //
             // can do separate cutflows by creating multiple instances of eventSelection()
             cma::DEBUG("RUNML : Apply event selection");
-            std::vector<unsigned int> passEvents;
-            unsigned int passedEvents(0);
-            for (unsigned int ss=0,size=selections.size();ss<size;ss++){
-                bool passEvent = evtSels.at(ss).applySelection(event);
-                cma::DEBUG("RUNML : Event selection "+selections.at(ss)+" = "+std::to_string(passEvent));
-                passEvents.push_back( passEvent );
-                passedEvents += passEvent;
-            }
+            unsigned int passEvents = evtSelEngine.execute(event);   // bit 'ss' = selection 'ss' passed
+            cma::DEBUG("RUNML : Event selection decisions = "+std::to_string(passEvents));
 
-            if (passedEvents>0){
+            if (passEvents>0){
                 cma::DEBUG("RUNML : Passed selection, now save information");
+                event.buildObjects();     // if the cuts didn't need them
                 std::map<std::string,double> features2save;        // save features related to neutrino pz
 
 
@@ -239,8 +240,9 @@ int main(int argc, char** argv) {
         event.finalize();
         miniTTree.finalize();
 
-        // put overflow/underflow content into the first and last bins
-        histMaker.overUnderFlow();
+        // make the ROOT histograms (histograms with over/underflow in the last/first bins, cutflows)
+        histMaker.finalize( *outputFile );
+        evtSelEngine.finalizeCutflowHistograms( *outputFile );
 
         cma::INFO("RUNML :   END Running  "+filename);
         cma::INFO("RUNML :   >> Output at "+fullOutputFilename);
@@ -3,8 +3,13 @@
 
 #include <vector>
 #include <iostream>
+#include <map>
+#include <string>
+#include <algorithm>
 
 #include "TROOT.h"
+#include "TFile.h"
+#include "TH2.h"
 #include "TLorentzVector.h"
 
 #include "FWCore/Framework/interface/Event.h"
@@ -14,28 +19,72 @@
 #include "CondFormats/BTauObjects/interface/BTagCalibration.h"
 #include "CondTools/BTau/interface/BTagCalibrationReader.h"
 
+#include "Analysis/CyMiniAna/interface/tools.h"
 #include "Analysis/CyMiniAna/interface/physicsObjects.h"
 
+// b-tagging SF of a jet & its uncertainty
+struct BTagSF {
+    double central;
+    double up;
+    double down;
+};
+
 // BTagTools Class
 class BTagTools {
   public:
     // Constructor
-    explicit BTagTools(const bool& isBoosted=false, const std::string& data_path="data/");
+    //  efficiency_file: MC b-tagging efficiencies for getBTagSF() ("" = none), TH2 "<flavor>_<WP>"
+    //  (flavor = b, c, udsg; WP = L, M, T) in pT (x) & eta or |eta| (y)
+    explicit BTagTools(const bool& isBoosted=false, const std::string& data_path="data/",
+                       const std::string& efficiency_file="");
 
     // Destructor
     virtual ~BTagTools();
 
+    enum WorkingPoint {kLoose=0,kMedium,kTight,kNWPs};       // same order as BTagEntry::OperatingPoint
+
     std::map<std::string,double> execute(const Jet& jet) const;
-    float getBTagSF(const std::vector<Jet>& jets) const;
+    void execute(const std::vector<Jet>& jets, std::vector<BTagSF>& SFs, const WorkingPoint wp=kLoose) const;   // all jets of the event
+    BTagSF getBTagSF(const std::vector<Jet>& jets) const;    // event weight (method 1a) & its up/down variations
 
   private:
 
+    // SFs tabulated on a fine (eta,pT) grid when the tool is created:
+    // linear interpolation in pT inside the pT bins of the calibration
+    // (jumps at the bin edges are kept), eta bins of the calibration
+    static const unsigned int kNFlavors = 3;         // BTagEntry::JetFlavor
+    static const unsigned int kNSysts   = 3;         // central, up, down
+    struct SFTable {
+        bool absEta;
+        std::vector<float> etaEdges;
+        std::vector<float> ptNodes;                   // cell i = (ptNodes[i],ptNodes[i+1]]
+        std::vector<float> ptMin;                     // pT range of each eta bin
+        std::vector<float> ptMax;
+        std::vector<double> values;                   // [eta bin][cell][syst][value at ptNodes[i], slope]
+    };
+
+    // MC b-tagging efficiencies (TH2 copied into a flat table when the tool is created)
+    struct EfficiencyMap {
+        bool absEta;
+        std::vector<double> ptEdges;
+        std::vector<double> etaEdges;
+        std::vector<float> values;                    // [pT bin][eta bin]
+    };
+
+    BTagEntry::JetFlavor flavor(const Jet& jet) const;
+    void tabulate(const WorkingPoint wp, const BTagEntry::JetFlavor flavor, const std::string& measurement_type);
+    void validate();
+    BTagSF lookup(const WorkingPoint wp, const BTagEntry::JetFlavor flavor, const float eta, const float pt) const;
+    void loadEfficiencies(const std::string& efficiency_file);
+    void orderEfficiencies();
+    double efficiency(const WorkingPoint wp, const BTagEntry::JetFlavor flavor, const float eta, const float pt) const;
+
     // b-tagging SF
-    // setup calibration + reader
-    BTagCalibration *m_calib;             // ("CSVv2", ".csv");
-    BTagCalibrationReader *m_btag_reader; //(BTagEntry::OP_LOOSE,  // operating point
-                                          //"central",            // central sys type
-                                          //{"up", "down"});      // other sys types
+    // setup calibration + reader (one for each WP)
+    BTagCalibration *m_calib;                             // ("CSVv2", ".csv");
+    BTagCalibrationReader *m_btag_readers[kNWPs];         //(BTagEntry::OP_LOOSE,  // operating point
+                                                          //"central",            // central sys type
+                                                          //{"up", "down"});      // other sys types
 
     bool m_isBoosted;        // Boosted or AK4 jet scenarios
     std::string m_data_path; // where CSV files are stored
@@ -44,6 +93,18 @@ class BTagTools {
     float m_CSVv2L=0.5426;
     float m_CSVv2M=0.8484;
     float m_CSVv2T=0.9535;
+
+    float m_discriminant[kNWPs];
+
+    SFTable m_tables[kNWPs][kNFlavors];
+    std::vector<std::string> m_systs;
+    bool m_useTable;         // false if the tables don't agree with the reader
+    float m_ptStep;          // largest cell in pT [GeV]
+    double m_tolerance;      // largest difference to the reader
+
+    EfficiencyMap m_efficiencies[kNWPs][kNFlavors];
+    bool m_useWP[kNWPs];     // WPs with SFs & efficiencies (used in getBTagSF)
+    double m_minEfficiency;  // efficiencies are kept in [min, 1-min] & decrease from the loose to the tight WP
 };
 
 #endif
@@ -32,7 +32,10 @@
 #include "Analysis/CyMiniAna/interface/truthMatching.h"
 #include "Analysis/CyMiniAna/interface/deepLearning.h"
 #include "Analysis/CyMiniAna/interface/neutrinoReco.h"
+#include "Analysis/CyMiniAna/interface/kinematicFit.h"
+#include "Analysis/CyMiniAna/interface/dileptonTtbarReco.h"
 #include "Analysis/CyMiniAna/interface/wprimeReco.h"
+#include "Analysis/CyMiniAna/interface/BTagTools.h"
 
 
 // Event Class
@@ -52,10 +55,15 @@ class Event {
     // check during looping over truth events, if reco event match is found
     bool isValidRecoEntry() const {return (m_entry > (long long)-1);}
 
-    // Execute the event (load information and setup objects)
+    // Execute the event (load information, decode filters & triggers)
     virtual void execute(Long64_t entry);
     virtual void updateEntry(Long64_t entry);
 
+    // Setup objects, weights & reconstruction -- only when they are needed
+    // (by the event selection, or for events that pass it); once per event
+    void buildObjects();
+    void buildWeights();                    // only needs the jets for the b-tagging weight
+
     // Setup physics information
     void initialize_leptons();
     void initialize_neutrinos();
@@ -64,16 +72,19 @@ class Event {
     void initialize_eventWeights();
     void initialize_weights();
     void initialize_kinematics();
-    void initialize_truth();
+    void initialize_truth() const;
     void initialize_filters();
     void initialize_triggers();
 
     virtual double getSystEventWeight(const std::string &syst, const int weightIndex=-1);
+    virtual const std::vector<double>& systEventWeights();   // all weight systematics (order of the histogram weight variations)
 
     // Clear stuff;
     virtual void finalize();
     virtual void clear();
 
+    static unsigned int definitionsVersion();   // version of the object definitions (bump when they change)
+
     // Get physics information
     std::vector<Lepton> leptons() const {return m_leptons;}
     std::vector<Muon> muons() const {return m_muons;}
@@ -85,13 +96,22 @@ class Event {
     Wprime wprime_sampling() const {return m_wprime_smp;}
 
     // Get truth physics information 
+    // (the partons & truth W' are decoded the first time they are needed in an event)
     void truth();
     std::vector<Lepton> truth_leptons() const {return m_truth_leptons;}
     std::vector<Neutrino> truth_neutrinos() const {return m_truth_neutrinos;}
     std::vector<Ljet> truth_ljets() const {return m_truth_ljets;}
     std::vector<Jet>  truth_jets() const {return m_truth_jets;}
-    std::vector<Parton> truth_partons() const {return m_truth_partons;}
-    TruthWprime truth_wprime() const {return m_truth_wprime;}
+    const std::vector<Parton>& truth_partons() const {if (!m_truthDecoded) initialize_truth(); return m_truth_partons;}
+    TruthWprime truth_wprime() const {if (!m_truthDecoded) initialize_truth(); return m_truth_wprime;}
+
+    // raw generator record -- navigate decay chains without building the partons
+    const std::vector<int>& truth_pdgId() const {return **m_mc_pdgId;}
+    const std::vector<int>& truth_parent_idx() const {return **m_mc_parent_idx;}
+    const std::vector<int>& truth_child0_idx() const {return **m_mc_child0_idx;}
+    const std::vector<int>& truth_child1_idx() const {return **m_mc_child1_idx;}
+    Parton truth_parton(const unsigned int index) const;   // one particle of the generator record
+    const TruthDecayGraph& truth_graph() const;            // decays in the generator record (indices)
 
     virtual MET met() const {return m_met;}
     virtual float HT() const {return m_HT;}
@@ -125,7 +145,10 @@ class Event {
     float truth_weight_mc();
     float weight_pileup();
     float weight_lept_eff();
-    float weight_btag() const {return m_weight_btag_default;}
+    float weight_btag() const {return m_weightComponents[kCompBTag];}
+    float weight_btag_UP() const {return m_weight_btag_UP;}
+    float weight_btag_DOWN() const {return m_weight_btag_DOWN;}
+    double normalization() const {return m_normalization;}   // xsection*kfactor*lumi/sumOfWeights
     float weight_btag(const std::string &wkpt);
 
     // Get weight systematics
@@ -151,6 +174,9 @@ class Event {
     bool m_useLeptons;
     bool m_useNeutrinos;
     bool m_neutrinoReco;
+    bool m_kinematicFit;        // 2nd neutrino (pz_sampling) from the kinematic fit instead of sampling
+    bool m_kinematicFitMinuit;  // ... minimized with TMinuit
+    bool m_dileptonReco;        // both neutrinos from the dilepton ttbar solver (events with 2 leptons)
     bool m_useWprime;
     bool m_wprimeReco;
     bool m_DNNinference;
@@ -166,6 +192,12 @@ class Event {
     double m_kfactor;
     double m_sumOfWeights;
     double m_LUMI;
+    double m_normalization;             // xsection*kfactor*lumi/sumOfWeights -- constant for the file
+
+    // per-event factors of the event weights (set in initialize_weights)
+    enum WeightComponent {kCompMC=0,kCompPileup,kCompLeptonSF,kCompBTag,kNumberOfWeightComponents};
+    double m_weightComponents[kNumberOfWeightComponents];
+    double sampleNormalization( const Sample& sample );
     std::map<int, float> m_mapXSection; // map DSID to XSection
     std::map<int, float> m_mapKFactor;  // map DSID to KFactor
     std::map<int, float> m_mapAMI;      // map DSID to sum of weights
@@ -183,12 +215,14 @@ class Event {
     Wprime m_wprime_smp;
 
     // truth physics object information
-    std::vector<Parton> m_truth_partons;
+    mutable bool m_truthDecoded;                 // m_truth_partons & m_truth_wprime are for this event
+    mutable bool m_truthGraphBuilt;              // truth decay graph is for this event
+    mutable std::vector<Parton> m_truth_partons;
     std::vector<Lepton> m_truth_leptons;
     std::vector<Neutrino> m_truth_neutrinos;
     std::vector<Ljet> m_truth_ljets;
     std::vector<Jet>  m_truth_jets;
-    TruthWprime m_truth_wprime;
+    mutable TruthWprime m_truth_wprime;
 
     // b-tagged calo jets with various WP
     std::map<std::string, std::vector<int> > m_btag_jets;
@@ -208,15 +242,35 @@ class Event {
 
     // nominal b-tagging weight maps
     std::map<std::string, float> m_weight_btag;
-    float m_weight_btag_default;
+    bool m_calcBTagSF;                  // b-tagging event weight from BTagTools (MC efficiencies given)
+    double m_weight_btag_UP;            // variations of m_weightComponents[kCompBTag]
+    double m_weight_btag_DOWN;
     // Maps to keep track of weight systematics
     std::map<std::string,TTreeReaderValue<float> * > m_weightSystematicsFloats;
     std::map<std::string,TTreeReaderValue<std::vector<float>> * > m_weightSystematicsVectorFloats;
     std::vector<std::string> m_listOfWeightSystematics;
 
+    // Weight systematics resolved once (initialize_eventWeights) -- no string matching per event
+    // order: configuration::listOfWeightSystematics, then each component of mapOfWeightVectorSystematics
+    enum WeightSystematicType {kWeightPileup=0,kWeightLeptonSF,kWeightBTagSF,kWeightUnknown,kNumberOfWeightTypes};
+    struct WeightSystematic{
+        unsigned int type;                   // WeightSystematicType (from the name)
+        TTreeReaderValue<float>* value;      // scale factor of this variation (nullptr = 1)
+        const double* factor;                // ... calculated in the event (nullptr = 1)
+    };
+    std::vector<WeightSystematic> m_weightSystematics;
+    std::map<std::string,unsigned int> m_mapOfWeightSystematics;   // name ("<component>_<name>" for vectors) -> index
+    std::vector<double> m_systWeights;       // this event
+    bool m_systWeightsValid;
+    bool m_objectsBuilt;                     // buildObjects() was called for this event
+    bool m_weightsBuilt;                     // buildWeights() was called for this event
+
     // External tools
     NeutrinoReco* m_neutrinoRecoTool;
+    KinematicFit* m_kinematicFitTool;
+    DileptonTtbarReco* m_dileptonRecoTool;
     WprimeReco* m_wprimeTool;
+    BTagTools* m_BTagTool;
     DeepLearning* m_deepLearningTool;
     truthMatching* m_truthMatchingTool;
 
@@ -341,6 +395,7 @@ class Event {
     TTreeReaderValue<std::vector<float>> * m_jet_area;
     TTreeReaderValue<std::vector<float>> * m_jet_uncorrPt;
     TTreeReaderValue<std::vector<float>> * m_jet_uncorrE;
+    TTreeReaderValue<std::vector<int>> * m_jet_hadronFlavour;
 
 
     // Truth jet info
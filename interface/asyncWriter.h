@@ -0,0 +1,88 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+/*
+   Hand entries to a dedicated output thread through a bounded queue.
+   - One consumer, first-in-first-out: the output thread sees the entries
+     in the same order as the event loop pushed them (deterministic output)
+   - push() only blocks when the queue is full
+*/
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+template<typename T>
+class asyncWriter {
+  public:
+    explicit asyncWriter(const unsigned int capacity=1000) :
+      m_capacity(capacity>0 ? capacity : 1),
+      m_running(false){}
+
+    ~asyncWriter(){ stop(); }
+
+    void start(std::function<void(T&)> write){
+        /* Launch the output thread; 'write' is called for every entry (on the output thread) */
+        m_write   = write;
+        m_running = true;
+        m_thread  = std::thread( &asyncWriter<T>::run, this );
+        return;
+    }
+
+    void push(T entry){
+        /* Add an entry to the queue (wait for space if the output thread is behind) */
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait( lock, [this]{ return m_queue.size()<m_capacity; } );
+        m_queue.push_back( std::move(entry) );
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return;
+    }
+
+    void stop(){
+        /* Write the remaining entries and join the output thread */
+        if (!m_running) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_notEmpty.notify_one();
+        m_thread.join();
+        return;
+    }
+
+    bool running() const {return m_running;}
+
+  protected:
+
+    void run(){
+        /* Output thread: drain the queue until stop() is called and the queue is empty */
+        while (true){
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notEmpty.wait( lock, [this]{ return !m_queue.empty() || !m_running; } );
+            if (m_queue.empty()) break;        // stopped and nothing left
+
+            T entry = std::move( m_queue.front() );
+            m_queue.pop_front();
+            lock.unlock();
+            m_notFull.notify_one();
+
+            m_write(entry);
+        }
+        return;
+    }
+
+    unsigned int m_capacity;
+    bool m_running;
+
+    std::deque<T> m_queue;
+    std::function<void(T&)> m_write;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+};
+
+#endif
@@ -48,6 +48,7 @@ class configuration {
 
     std::string jet_btagWkpt() {return m_jet_btag_wkpt;}
     std::vector<std::string> btagWkpts() {return m_btag_WPs;}
+    std::string btagEfficiencies() {return m_btagEfficiencies;}   // MC b-tagging efficiencies for the b-tag weight ("" = no weight)
     float cMVAv2L() {return m_cMVAv2L;}
     float cMVAv2M() {return m_cMVAv2M;}
     float cMVAv2T() {return m_cMVAv2T;}
@@ -80,6 +81,9 @@ class configuration {
     std::string verboseLevel() {return m_verboseLevel;}
     std::vector<std::string> selections() {return m_selections;}
     std::vector<std::string> cutsfiles() {return m_cutsfiles;}
+    unsigned int cutOrderWarmup() {return m_cutOrderWarmup;}      // events used to order the cuts (0 = order of cuts file)
+    bool useQCDRegions() {return m_useQCDRegions;}                // categorise selected events in (n_btag,n_toptag)
+    std::vector<std::string> qcdSelections() {return m_qcdSelections;}
     std::string outputFilePath() {return m_outputFilePath;}
     std::string customDirectory() {return m_customDirectory;}
     std::string configFileName() {return m_configFile;}
@@ -89,6 +93,18 @@ class configuration {
     bool makeTTree() {return m_makeTTree;}
     bool makeHistograms() {return m_makeHistograms;}
     bool makeEfficiencies() {return m_makeEfficiencies;}
+    unsigned int sparseHistogramBins() {return m_sparseHistogramBins;}   // histograms with more bins are allocated in blocks (0 = never)
+    std::string histogramsFile() {return m_histogramsFile;}              // histogram definitions ("" = built-in histograms)
+    std::vector<std::string> branchSlimming() {return m_branchSlimming;}   // "keep/drop <pattern>" for skims
+
+    // output file/tree tuning
+    int compressionSettings() {return m_compressionSettings;}   // 100*algorithm + level (TFile::SetCompressionSettings), -1 = ROOT default
+    int basketSize() {return m_basketSize;}                      // 0 = keep the default basket size
+    long long autoFlush() {return m_autoFlush;}                  // 0 = keep the default cluster size
+    bool asyncOutput() {return m_asyncOutput;}                   // fill output trees on a separate thread
+    unsigned int outputQueueSize() {return m_outputQueueSize;}   // max. entries waiting for the output thread
+    std::string entryListCache() {return m_entryListCache;}      // directory for cached selection results ("" = off)
+    std::map<std::string,std::string> configOptions() {return m_map_config;}
 
     // information for event weights
     std::string metadataFile() {return m_metadataFile;}
@@ -121,11 +137,29 @@ class configuration {
 
     // reconstruction techniques
     bool neutrinoReco(){ return m_neutrinoReco;}
+    std::string neutrinoRecoMethod(){ return m_neutrinoRecoMethod;}      // 2nd neutrino: 'sampling', 'kinfit', or 'minuit'
+    float kinfitVLQMass(){ return m_kinfitVLQMass;}                      // VLQ mass hypothesis in the kinematic fit (0 = none)
+    bool dileptonReco(){ return m_dileptonReco;}                         // two neutrinos in events with 2 leptons
+    unsigned int dileptonSmearings(){ return m_dileptonSmearings;}       // smearings averaged in the dilepton reconstruction
     bool wprimeReco(){ return m_wprimeReco;}
+    unsigned int wprimeRecoMaxJets(){ return m_wprimeRecoMaxJets;}          // jets in the W' combinatorics (0 = leading b-tags only)
+    float wprimeRecoMaxAsymmetry(){ return m_wprimeRecoMaxAsymmetry;}      // max. |energy asymmetry| of W' hypotheses
 
   protected:
 
     void check_btag_WP(const std::string &wkpt);
+    void set_compression(const std::string &algorithm, const int level);
+
+    // numerical option -- exit with an error if the value is not a number
+    template<typename T> T getConfigNumber( const std::string& item ){
+        T number(0);
+        std::string value = getConfigOption(item);
+        if (!cma::str2number(value,number)){
+            cma::ERROR("CONFIG : Option '"+item+" "+value+"' in "+m_configFile+" is not a number");
+            exit(EXIT_FAILURE);
+        }
+        return number;
+    }
 
     std::map<std::string,std::string> m_map_config;
     const std::string m_configFile;
@@ -158,6 +192,8 @@ class configuration {
     std::string m_input_selection;
     std::vector<std::string> m_selections;
     std::vector<std::string> m_cutsfiles;
+    unsigned int m_cutOrderWarmup;
+    bool m_useQCDRegions;
     std::string m_treename;
     std::string m_filename;
     std::string m_primaryDataset;
@@ -170,6 +206,15 @@ class configuration {
     bool m_makeTTree;
     bool m_makeHistograms;
     bool m_makeEfficiencies;
+    unsigned int m_sparseHistogramBins;
+    std::string m_histogramsFile;
+    std::vector<std::string> m_branchSlimming;
+    int m_compressionSettings;
+    int m_basketSize;
+    long long m_autoFlush;
+    bool m_asyncOutput;
+    unsigned int m_outputQueueSize;
+    std::string m_entryListCache;
     std::string m_cma_absPath;
     std::string m_metadataFile;
     bool m_DNNinference;
@@ -182,6 +227,7 @@ class configuration {
     bool m_matchTruthToReco;
 
     std::string m_jet_btag_wkpt;   // "L","M","T"
+    std::string m_btagEfficiencies;
     std::string m_tjet_btag_wkpt;
     std::string m_toptag_wkpt;
 
@@ -230,7 +276,13 @@ class configuration {
     double m_maxDNN  = 1.0;   // max. value in the DNN discriminant
 
     bool m_neutrinoReco;
+    std::string m_neutrinoRecoMethod;
+    float m_kinfitVLQMass;
+    bool m_dileptonReco;
+    unsigned int m_dileptonSmearings;
     bool m_wprimeReco;
+    unsigned int m_wprimeRecoMaxJets;
+    float m_wprimeRecoMaxAsymmetry;
 
     std::map<std::string,std::string> m_defaultConfigs = {
              {"isZeroLeptonAnalysis",  "false"},
@@ -241,12 +293,29 @@ class configuration {
              {"useLargeRJets",         "false"},
              {"useNeutrinos",          "false"},
              {"neutrinoReco",          "false"},
+             {"neutrinoRecoMethod",    "sampling"},
+             {"kinfitVLQMass",         "0"},
+             {"dileptonReco",          "false"},
+             {"dileptonSmearings",     "100"},
              {"useTruth",              "false"},
              {"wprimeReco",            "false"},
+             {"wprimeRecoMaxJets",     "0"},
+             {"wprimeRecoMaxAsymmetry","1.0"},
              {"jet_btag_wkpt",         "M"},
+             {"btagEfficiencies",      ""},
              {"makeTTree",             "false"},
              {"makeHistograms",        "false"},
              {"makeEfficiencies",      "false"},
+             {"sparseHistogramBins",   "100000"},
+             {"histogramsFile",        ""},
+             {"slimmingFile",          ""},
+             {"compressionAlgorithm",  "default"},
+             {"compressionLevel",      "1"},
+             {"basketSize",            "0"},
+             {"autoFlush",             "0"},
+             {"asyncOutput",           "false"},
+             {"outputQueueSize",       "1000"},
+             {"entryListCache",        ""},
              {"NEvents",               "-1"},
              {"firstEvent",            "0"},
              {"isExtendedSample",      "false"},
@@ -258,6 +327,8 @@ class configuration {
              {"weightSystematicsFile",       "config/weightSystematics.txt"},
              {"weightVectorSystematicsFile", "config/weightVectorSystematics.txt"},
              {"cutsfile",              "examples/config/cuts_example.txt"},
+             {"cutOrderWarmup",        "0"},
+             {"useQCDRegions",         "false"},
              {"inputfile",             "examples/config/miniSL_ALLfiles.txt"},
              {"treenames",             "examples/config/treenames_nominal"},
              {"treename",              "tree/eventVars"},
@@ -0,0 +1,74 @@
+#ifndef DILEPTONTTBARRECO_H
+#define DILEPTONTTBARRECO_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <chrono>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/physicsObjects.h"
+
+
+class DileptonTtbarReco {
+  public:
+    DileptonTtbarReco( configuration& cmaConfig );
+
+    ~DileptonTtbarReco();
+
+    // 'jet1' & 'jet2' are the b-jet candidates (both assignments to the top quarks are tested)
+    void setObjects(Lepton& lepton, Lepton& antiLepton, Jet& jet1, Jet& jet2, MET& met);
+
+    bool execute();                   // average of the smeared solutions, false if there is none
+    void summary() const;             // number of events & time per event
+
+    Neutrino neutrino() const {return m_nu;}             // from the top quark (anti-lepton)
+    Neutrino antiNeutrino() const {return m_nubar;}      // from the anti-top quark (lepton)
+    unsigned int nSolutions() const {return m_nSolutions;}   // smearings with a solution
+
+    // Real roots of monic quartics x^4 + c[3]x^3 + c[2]x^2 + c[1]x + c[0] (c = [n][4])
+    // Durand-Kerner iterations for all quartics at once; roots = [n][4], nRoots = [n]
+    static void quarticRoots( const unsigned int n, const double* c, double* roots, unsigned int* nRoots );
+
+  protected:
+
+    struct Conic {
+        // c00 + c10*x + c01*y + c20*x^2 + c11*x*y + c02*y^2 = 0 in (px,py) of the neutrino,
+        // pz = alpha*px + beta*py + gamma, E = (K + u*px + v*py)/E_l
+        double c00, c10, c01, c20, c11, c02;
+        double alpha, beta, gamma;
+        double K, u, v, El;
+        bool valid;
+    };
+
+    Conic topConic( const TLorentzVector& lepton, const TLorentzVector& bjet, const double wmass, const double topmass ) const;
+    bool quartic( const Conic& nu, const Conic& nubar, double* coefficients, double& scale ) const;
+
+    configuration *m_config;
+
+    Lepton m_lepton;
+    Lepton m_antiLepton;
+    Jet m_jet1;
+    Jet m_jet2;
+    MET m_met;
+
+    Neutrino m_nu;
+    Neutrino m_nubar;
+    unsigned int m_nSolutions;
+
+    double m_topMass;
+    double m_wmass;
+    double m_wmassSigma;
+    double m_jetStochastic;           // sigma(E)/E = stochastic/sqrt(E) (+) constant
+    double m_jetConstant;
+    unsigned int m_nSmearings;        // first one is not smeared
+    static const unsigned int m_rootIterations = 60;     // maximum
+
+    // benchmark
+    unsigned long long m_nEvents;
+    unsigned long long m_nReconstructed;
+    double m_time;                    // [us]
+};
+
+#endif
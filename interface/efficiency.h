@@ -18,6 +18,8 @@
 #include "Analysis/CyMiniAna/interface/tools.h"
 #include "Analysis/CyMiniAna/interface/Event.h"
 #include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+#include "Analysis/CyMiniAna/interface/histShards.h"
 
 class efficiency {
   public:
@@ -43,18 +45,29 @@ class efficiency {
                                   const unsigned int nBinsY, const double *ybins );
 
     /* fill efficiencies */
-    virtual void fill( Event &event, const std::vector<unsigned int>& evtsel_decisions=std::vector<unsigned int>());
+    virtual void fill( Event &event, const unsigned int evtsel_decisions=0 );   // bit ss = selection ss passed
     virtual void fill( const std::string &name, const double &value, const bool &decision, const double &weight );
     virtual void fill( const std::string &name, const double &xvalue, const double &yvalue, const bool &decision, const double &weight );
 
     /* Book efficiencies */
     virtual void bookEffs( TFile& outputFile );
+    virtual void book( const std::string &name, const std::vector<flatHist::Axis>& axes );
+
+    /* Fill from several threads: one copy of the histograms per thread (histShards::setWorker) */
+    virtual void setNumberOfShards( const unsigned int nShards );
+
+    /* Make the TEfficiency objects in the output file (before writing the file) */
+    virtual void finalize( TFile& outputFile );
 
   protected:
 
     configuration *m_config;
 
-    std::map<std::string, TEfficiency*> m_map_efficiencies;
+    std::map<std::string, TEfficiency*> m_map_efficiencies;   // made in finalize()
+
+    // passed & total histograms, filled in the event loop
+    histShards m_hists;
+    std::map<std::string, std::pair<int,int>> m_handles;     // name -> (passed, total)
 
     std::vector<std::string> m_names;
 };
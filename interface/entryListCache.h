@@ -0,0 +1,68 @@
+#ifndef ENTRYLISTCACHE_H
+#define ENTRYLISTCACHE_H
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TMD5.h"
+#include "TSystem.h"
+#include "TTreeReader.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/Event.h"
+#include "Analysis/CyMiniAna/interface/eventSelection.h"
+#include "Analysis/CyMiniAna/interface/selectionEngine.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+
+class entryListCache {
+  public:
+    // Default
+    entryListCache(configuration &cmaConfig);
+
+    // Default - so we can clean up;
+    virtual ~entryListCache();
+
+    // Run for every tree (before the event loop); true if a valid cache exists
+    bool initialize(TFile& file, std::vector<eventSelection>& selections);
+
+    // Cached run: move the reader to the next entry that passed a selection
+    bool next(TTreeReader& reader);
+
+    // First run: record the selection decisions of one entry
+    void fill(const long long entry, const unsigned int evtsel_decisions);
+
+    // Run for every tree (after the event loop): write the cache or restore the cutflows
+    void finalize(std::vector<eventSelection>& selections);
+
+    bool cached() const {return m_cached;}
+    std::vector<long long> entries(const unsigned int selection) const {return m_entries.at(selection);}
+
+  protected:
+
+    std::string fingerprint(TFile& file, std::vector<eventSelection>& selections);
+    bool read();
+    void write();
+    std::string md5(const std::string& text);
+
+    configuration *m_config;
+
+    bool m_cached;                                    // reading entries from the cache
+    std::string m_cacheFile;
+    std::string m_key;
+
+    std::vector<std::vector<long long>> m_entries;    // passing entries for each selection
+    std::vector<long long> m_allEntries;              // entries passing at least one selection
+    unsigned int m_nextEntry;
+
+    std::vector<std::vector<double>> m_cutflows;      // change of the cutflows from this tree
+    std::vector<std::vector<double>> m_cutflowsStart; // cutflows before the event loop
+};
+
+#endif
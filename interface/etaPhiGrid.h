@@ -0,0 +1,102 @@
+#ifndef ETAPHIGRID_H
+#define ETAPHIGRID_H
+
+/*
+   Spatial index of physics objects in (eta,phi) for DeltaR matching.
+   - cells are (at least) one matching radius wide, phi wraps around,
+     objects beyond +/-maxEta are kept in the first/last eta cells
+   - a query only looks at the cells within DeltaR of the object
+   - DeltaR is computed like TLorentzVector::DeltaR (same Eta() & Phi()),
+     so the matches are identical to looping over all objects
+   - indices returned = position in the vector given to build()
+*/
+#include "TROOT.h"
+#include "TLorentzVector.h"
+#include "TVector2.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+
+class etaPhiGrid {
+  public:
+    // 'radius' typical DeltaR of the queries (cell size), 'maxEta' extent of the grid
+    etaPhiGrid( const double radius, const double maxEta=5.0 );
+
+    virtual ~etaPhiGrid();
+
+    // index a collection of objects with 'p4' (jets, large-R jets, partons, ...)
+    template<typename T>
+    void build( const std::vector<T>& objects ){
+        m_eta.clear();
+        m_phi.clear();
+        for (const auto& obj : objects){
+            m_eta.push_back( obj.p4.Eta() );
+            m_phi.push_back( obj.p4.Phi() );
+        }
+        index();
+        return;
+    }
+    void build( const std::vector<TLorentzVector>& vectors );
+    void clear();
+
+    // objects with DeltaR < dR (ascending index)
+    void within( const TLorentzVector& p4, const double dR, std::vector<int>& indices ) const;
+
+    // object with the smallest DeltaR < dR (lowest index if several), -1 if none
+    int nearest( const TLorentzVector& p4, const double dR ) const;
+
+    // all objects in the cells that can be within dR (ascending index) -- superset of within(),
+    // for matching that applies its own DeltaR condition
+    void candidates( const TLorentzVector& p4, const double dR, std::vector<int>& indices ) const;
+
+    double deltaR( const TLorentzVector& p4, const unsigned int index ) const;
+    unsigned int size() const {return m_eta.size();}
+
+  protected:
+
+    void index();
+    unsigned int etaCell( const double eta ) const;
+    unsigned int phiCell( const double phi ) const;
+
+    // visit the objects in all cells within dR of (eta,phi): f(index)
+    template<typename F>
+    void visit( const double eta, const double phi, const double dR, F f ) const{
+        if (std::isnan(eta) || std::isnan(phi) || m_eta.empty()) return;
+
+        double reach = dR + m_margin;
+        unsigned int eta_lo = etaCell( eta-reach );
+        unsigned int eta_hi = etaCell( eta+reach );
+
+        // phi cells (wrap around) -- all of them if dR covers the full circle
+        int phi_lo = std::floor( (phi-reach+M_PI)/m_phiWidth );
+        int phi_hi = std::floor( (phi+reach+M_PI)/m_phiWidth );
+        int nPhiCells = std::min( phi_hi-phi_lo+1, int(m_nPhi) );
+
+        for (unsigned int ie=eta_lo; ie<=eta_hi; ie++){
+            for (int ip=0; ip<nPhiCells; ip++){
+                int cell_phi = (phi_lo+ip) % int(m_nPhi);
+                if (cell_phi<0) cell_phi += m_nPhi;
+                unsigned int cell = ie*m_nPhi + cell_phi;
+                for (unsigned int i=m_cellStart[cell]; i<m_cellStart[cell+1]; i++)
+                    f( m_cellObjects[i] );
+            }
+        }
+        return;
+    }
+
+    double m_cellSize;
+    double m_maxEta;
+    double m_phiWidth;
+    double m_margin;          // widen the cell ranges by rounding errors
+    unsigned int m_nEta;
+    unsigned int m_nPhi;
+
+    std::vector<double> m_eta;                // [object]
+    std::vector<double> m_phi;
+    std::vector<unsigned int> m_cellStart;    // objects of cell c: m_cellObjects[m_cellStart[c] .. m_cellStart[c+1])
+    std::vector<int> m_cellObjects;
+};
+
+#endif
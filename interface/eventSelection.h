@@ -14,8 +14,11 @@
 #include "TRandom.h"
 #include "TLorentzVector.h"
 
+#include <map>
 #include <vector>
 #include <string>
+#include <iterator>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -23,6 +26,10 @@
 #include "Analysis/CyMiniAna/interface/Event.h"
 #include "Analysis/CyMiniAna/interface/configuration.h"
 #include "Analysis/CyMiniAna/interface/physicsObjects.h"
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+#include "Analysis/CyMiniAna/interface/histShards.h"
+
+class selectionEngine;
 
 class eventSelection{
 
@@ -31,7 +38,8 @@ class eventSelection{
     eventSelection(configuration &cmaConfig, const std::string &level="");
     virtual ~eventSelection();
 
-    // Run once at the start of the job to setup the cuts
+    // Run once at the start of the job to setup the cuts (after setting the engine)
+    void setEngine(selectionEngine* engine);
     virtual void initialize(const std::string& selection, const std::string& cutsfile);
     virtual void initialize(const std::string &cutsfile);
 
@@ -39,36 +47,47 @@ class eventSelection{
 
     virtual void identifySelection();
 
-    // Run for every tree (before the event loop)
+    static unsigned int definitionsVersion();   // version of the selection code (bump when it changes)
+
+    // Run for every file (before the event loop)
     void setCutflowHistograms(TFile& outputFile);
+    void setNumberOfShards(const unsigned int nShards);
+
+    // Run for every file (after the event loop)
+    void finalizeCutflowHistograms(TFile& outputFile);
 
     // Run for every event (in every systematic) that needs saving
     virtual bool applySelection(const Event& event);
 
-    // -- Selections put into functions (easily reference them in other cuts)
-    // Single lepton selections
-    bool oneLeptonSelection(double cutflow_bin);
-    bool ejetsSelection(double cutflow_bin, const Lepton& lep);
-    bool mujetsSelection(double cutflow_bin);
-    bool oneLeptonSignalSelection(double cutflow_bin);
+    // -- Cuts compiled from the cuts file
+    bool evaluateCuts(double cutflow_bin);
+    bool passCut(const unsigned int index);
+    unsigned int measureCuts();
+    unsigned int adaptiveCuts();
+    void orderCuts();
 
     // Helper functions: Provide external access to information in this class
     void fillCutflows(double cutflow_bin);                                // fill cutflow histograms
     virtual void getCutNames();
     virtual std::vector<std::string> cutNames(){ return m_cutflowNames;}  // Return a vector of the cut names 
     virtual unsigned int numberOfCuts(){ return m_numberOfCuts;}          // Return the number of cuts
+    std::string selection(){ return m_selection;}
+    std::string cutsfile(){ return m_cutsfile;}
+    std::vector<double> cutflowContents();                                // (sum of weights, sum of weights^2) per bin
+    void setCutflowContents(const std::vector<double>& contents);
 
   protected:
 
-    // struct for holding information on a 'cut'
-    //  ideally this could be extended so that cuts are parsed & written by code, not humans!
+    // struct for holding information on a 'cut' (one line in the cuts file)
     struct Cut{
-        std::string name;       // name of cut
-        std::string comparison; // sign of cut (<,<=,>,>=,==,!=)
-        float value;            // float value -- cast to int if needed
+        std::string name;                       // name of cut (cutflow label)
+        std::vector<unsigned int> predicates;   // all need to pass (index in selectionEngine)
     };
 
+    Cut compileCut(const std::string& line);
+
     configuration* m_config;
+    selectionEngine* m_engine;
 
     // cut information
     std::string m_level;     // useful if you want to define one 'family' of selections 
@@ -79,39 +98,24 @@ class eventSelection{
     std::vector<std::string> m_cutflowNames;
     std::vector<Cut> m_cuts;
 
-    // cutflow histograms
-    TH1D* m_cutflow;
-    TH1D* m_cutflow_unw;
+    // adaptive cut order
+    unsigned int m_cutOrderWarmup;          // number of events to measure the cuts (0 = order of cuts file)
+    unsigned int m_nWarmupEvents;
+    std::vector<unsigned int> m_cutOrder;   // order in which the cuts are evaluated
+    std::vector<double> m_cutPass;          // number of warm-up events passing each cut
+    std::vector<double> m_cutTime;          // time spent in each cut during warm-up [ns]
+    std::vector<char> m_cutEvaluated;       // cuts already evaluated for this event
+
+    // cutflow histograms (TH1D made in finalizeCutflowHistograms)
+    histShards m_cutflows;
+    int m_cutflowHandle;
+    int m_cutflowHandle_unw;
 
     // booleans for each selection
     bool m_dummySelection;
-    bool m_isOneLeptonAnalysis;
-    bool m_isOneLeptonSignalAnalysis;
 
     // physics information
     float m_nominal_weight;
-    std::vector<Ljet> m_ljets;
-    std::vector<Jet> m_jets;
-    std::vector<Muon> m_muons;
-    std::vector<Electron> m_electrons;
-    std::vector<Lepton> m_leptons;
-    std::vector<Neutrino> m_neutrinos;
-    MET m_met;
-    float m_ht;
-    float m_st;
-
-    std::vector<std::string> m_ejetsTriggers;
-    std::vector<std::string> m_mujetsTriggers;
-
-    std::map<std::string,unsigned int> m_triggers;
-    std::map<std::string,unsigned int> m_filters;
-
-    unsigned int m_NLeptons;
-    unsigned int m_NElectrons;
-    unsigned int m_NMuons;
-    unsigned int m_NJets;
-    unsigned int m_NLjets;
-    unsigned int m_Nbtags;
 };
 
 #endif
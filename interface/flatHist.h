@@ -0,0 +1,194 @@
+#ifndef FLATHIST_H
+#define FLATHIST_H
+
+/*
+   Histogram with flat arrays of sum(w) & sum(w^2) (1D, 2D, or 3D).
+   - O(1) bin index for equal bins, binary search for variable bins
+   - Filling follows TH1::Fill/TH2::Fill/TH3::Fill exactly (bin index, order of
+     the sums, statistics without under/overflow) so the TH1D/TH2D/TH3D made
+     by materialize() are identical to filling them directly
+   - Several weight variations (e.g., weight systematics) can share the binning:
+     the value is binned once and the weights of all variations are stored
+     next to each other in each bin -- one TH1D/TH2D/TH3D per variation
+   - The bins are stored in blocks that are allocated on the first fill:
+     by default one block (nothing allocated for histograms that are never filled);
+     large histograms that are mostly empty (e.g., truth vs reco) can use
+     small blocks (sparse storage)
+*/
+#include "TROOT.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TH3.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+
+
+class flatHist {
+  public:
+
+    struct Axis{
+        unsigned int nBins;
+        double min;
+        double max;
+        std::vector<double> edges;   // variable bins (empty = equal bins)
+
+        inline unsigned int findBin(const double x) const{
+            /* Same as TAxis::FindBin: 0 = underflow, nBins+1 = overflow (also NaN) */
+            if (x<min) return 0;
+            else if (!(x<max)) return nBins+1;
+            else if (edges.empty()) return 1 + int(nBins*(x-min)/(max-min));
+            return std::upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+        }
+    };
+
+    // 'names' of the weight variations (the first is the nominal histogram)
+    // 'blockSize' number of bins per block (rounded up to a power of 2), 0 = one block
+    flatHist( const std::vector<std::string>& names, const std::vector<Axis>& axes, const unsigned int blockSize=0 );
+
+    virtual ~flatHist();
+
+    /* fill one weight variation */
+    inline void fill( const double x, const double w, const unsigned int variation=0 ){
+        bool inside;
+        unsigned int bin = findBin(x,inside);
+        accumulate( bin, inside, &w, variation, variation+1, x, 0., 0. );
+        return;
+    }
+    inline void fill( const double x, const double y, const double w, const unsigned int variation=0 ){
+        bool inside;
+        unsigned int bin = findBin(x,y,inside);
+        accumulate( bin, inside, &w, variation, variation+1, x, y, 0. );
+        return;
+    }
+    inline void fill( const double x, const double y, const double z, const double w, const unsigned int variation=0 ){
+        bool inside;
+        unsigned int bin = findBin(x,y,z,inside);
+        accumulate( bin, inside, &w, variation, variation+1, x, y, z );
+        return;
+    }
+
+    /* fill the first 'nWeights' variations at once (w[i] = weight of variation i) */
+    inline void fill( const double x, const double* w, const unsigned int nWeights ){
+        bool inside;
+        unsigned int bin = findBin(x,inside);
+        accumulate( bin, inside, w, 0, std::min(nWeights,m_nWeights), x, 0., 0. );
+        return;
+    }
+    inline void fill( const double x, const double y, const double* w, const unsigned int nWeights ){
+        bool inside;
+        unsigned int bin = findBin(x,y,inside);
+        accumulate( bin, inside, w, 0, std::min(nWeights,m_nWeights), x, y, 0. );
+        return;
+    }
+    inline void fill( const double x, const double y, const double z, const double* w, const unsigned int nWeights ){
+        bool inside;
+        unsigned int bin = findBin(x,y,z,inside);
+        accumulate( bin, inside, w, 0, std::min(nWeights,m_nWeights), x, y, z );
+        return;
+    }
+
+    // Make the ROOT histograms (in the current directory) with the same bins & statistics
+    std::vector<TH1*> materialize() const;
+
+    void add( const flatHist& other );    // same bins & weight variations (all bins, statistics, & entries)
+    void reset();
+
+    // bins of one weight variation (TH1 global bin number)
+    double binContent( const unsigned int bin, const unsigned int variation=0 ) const;
+    double binError2( const unsigned int bin, const unsigned int variation=0 ) const;
+    void setBinContent( const unsigned int bin, const unsigned int variation, const double content, const double error2 );
+
+    void setSumw2( const bool sumw2 ) {m_storeSumw2 = sumw2;}   // store sum(w^2) in the ROOT histograms (default)
+
+    std::vector<std::string> names() const {return m_names;}
+    unsigned int dimension() const {return m_axes.size();}
+    unsigned int numberOfWeights() const {return m_nWeights;}
+    unsigned int numberOfCells() const {return m_nCells;}
+    unsigned long long allocatedBytes() const;                  // memory used by the bins
+    unsigned long long denseBytes() const {return 2ULL*sizeof(double)*m_nCells*m_nWeights;}
+
+  protected:
+
+    inline unsigned int findBin( const double x, bool& inside ) const{
+        /* Global bin number (TH1::GetBin) */
+        unsigned int binx = m_axes[0].findBin(x);
+        inside = (binx>0 && binx<=m_axes[0].nBins);
+        return binx;
+    }
+    inline unsigned int findBin( const double x, const double y, bool& inside ) const{
+        unsigned int binx = m_axes[0].findBin(x);
+        unsigned int biny = m_axes[1].findBin(y);
+        inside = (binx>0 && binx<=m_axes[0].nBins) && (biny>0 && biny<=m_axes[1].nBins);
+        return biny*(m_axes[0].nBins+2) + binx;
+    }
+    inline unsigned int findBin( const double x, const double y, const double z, bool& inside ) const{
+        unsigned int binx = m_axes[0].findBin(x);
+        unsigned int biny = m_axes[1].findBin(y);
+        unsigned int binz = m_axes[2].findBin(z);
+        inside = (binx>0 && binx<=m_axes[0].nBins) && (biny>0 && biny<=m_axes[1].nBins) && (binz>0 && binz<=m_axes[2].nBins);
+        return binx + (m_axes[0].nBins+2)*(biny + (m_axes[1].nBins+2)*binz);
+    }
+
+    inline void accumulate( const unsigned int bin, const bool inside, const double* w,
+                            const unsigned int first, const unsigned int last,
+                            const double x, const double y, const double z ){
+        /* Add weights w[0..last-first) to variations [first,last) */
+        unsigned int block = bin >> m_blockShift;
+        if (m_sumw[block].empty()) allocate(block);
+
+        unsigned int offset = (bin - (block << m_blockShift))*m_nWeights;
+        double* sumw  = &m_sumw[block][offset];
+        double* sumw2 = &m_sumw2[block][offset];
+        for (unsigned int v=first; v<last; v++){
+            double wv = w[v-first];
+            m_entries[v]++;
+            sumw2[v] += wv*wv;
+            sumw[v]  += wv;
+        }
+        if (!inside) return;       // no under/overflow in the statistics
+
+        unsigned int dimension = m_axes.size();
+        for (unsigned int v=first; v<last; v++){
+            double wv = w[v-first];
+            double* stats = &m_stats[11*v];
+            stats[0] += wv;
+            stats[1] += wv*wv;
+            stats[2] += wv*x;
+            stats[3] += wv*x*x;
+            if (dimension<2) continue;
+            stats[4] += wv*y;
+            stats[5] += wv*y*y;
+            stats[6] += wv*x*y;
+            if (dimension<3) continue;
+            stats[7]  += wv*z;
+            stats[8]  += wv*z*z;
+            stats[9]  += wv*x*z;
+            stats[10] += wv*y*z;
+        }
+        return;
+    }
+
+    void allocate( const unsigned int block );
+    unsigned int blockCells( const unsigned int block ) const;
+    std::vector<double> binEdges( const Axis& axis ) const;
+
+    std::vector<std::string> m_names;
+    std::vector<Axis> m_axes;
+    unsigned int m_nWeights;
+    unsigned int m_nCells;
+    unsigned int m_blockShift;       // bins per block = 2^m_blockShift
+    bool m_storeSumw2;
+
+    // [block][bin in block][variation], bin = TH1 global bin number (with under/overflow)
+    // an empty block has not been filled yet (all bins are 0)
+    std::vector<std::vector<double>> m_sumw;
+    std::vector<std::vector<double>> m_sumw2;
+    std::vector<double> m_stats;     // [variation][11], same order as TH1::GetStats
+    std::vector<double> m_entries;   // [variation]
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include "Analysis/CyMiniAna/interface/physicsObjects.h"
 #include "Analysis/CyMiniAna/interface/eventSelection.h"
 #include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/asyncWriter.h"
 
 
 class flatTree4ML {
@@ -44,10 +45,15 @@ class flatTree4ML {
 
   protected:
 
+    void fillEvent(const std::map<std::string,double>& features);
+
     TTree * m_ttree;
     TTree * m_metadataTree;
     configuration * m_config;
 
+    bool m_asyncOutput;
+    asyncWriter<std::map<std::string,double>> m_writer;   // fill the tree on a separate thread
+
     /**** Training branches ****/
     // weights for inputs
     float m_xsection;
@@ -0,0 +1,63 @@
+#ifndef HISTSHARDS_H
+#define HISTSHARDS_H
+
+/*
+   Thread-local copies ('shards') of a list of flatHist.
+   - Every worker fills its own shard (no locks, no atomics):
+     call setWorker() once in each worker thread, then use operator[]
+   - The worker index is per thread, shared by all histShards (histograms,
+     efficiencies & cutflows), so one call per thread covers all of them;
+     every instance checks it against its own number of shards
+   - merge() adds the shards together with a fixed tree of additions,
+     so the result does not depend on which thread finished first
+   - With one shard (default) this is a plain vector of histograms
+*/
+#include <string>
+#include <vector>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+
+
+class histShards {
+  public:
+    histShards();
+
+    virtual ~histShards();
+
+    // Book a histogram in every shard -- return its handle
+    int book( const std::vector<std::string>& names, const std::vector<flatHist::Axis>& axes, const unsigned int blockSize=0 );
+
+    // One shard per worker (empty copies of the booked histograms)
+    void setNumberOfShards( const unsigned int nShards );
+
+    // Shard used by the current thread (worker = 0 ... nShards-1)
+    static void setWorker( const unsigned int worker );
+
+    // Histogram 'handle' of the current thread
+    inline flatHist& operator[]( const unsigned int handle ){
+        if (t_worker>=m_shards.size()) workerOutOfRange();
+        return m_shards[t_worker][handle];
+    }
+
+    // Add all shards into the first one (after the workers are done) & empty the others
+    void merge();
+
+    // Merged histograms (call merge() first)
+    std::vector<flatHist>& merged() {return m_shards.front();}
+
+    void clear();
+
+    unsigned int size() const {return m_shards.front().size();}
+    unsigned int numberOfShards() const {return m_shards.size();}
+
+  protected:
+
+    void workerOutOfRange() const;
+
+    std::vector<std::vector<flatHist>> m_shards;   // [shard][handle]
+
+    static thread_local unsigned int t_worker;
+};
+
+#endif
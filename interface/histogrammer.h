@@ -14,10 +14,15 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <iterator>
+#include <sstream>
 
 #include "Analysis/CyMiniAna/interface/configuration.h"
 #include "Analysis/CyMiniAna/interface/tools.h"
 #include "Analysis/CyMiniAna/interface/Event.h"
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+#include "Analysis/CyMiniAna/interface/histShards.h"
+#include "Analysis/CyMiniAna/interface/etaPhiGrid.h"
 
 class histogrammer {
   public:
@@ -28,40 +33,61 @@ class histogrammer {
     // Default - so we can clean up;
     virtual ~histogrammer();
 
-    /* initialize histograms (1D, 2D, & 3D) */
-    virtual void init_hist( const std::string& name, 
+    /* initialize histograms (1D, 2D, & 3D) -- return the handle (index) of the histogram */
+    virtual int init_hist( const std::string& name, 
                                   const unsigned int nBins, const double x_min, const double x_max );
-    virtual void init_hist( const std::string& name, 
+    virtual int init_hist( const std::string& name, 
                                   const unsigned int nBins, const double *xbins );
 
-    virtual void init_hist( const std::string& name, 
+    virtual int init_hist( const std::string& name, 
                                   const unsigned int nBinsX, const double x_min, const double x_max,
                                   const unsigned int nBinsY, const double y_min, const double y_max );
-    virtual void init_hist( const std::string& name, 
+    virtual int init_hist( const std::string& name, 
                                   const unsigned int nBinsX, const double *xbins,
                                   const unsigned int nBinsY, const double *ybins );
-    virtual void init_hist( const std::string& name, const unsigned int nBinsX, const double x_min, const double x_max,
+    virtual int init_hist( const std::string& name, const unsigned int nBinsX, const double x_min, const double x_max,
                               const unsigned int nBinsY, const double y_min, const double y_max,
                               const unsigned int nBinsZ, const double z_min, const double z_max );
-    virtual void init_hist( const std::string& name, const unsigned int nBinsX, const double *xbins,
+    virtual int init_hist( const std::string& name, const unsigned int nBinsX, const double *xbins,
                               const unsigned int nBinsY, const double *ybins,  
                               const unsigned int nBinsZ, const double *zbins );
 
     /* fill histograms */
-    virtual void fill( Event& event, const std::vector<unsigned int>& evtsel_decisions=std::vector<unsigned int>() );
+    virtual void fill( Event& event, const unsigned int evtsel_decisions=0, const int region=-1 );   // bit ss = selection ss passed
     virtual void fill( const std::string& name, Event& event, double event_weight );
+    virtual void fill( const std::vector<int>& hists, Event& event, const std::vector<double>& event_weights );  // handles from resolveHists()
     virtual void fill( const std::string& name, const double& value, const double& weight );
     virtual void fill( const std::string& name, const double& xvalue, const double& yvalue, const double& weight );
     virtual void fill( const std::string& name, const double& xvalue, const double& yvalue, const double& zvalue, const double& weight );
+    virtual void fill( const int handle, const double& value, const double& weight );
+    virtual void fill( const int handle, const double& xvalue, const double& yvalue, const double& weight );
+    virtual void fill( const int handle, const double& xvalue, const double& yvalue, const double& zvalue, const double& weight );
+    virtual void fill( const int handle, const double& value, const std::vector<double>& weights );
+    virtual void fill( const int handle, const double& xvalue, const double& yvalue, const std::vector<double>& weights );
+    virtual void fill( const int handle, const double& xvalue, const double& yvalue, const double& zvalue, const std::vector<double>& weights );
 
-    /* Put over/underflow in last/first bins.  Called from outside macro */
-    virtual void overUnderFlow();
-    virtual void overFlow();
-    virtual void underFlow();
+    /* Fill from several threads: one copy of the histograms per thread (histShards::setWorker) */
+    virtual void setNumberOfShards( const unsigned int nShards );
+
+    /* Write the TH1D/TH2D/TH3D to the output file (with over/underflow in the last/first bins) */
+    virtual void finalize( TFile& outputFile );
+
+    /* Put over/underflow in last/first bins.  Called from finalize() */
+    virtual void overUnderFlow( TH1* hist );
+    virtual void overFlow( TH1* hist );
+    virtual void underFlow( TH1* hist );
+    void fold( TH1* hist, const bool overflow );
 
     /* Book histograms */
     virtual void initialize( TFile& outputFile, bool doSystWeights=false );
     virtual void bookHists( std::string name );
+    virtual unsigned int resolveHists( const std::string& name );
+    virtual int book( const std::string& name, const std::vector<flatHist::Axis>& axes );
+
+    /* Histograms defined in a file (configuration::histogramsFile) instead of bookHists()/fill() */
+    virtual void loadSpecs( const std::string& histogramsFile );
+    virtual void bookSpecs( const std::string& name );
+    virtual void fillSpecs( const std::vector<int>& hists, Event& event, const std::vector<double>& event_weights );
 
   protected:
 
@@ -75,14 +101,120 @@ class histogrammer {
     bool m_useLeptons;
     bool m_useNeutrinos;
 
-    std::map<std::string, TH1D*> m_map_histograms1D;
-    std::map<std::string, TH2D*> m_map_histograms2D;
-    std::map<std::string, TH3D*> m_map_histograms3D;
+    // histograms filled in the event loop, by handle (index returned by init_hist)
+    histShards m_hists;                        // one copy per thread
+    std::map<std::string, std::pair<int,unsigned int>> m_handles;   // "h_"+name -> handle, weight variation
+    std::vector<std::string> m_variations;    // names of the weight variations booked together (bookHists)
 
     std::vector<std::string> m_names;
 
+    // Histograms filled from the Event, one of each per set booked by bookHists().
+    // m_histNames holds the name of each (booked as name+"_"+set), in the same order
+    enum Hist {kNJets=0,kNBtags,kJet0Pt,kJet1Pt,kJet0Bdisc,kJet1Bdisc,kJetPt,kJetEta,kJetPhi,kJetBdisc,
+               kNLjets,kLjetPt,kLjetEta,kLjetPhi,kLjetSDmass,kLjetCharge,kLjetTau1,kLjetTau2,kLjetTau3,
+               kLjetTau21,kLjetTau32,kLjetSubjet0Bdisc,kLjetSubjet1Bdisc,kLjetSubjet0Charge,kLjetSubjet1Charge,
+               kElPt,kElEta,kElPhi,kElCharge,kMuPt,kMuEta,kMuPhi,kMuCharge,
+               kNuPt,kNuEta,kNuPhi,kNuEtaSmp,kNuPzSamples,kWMass,kWPt,kWMassSmp,kWPtSmp,kWMassViper,kWPtViper,
+               kNuDeltaPz,kNuDeltaPzSmp,kNuDeltaEta,kNuDeltaEtaSmp,kNuDeltaR,kNuDeltaRSmp,kNuDeltaRViper,
+               kMTW,kMETmet,kMETphi,kHT,kST,kWprimeMass,kVLQMass,kWprimeMassNuSmp,kVLQMassNuSmp,
+               kJetPtTruthQuarkWprime,kJetBdiscTruthQuarkWprime,kTruthWprimeMass,kTruthVLQMass,
+               kTruthQuarkVLQEnergy,kTruthQuarkVLQEnergyDiff,kTruthQuarkVLQEnergyAsymm,
+               kTruthQuarkPt,kTruthVLQBosonPt,kTruthVLQQuarkPt,
+               kTruthDeltaRWprimeQuarkVLQ,kTruthDeltaRVLQBosonQuark,kTruthDeltaRBosonDecays,
+               kVLQMassResolution,kVLQMassResolutionNorm,kVLQMassTruthVsReco,
+               kWprimeMassResolution,kWprimeMassResolutionNorm,kWprimeMassTruthVsReco,
+               kVLQMassResolutionNormNuSmp,kVLQMassTruthVsRecoNuSmp,
+               kWprimeMassResolutionNormNuSmp,kWprimeMassTruthVsRecoNuSmp,
+               kNumberOfHists};
+    std::vector<std::string> m_histNames = {
+               "n_jets","n_btags","jet0_pt","jet1_pt","jet0_bdisc","jet1_bdisc","jet_pt","jet_eta","jet_phi","jet_bdisc",
+               "n_ljets","ljet_pt","ljet_eta","ljet_phi","ljet_SDmass","ljet_charge","ljet_tau1","ljet_tau2","ljet_tau3",
+               "ljet_tau21","ljet_tau32","ljet_subjet0_bdisc","ljet_subjet1_bdisc","ljet_subjet0_charge","ljet_subjet1_charge",
+               "el_pt","el_eta","el_phi","el_charge","mu_pt","mu_eta","mu_phi","mu_charge",
+               "nu_pt","nu_eta","nu_phi","nu_eta_smp","nu_pz_samples","w_mass","w_pt","w_mass_smp","w_pt_smp","w_mass_viper","w_pt_viper",
+               "nu_deltaPz","nu_deltaPz_smp","nu_deltaEta","nu_deltaEta_smp","nu_deltaR","nu_deltaR_smp","nu_deltaR_viper",
+               "mtw","met_met","met_phi","ht","st","wprimeMass","vlqMass","wprimeMass_nusmp","vlqMass_nusmp",
+               "jet_pt_truth_quark_Wprime","jet_bdisc_truth_quark_Wprime","truth_wprime_mass","truth_vlq_mass",
+               "truth_quark_vlq_energy","truth_quark_vlq_energy_diff","truth_quark_vlq_energy_asymm",
+               "truth_quark_pt","truth_vlq_boson_pt","truth_vlq_quark_pt",
+               "truth_deltaR_wprime_quark-vlq","truth_deltaR_vlq_boson-quark","truth_deltaR_boson_decays",
+               "vlq_massResolution","vlq_massResolution_norm","vlqMass_truth_vs_reco",
+               "wprime_massResolution","wprime_massResolution_norm","wprimeMass_truth_vs_reco",
+               "vlq_massResolution_norm_nusmp","vlqMass_truth_vs_reco_nusmp",
+               "wprime_massResolution_norm_nusmp","wprimeMass_truth_vs_reco_nusmp"};
+
+    // Fill plan (generated in initialize()) -- no string operations when filling
+    std::vector<std::vector<int>> m_histSets;               // [set][Hist] -> handle (-1 = not booked)
+    std::map<std::string, unsigned int> m_mapOfHistSets;    // name of the set -> index in m_histSets
+    std::vector<unsigned int> m_nominalSets;                // [selection]
+    unsigned int m_nWeightSystematics;                      // weight variations 1,2,... (Event::systEventWeights)
+    std::vector<std::vector<unsigned int>> m_regionSets;    // [selection][region] (regionCategoriser index)
+
+    // Histograms defined in the histograms file, one per line:
+    //   NAME  COLLECTION[INDEX]  OBSERVABLE[:OBSERVABLE[:OBSERVABLE]]  NBINS MIN MAX (each axis)  [OBSERVABLE COMPARISON VALUE && ...]
+    // e.g., "jet_pt_central  JETS  PT  200 0 2000  ETA < 1.5 && ETA > -1.5"
+    enum Collection {kCollEvent=0,kCollMET,kCollJets,kCollLjets,kCollLeptons,kCollElectrons,kCollMuons,kCollNeutrinos,
+                     kNumberOfCollections};
+    enum Observable {kObsN=0,kObsPt,kObsEta,kObsPhi,kObsMass,kObsEnergy,kObsCharge,kObsBdisc,kObsIsGood,
+                     kObsSDmass,kObsTau21,kObsTau32,kObsMTW,kObsHT,kObsST,kObsNBtags};
+    enum Comparison {kLessThan=0,kLessEqual,kGreaterThan,kGreaterEqual,kEqual,kNotEqual};
+
+    std::map<std::string,unsigned int> m_mapOfCollections = {
+             {"EVENT",kCollEvent}, {"MET",kCollMET}, {"JETS",kCollJets}, {"LJETS",kCollLjets},
+             {"LEPTONS",kCollLeptons}, {"ELECTRONS",kCollElectrons}, {"MUONS",kCollMuons}, {"NEUTRINOS",kCollNeutrinos} };
+    std::map<std::string,unsigned int> m_mapOfObservables = {
+             {"N",kObsN}, {"PT",kObsPt}, {"ETA",kObsEta}, {"PHI",kObsPhi}, {"MASS",kObsMass}, {"E",kObsEnergy},
+             {"CHARGE",kObsCharge}, {"BDISC",kObsBdisc}, {"ISGOOD",kObsIsGood}, {"SDMASS",kObsSDmass},
+             {"TAU21",kObsTau21}, {"TAU32",kObsTau32}, {"MTW",kObsMTW}, {"HT",kObsHT}, {"ST",kObsST},
+             {"N_BTAGS",kObsNBtags} };
+    std::map<std::string,unsigned int> m_mapOfComparisons = {
+             {"<",kLessThan}, {"<=",kLessEqual}, {">",kGreaterThan},
+             {">=",kGreaterEqual}, {"==",kEqual}, {"!=",kNotEqual} };
+
+    struct Condition{
+        unsigned int observable;  // Observable (of the same object/event)
+        unsigned int comparison;  // Comparison
+        float value;
+    };
+    struct HistSpec{
+        std::string name;                   // booked as "h_"+name+"_"+set
+        unsigned int collection;            // Collection
+        int index;                          // only this object of the collection (-1 = all)
+        std::vector<unsigned int> observables;   // one per axis (Observable)
+        std::vector<flatHist::Axis> axes;
+        std::vector<Condition> conditions;  // all must pass (per object)
+    };
+
+    HistSpec compileSpec( const std::string& line );
+    bool validObservable( const unsigned int collection, const unsigned int observable ) const;
+    bool compare( const double value, const unsigned int comparison, const float cut ) const;
+
+    // value of an observable -- only computed for the histograms that use it
+    double value( const CmaBase& object, const unsigned int observable ) const;
+    double value( const Jet& jet, const unsigned int observable ) const;
+    double value( const Ljet& ljet, const unsigned int observable ) const;
+    double value( const Lepton& lepton, const unsigned int observable ) const;
+    double value( const MET& met, const unsigned int observable ) const;
+    double value( const Event& event, const unsigned int observable ) const;
+
+    template<typename T> void fillObjects( const HistSpec& spec, const int handle, const std::vector<T>& objects,
+                                           const std::vector<double>& event_weights );
+    template<typename T> void fillObject( const HistSpec& spec, const int handle, const T& object,
+                                          const std::vector<double>& event_weights );
+    template<typename T> bool passConditions( const HistSpec& spec, const T& object ) const;
+
+    bool m_useSpecs;                                  // book/fill the histograms of the histograms file
+    std::string m_histogramsFile;
+    std::vector<HistSpec> m_specs;
+    std::vector<bool> m_specCollections;              // [Collection] used by a histogram -> copied from the event
+    std::vector<std::vector<int>> m_specSets;         // [set][spec] -> handle (same set index as m_histSets)
+
+    bool m_useQCDRegions;
+
     bool m_putOverflowInLastBin;
     bool m_putUnderflowInFirstBin;
+    unsigned int m_sparseHistogramBins;     // book larger histograms in blocks of m_sparseBlockSize bins
+    unsigned int m_sparseBlockSize;
 };
 
 #endif
@@ -35,12 +35,17 @@ class histogrammer4ML : public histogrammer {
     /* Book histograms */
     void initialize( TFile& outputFile );
     void bookHists();
+    void bookFeature( const std::string& feature, const std::string& name,
+                      const unsigned int nBins, const double x_min, const double x_max );
 
   protected:
 
     configuration *m_config;
     std::string m_name;
 
+    std::vector<std::string> m_features;    // key in the map of features
+    std::vector<int> m_featureHists;        // handle of its histogram
+
     // Target values for system
     std::vector<std::string> m_targets = {"0","1","2"};
 };
@@ -0,0 +1,88 @@
+#ifndef KINEMATICFIT_H
+#define KINEMATICFIT_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <chrono>
+
+#include "TMinuit.h"
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/physicsObjects.h"
+
+
+class KinematicFit {
+  public:
+    KinematicFit( configuration& cmaConfig );
+
+    ~KinematicFit();
+
+    void setObjects(Lepton& lepton, MET& met);
+    void setJets(std::vector<Jet> jets);      // b-jet candidates from the VLQ decay (VLQ mass hypothesis)
+
+    bool execute(const bool minuit=false);    // fit (lowest chi2 of all b-jet candidates), false if not converged
+    void summary() const;                     // number of fits, converged & stalled fits, time per fit
+
+    Neutrino neutrino() const {return m_nu;}
+    int jet() const {return m_jet;}           // index in setJets() of the b-jet from the VLQ (-1 = none)
+    float jetScale() const {return m_jetScale;}
+    float chi2() const {return m_chi2;}
+
+  protected:
+
+    // neutrino px, py, pz & energy scale of the b-jet from the VLQ
+    static const unsigned int kNPars = 4;
+    // MET x, MET y, b-jet energy, W mass, VLQ mass
+    static const unsigned int kNResiduals = 5;
+
+    // result of a fit: converged (chi2 change or gradient below tolerance),
+    // stalled (no step lowers the chi2 but the gradient is not small), or too many iterations
+    enum FitStatus {kConverged=0,kStalled,kNotConverged};
+
+    double residuals( const double* par, double* r, double J[][kNPars] ) const;
+    void curvature( const double* par, const double* r, double H[][kNPars] ) const;
+    FitStatus levenbergMarquardt( double* par, double& chi2, unsigned int& iterations ) const;
+    FitStatus minuit( double* par, double& chi2 ) const;
+    static bool solve( double A[][kNPars], double* b );
+    static void minuitFCN( int& npar, double* grad, double& f, double* par, int flag );
+
+    configuration *m_config;
+
+    Lepton m_lepton;
+    MET m_met;
+    std::vector<Jet> m_jets;
+    const Jet* m_fitJet;                      // jet in the current fit
+
+    // result
+    Neutrino m_nu;
+    int m_jet;
+    float m_jetScale;
+    float m_chi2;
+
+    // constraints & resolutions [GeV]
+    double m_wmass;
+    double m_wmassSigma;
+    double m_vlqMass;                         // 0 = no VLQ mass hypothesis
+    double m_vlqMassSigma;
+    double m_metSigma;
+    double m_jetStochastic;                   // sigma(E)/E = stochastic/sqrt(E) (+) constant
+    double m_jetConstant;
+    double m_jetSigma;                        // relative resolution of the jet in the current fit
+    unsigned int m_maxIterations;
+    double m_tolerance;                       // convergence: relative change of the chi2
+    double m_gradTolerance;                   // convergence: |d(chi2)/d(parameters)|
+
+    TMinuit* m_minuit;
+
+    // benchmark
+    unsigned long long m_nFits;
+    unsigned long long m_nConverged;
+    unsigned long long m_nStalled;
+    unsigned long long m_nIterations;
+    double m_fitTime;                         // [us]
+    bool m_useMinuit;
+};
+
+#endif
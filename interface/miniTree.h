@@ -11,6 +11,7 @@
 #include "TTreeReaderValue.h"
 #include "TTreeReaderArray.h"
 
+#include <map>
 #include <memory>
 #include <set>
 #include <list>
@@ -21,6 +22,7 @@
 #include "Analysis/CyMiniAna/interface/Event.h"
 #include "Analysis/CyMiniAna/interface/eventSelection.h"
 #include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/asyncWriter.h"
 
 class miniTree {
   public:
@@ -31,14 +33,15 @@ class miniTree {
     virtual ~miniTree();
 
     // Run once at the start of the job;
-    virtual void initialize(TTree * t, TFile& outputFile, const std::string directory, const int cloneFactor=0);
+    virtual void initialize(TFile& outputFile, const std::string directory, const int cloneFactor=0);
     virtual void createBranches();
     virtual void disableBranches();
+    virtual void setBuffers();
 
     bool branch_exists(const std::string& br);
 
     // Run for every event (in every systematic) that needs saving;
-    virtual void saveEvent(Event &event, const std::vector<unsigned int>& evtsel_decisions=std::vector<unsigned int>());
+    virtual void saveEvent(Event &event, const unsigned int evtsel_decisions=0);   // bit ss = selection ss passed
 
     // Clear stuff;
     virtual void finalize();
@@ -46,12 +49,26 @@ class miniTree {
 
   protected:
 
+    // entry to copy from the input tree and the selection decisions
+    struct miniTreeEntry {
+        long long entry;
+        unsigned int decisions;
+    };
+    void fillEntry(miniTreeEntry& entry);
+
     TTree * m_ttree;
     TTree * m_oldTTree;
     configuration * m_config;
 
+    // entries are copied from a separate handle of the input file (slimmed & read by the output thread)
+    bool m_asyncOutput;
+    TFile * m_inputFile;
+    asyncWriter<miniTreeEntry> m_writer;
+
     std::vector<std::string> m_selections;
     std::vector<std::string> m_listOfBranches;
+    std::vector<std::string> m_branchSlimming;   // keep/drop statements from the configuration
+    std::map<std::string,std::vector<std::string>> m_keptBranches;   // 'keep' pattern -> branches (size reported in finalize)
 
     // new branches defined here 
     float m_dnn;
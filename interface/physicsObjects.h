@@ -7,6 +7,7 @@
 #include "TLorentzVector.h"
 #include <map>
 #include <string>
+#include <vector>
 
 
 // easily keep track of isolation and ID working points
@@ -87,6 +88,31 @@ struct TruthWprime {
     bool isHadronic;
 };
 
+// Decay graph of the truth record (built once per event)
+// -- indices in the truth record (= index in the vector of truth partons), -1 = none
+struct TruthDecayGraph {
+    std::vector<int> absPdgId;
+    std::vector<int> parent;
+    std::vector<int> child0;        // children outside the record are -1
+    std::vector<int> child1;
+
+    int wprime;                     // W' -> VLQ + q
+    int vlq;
+    int wprime_quark;
+    int vlq_boson;                  // VLQ -> W/Z/H + q
+    int vlq_quark;
+    std::vector<int> wBosons;       // W bosons with 2 children
+    unsigned int nLeptonicW;        // W -> l nu
+    int leptonicW;                  // only set if there is exactly one W -> l nu
+    int neutrino;
+
+    void clear(){
+        absPdgId.clear(); parent.clear(); child0.clear(); child1.clear(); wBosons.clear();
+        wprime = vlq = wprime_quark = vlq_boson = vlq_quark = leptonicW = neutrino = -1;
+        nLeptonicW = 0;
+    }
+};
+
 
 // Struct for jets
 // -- common to all types of jets
@@ -119,6 +145,7 @@ struct Ljet : Jet{
     float tau21;
     float tau32;
     float softDropMass;
+    bool isTopTagged;    // softdrop mass & tau32 (QCD/ABCD regions)
 
     float BEST_t;
     float BEST_w;
@@ -188,6 +215,7 @@ struct Muon : Lepton{
 
 struct Neutrino : CmaBase{
     // extra neutrino attributes
+    TLorentzVector p4_sampling;     // 2nd solution: MET & pz_sampling, or the kinematic fit (all components fitted)
     float pz_sampling;
     std::vector<float> pz_samplings;
     bool isImaginary;
@@ -207,7 +235,9 @@ struct VLQ : CmaBase{
 // Wprime (assuming W'->bT for now)
 struct Wprime : CmaBase{
     VLQ vlq;
-    Jet jet;
+    Jet jet;         // jet from the Wprime decay
+    int vlq_jet;     // index of the jet from the VLQ decay
+    int neutrino;    // index of the neutrino solution
     float A_energy;
 };
 
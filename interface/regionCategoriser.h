@@ -0,0 +1,48 @@
+#ifndef REGIONCATEGORISER_H
+#define REGIONCATEGORISER_H
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TH1.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/Event.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+
+class regionCategoriser {
+  public:
+    // Default
+    regionCategoriser(configuration &cmaConfig);
+
+    // Default - so we can clean up;
+    virtual ~regionCategoriser();
+
+    // Run for every file (before the event loop)
+    void setCutflowHistograms(TFile& outputFile);
+
+    // Run for every event that passed a selection: index of the (n_btag,n_toptag) region
+    int execute(const Event& event, const unsigned int evtsel_decisions);
+
+    int region() const {return m_region;}
+    std::vector<std::string> regions() const {return m_regions;}
+    unsigned int numberOfRegions() const {return m_regions.size();}
+
+  protected:
+
+    configuration *m_config;
+
+    std::vector<std::string> m_selections;
+    std::vector<std::string> m_regions;     // "0b0t","0b1t",...,"2b2t" (index = 3*n_btag + n_toptag)
+    unsigned int m_maxTags;                 // last category is '>= m_maxTags'
+    int m_region;
+
+    // number of events in each region (one cutflow per selection)
+    std::vector<TH1D*> m_cutflow;
+    std::vector<TH1D*> m_cutflow_unw;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef SELECTIONENGINE_H
+#define SELECTIONENGINE_H
+
+#include "TROOT.h"
+#include "TFile.h"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/Event.h"
+#include "Analysis/CyMiniAna/interface/eventSelection.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/physicsObjects.h"
+
+class selectionEngine {
+  public:
+    // Default
+    selectionEngine(configuration &cmaConfig);
+
+    // Default - so we can clean up;
+    virtual ~selectionEngine();
+
+    // Run once at the start of the job to setup the selections
+    void initialize(const std::vector<std::string>& selections, const std::vector<std::string>& cutsfiles);
+
+    // Run for every file (before the event loop)
+    void setCutflowHistograms(TFile& outputFile);
+    void setNumberOfShards(const unsigned int nShards);
+
+    // Run for every file (after the event loop)
+    void finalizeCutflowHistograms(TFile& outputFile);
+
+    // Run for every event: bit 'ss' is set if selection 'ss' passed
+    // (the objects of the event are only built if a cut needs them)
+    unsigned int execute(Event& event);
+
+    void finalize();
+
+    // Shared predicates ('QUANTITY COMPARISON VALUE' from the cuts files)
+    int addPredicate(const std::string& quantity, const std::string& comparison, const float value);
+    bool predicate(const unsigned int index);
+    float weight();     // nominal event weight (for the cutflows)
+    void clearEvent();
+
+    // Cost of the predicates (for ordering the cuts): time of the first evaluation in this event [ns]
+    void timePredicates(const bool timing) {m_timePredicates = timing;}
+    double predicateTime(const unsigned int index) const {return m_predicateTime.at(index);}
+
+    std::vector<eventSelection>& selections() {return m_selections;}
+    unsigned int numberOfSelections() const {return m_selections.size();}
+    unsigned int numberOfPredicates() const {return m_predicates.size();}
+
+    static unsigned int definitionsVersion();   // version of the quantity definitions (bump when they change)
+
+  protected:
+
+    void loadObjects(const unsigned int index);
+    double quantity(const unsigned int index);
+    bool compare(const double quantity, const unsigned int comparison, const float value) const;
+
+    // Quantities & comparisons that can be used in the cuts file
+    enum Quantity {kNLeptons=0,kNElectrons,kNMuons,kNJets,kNLjets,kNBtags,kMET,kHT,kST,kTrigger,kFilters};
+    enum Comparison {kLessThan=0,kLessEqual,kGreaterThan,kGreaterEqual,kEqual,kNotEqual};
+
+    std::map<std::string,unsigned int> m_mapOfQuantities = {
+             {"N_LEP",kNLeptons}, {"N_EL",kNElectrons}, {"N_MU",kNMuons},
+             {"N_AK4",kNJets},    {"N_AK8",kNLjets},    {"N_BTAGS",kNBtags}, {"N_BTAG",kNBtags},
+             {"MET",kMET},        {"HT",kHT},           {"ST",kST},
+             {"TRIGGER",kTrigger},{"FILTERS",kFilters} };
+    std::map<std::string,unsigned int> m_mapOfComparisons = {
+             {"<",kLessThan}, {"<=",kLessEqual}, {">",kGreaterThan},
+             {">=",kGreaterEqual}, {"==",kEqual}, {"!=",kNotEqual} };
+
+    // one node in the selection graph -- shared by all cuts that use it
+    struct Predicate{
+        unsigned int quantity;    // Quantity
+        unsigned int comparison;  // Comparison
+        float value;
+    };
+
+    configuration *m_config;
+
+    std::vector<eventSelection> m_selections;
+    std::vector<Predicate> m_predicates;
+    std::vector<char> m_predicateState;     // this event: 0 = not evaluated, 1 = pass, 2 = fail
+    std::vector<double> m_predicateTime;    // this event: time to evaluate each predicate [ns]
+    bool m_timePredicates;
+
+    // physics information (copied from the event when a predicate needs it)
+    Event* m_event;
+    bool m_loadedLeptons;
+    bool m_loadedJets;
+    bool m_loadedLjets;
+    bool m_loadedKinematics;
+    bool m_loadedTriggers;
+    bool m_loadedFilters;
+
+    std::vector<Lepton> m_leptons;
+    MET m_met;
+    float m_ht;
+    float m_st;
+
+    std::vector<std::string> m_ejetsTriggers;
+    std::vector<std::string> m_mujetsTriggers;
+
+    std::map<std::string,unsigned int> m_triggers;
+    std::map<std::string,unsigned int> m_filters;
+
+    unsigned int m_NLeptons;
+    unsigned int m_NElectrons;
+    unsigned int m_NMuons;
+    unsigned int m_NJets;
+    unsigned int m_NLjets;
+    unsigned int m_Nbtags;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <fstream>
 #include <assert.h>
+#include <cmath>
 
 #include "TROOT.h"
 #include "TFile.h"
@@ -38,6 +39,9 @@ namespace cma{
     /* Split a string with some delimiter (comma) */
     void split(const std::string &s, char delim, std::vector<std::string> &elems);
 
+    /* Match a name against a pattern with shell-style wildcards ('*' and '?') */
+    bool wildcardMatch( const std::string& pattern, const std::string& name );
+
     /* Get the list of Branches in TTree / TTrees in file */
     void getListOfBranches( TTree* tree, std::vector<std::string>& treeBranches );
     void getListOfKeys( TFile* file, std::vector<std::string> &fileKeys );
@@ -52,6 +56,12 @@ namespace cma{
     /* Convert string to boolean */
     bool str2bool( const std::string value );
 
+    /* Convert string to a number -- false if the (whole) string is not a number */
+    bool str2number( const std::string& value, int& number );
+    bool str2number( const std::string& value, long long& number );
+    bool str2number( const std::string& value, float& number );
+    bool str2number( const std::string& value, double& number );
+
     /* Convert vector of strings into a string of comma-separated elements */
     std::string vectorToStr( const std::vector<std::string> &vec );
 
@@ -59,6 +69,25 @@ namespace cma{
     unsigned int setRandomNumberSeeds(const Lepton& lepton, const Lepton& antiLepton, 
                                       const Jet& jet1, const Jet& jet2);
 
+    /* Counter-based random numbers: number 'counter' of the stream 'seed'
+       (no state -- the same value for any order of the calls, e.g., in vectorised loops) */
+    inline unsigned long long mix64( unsigned long long z ){
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    inline double uniform( const unsigned long long seed, const unsigned long long counter ){
+        /* uniform in (0,1) */
+        unsigned long long z = mix64( mix64(seed + 0x9E3779B97F4A7C15ULL) ^ counter );
+        return ((z >> 11) + 0.5) * (1.0/9007199254740992.0);
+    }
+    inline double gaussian( const unsigned long long seed, const unsigned long long counter ){
+        /* unit Gaussian (Box-Muller with numbers 2*counter & 2*counter+1) */
+        double u1 = uniform( seed, 2*counter );
+        double u2 = uniform( seed, 2*counter+1 );
+        return std::sqrt(-2.*std::log(u1)) * std::cos(2.*M_PI*u2);
+    }
+
     /* DeltaR matching of TLorentzVectors (default deltaR=0.75) */
     bool deltaRMatch( const TLorentzVector &particle1, const TLorentzVector &particle2, const double deltaR=0.75 );
 
@@ -12,6 +12,7 @@
 #include "Analysis/CyMiniAna/interface/tools.h"
 #include "Analysis/CyMiniAna/interface/configuration.h"
 #include "Analysis/CyMiniAna/interface/physicsObjects.h"
+#include "Analysis/CyMiniAna/interface/etaPhiGrid.h"
 
 class truthMatching {
   public:
@@ -22,14 +23,20 @@ class truthMatching {
     // Default - so we can clean up;
     virtual ~truthMatching();
     void initialize();
-    void setTruthPartons(const std::vector<Parton> truth_partons);
+    void setTruthPartons(const std::vector<Parton>& truth_partons);   // not copied: must outlive the matching
     void setTruthTops(const std::vector<TruthTop> truth_tops);
+    void setTruthJets(const std::vector<Jet>& truth_jets);            // not copied: must outlive the matching
+
+    // index of the truth record: parent/child arrays & the W', VLQ, and leptonic W decays
+    void buildDecayGraph(const std::vector<int>& pdgId, const std::vector<int>& parent_idx,
+                         const std::vector<int>& child0_idx, const std::vector<int>& child1_idx);
+    const TruthDecayGraph& decayGraph() const {return m_graph;}
 
     void buildWprimeSystem();
     TruthWprime wprime(){ return m_truth_wp;}
 
     void matchJetToTruthTop(Jet& jet);
-    void matchJetToTruthJet(Jet& jet, const std::vector<Jet>& truth_jets);
+    void matchJetToTruthJet(Jet& jet);
 
     void parton_match(const Parton& p, Jet& r, double dR=-1.0);
 
@@ -38,8 +45,16 @@ class truthMatching {
     configuration *m_config;
 
     TruthWprime m_truth_wp;
+    TruthDecayGraph m_graph;
     std::vector<TruthTop> m_truth_tops;
-    std::vector<Parton> m_truth_partons;
+    const std::vector<Parton>* m_truth_partons;
+    const std::vector<Jet>* m_truth_jets;
+
+    // (eta,phi) grids of the truth partons & jets: only the nearby ones are compared to each jet
+    etaPhiGrid m_partonGrid;
+    etaPhiGrid m_truthJetGrid;
+    bool m_partonGridBuilt;        // built for the current partons (on the first match of the event)
+    std::vector<int> m_candidates;
 };
 
 #endif
@@ -20,20 +20,30 @@ class WprimeReco {
     Wprime execute();
     void getWprime( const Jet& j0, const Jet& j1 );
 
+    // all hypotheses that pass the pruning, ranked by |energy asymmetry| (wprimeRecoMaxJets>0)
+    const std::vector<Wprime>& candidates() const {return m_candidates;}
+
     void setLepton(Lepton& lepton);
     void setBtagJets(std::vector<int> bjets);
     void setJets(std::vector<Jet>& jets);
     void setNeutrino(Neutrino& nu);
+    void setNeutrinos(const std::vector<Neutrino>& neutrinos);   // several neutrino solutions (combinatorics)
 
   protected:
 
+    void combinatorics();
+
     configuration *m_config;
+    unsigned int m_maxJets;
+    float m_maxAsymmetry;
 
     Lepton m_lepton;
     Neutrino m_neutrino;
+    std::vector<Neutrino> m_neutrinos;
     std::vector<Jet> m_jets;
     std::vector<int> m_btag_jets;
     Wprime m_wprime;
+    std::vector<Wprime> m_candidates;
 };
 
 #endif
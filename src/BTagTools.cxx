@@ -9,13 +9,21 @@ Texas A&M University
 -----
 
 Interface with btagging tools to get SFs and uncertainties
+- The SFs are tabulated from the BTagCalibrationReader when the tool is created
+  and checked against it (the reader is used if they differ)
+- Event weight (method 1a) from the SFs & the MC efficiencies of all WPs
 */
 #include "Analysis/CyMiniAna/interface/BTagTools.h"
 
 
-BTagTools::BTagTools(const bool& isBoosted, const std::string& data_path) :
+BTagTools::BTagTools(const bool& isBoosted, const std::string& data_path, const std::string& efficiency_file) :
   m_isBoosted(isBoosted),
-  m_data_path(data_path){
+  m_data_path(data_path),
+  m_systs({"central","up","down"}),
+  m_useTable(true),
+  m_ptStep(1.0),
+  m_tolerance(1e-4),
+  m_minEfficiency(1e-4){
     /* Setup btagging tools
        CSV files downloaded on 31Jan2018 from
         https://twiki.cern.ch/twiki/bin/view/CMS/BtagRecommendation80XReReco#Boosted_event_topologies
@@ -30,53 +38,446 @@ BTagTools::BTagTools(const bool& isBoosted, const std::string& data_path) :
         measurement_type = "mujets";
     }
 
+    m_discriminant[kLoose]  = m_CSVv2L;
+    m_discriminant[kMedium] = m_CSVv2M;
+    m_discriminant[kTight]  = m_CSVv2T;
 
-    m_btag_reader = new BTagCalibrationReader(BTagEntry::OP_LOOSE,"central",{"up", "down"});
-    m_btag_reader->load(*m_calib,             // calibration instance
-                        BTagEntry::FLAV_B,    // btag flavour
-                        measurement_type);    // measurement type
+    for (unsigned int w=0; w<kNWPs; w++){
+        WorkingPoint wp = static_cast<WorkingPoint>(w);
+        m_btag_readers[wp] = new BTagCalibrationReader(static_cast<BTagEntry::OperatingPoint>(wp),"central",{"up", "down"});
+        m_btag_readers[wp]->load(*m_calib,             // calibration instance
+                                 BTagEntry::FLAV_B,    // btag flavour
+                                 measurement_type);    // measurement type
+        m_btag_readers[wp]->load(*m_calib, BTagEntry::FLAV_C,    measurement_type);
+        m_btag_readers[wp]->load(*m_calib, BTagEntry::FLAV_UDSG, "incl");
+
+        // lookup tables
+        tabulate(wp, BTagEntry::FLAV_B,    measurement_type);
+        tabulate(wp, BTagEntry::FLAV_C,    measurement_type);
+        tabulate(wp, BTagEntry::FLAV_UDSG, "incl");
+
+        m_useWP[wp] = true;
+        for (unsigned int f=0; f<kNFlavors; f++)
+            m_useWP[wp] = m_useWP[wp] && !m_tables[wp][f].etaEdges.empty();
+    }
+    validate();
+
+    // efficiencies for the event weight
+    loadEfficiencies(efficiency_file);
 }
 
 BTagTools::~BTagTools() {
     delete m_calib;
-    delete m_btag_reader;
+    for (unsigned int w=0; w<kNWPs; w++)
+        delete m_btag_readers[w];
+}
+
+
+BTagEntry::JetFlavor BTagTools::flavor(const Jet& jet) const{
+    /* Flavor of the calibration */
+    if (jet.true_flavor==5)      return BTagEntry::FLAV_B;
+    else if (jet.true_flavor==4) return BTagEntry::FLAV_C;
+    return BTagEntry::FLAV_UDSG;
+}
+
+
+void BTagTools::tabulate(const WorkingPoint wp, const BTagEntry::JetFlavor flavor, const std::string& measurement_type){
+    /* Tabulate the SFs of one WP & flavor from the reader
+       - eta & pT bins from the edges of the calibration entries
+       - pT bins are split into cells of at most m_ptStep (smaller where the SF is
+         curved); in each cell the SF is a line through the values just above the
+         lower edge & at the upper edge (the reader uses ptMin < pT <= ptMax)
+    */
+    SFTable& table = m_tables[wp][flavor];
+    BTagCalibrationReader* reader = m_btag_readers[wp];
+    table = {};
+    table.absEta = true;
+
+    std::vector<float> ptEdges;
+    for (const auto& syst : m_systs){
+        const auto& entries = m_calib->getEntries( BTagEntry::Parameters(static_cast<BTagEntry::OperatingPoint>(wp),measurement_type,syst) );
+        for (const auto& entry : entries){
+            if (entry.params.jetFlavor!=flavor) continue;
+            if (entry.params.etaMin<0) table.absEta = false;
+            table.etaEdges.push_back(entry.params.etaMin);
+            table.etaEdges.push_back(entry.params.etaMax);
+            ptEdges.push_back(entry.params.ptMin);
+            ptEdges.push_back(entry.params.ptMax);
+        }
+    }
+
+    if (ptEdges.empty()){
+        cma::WARNING("BTAGTOOLS : No calibration for WP "+std::to_string(wp)+" & flavor "+std::to_string(flavor)+" ("+measurement_type+")");
+        table.etaEdges.clear();
+        return;
+    }
+
+    for (auto* edges : {&table.etaEdges, &ptEdges}){
+        std::sort( edges->begin(), edges->end() );
+        edges->erase( std::unique(edges->begin(),edges->end()), edges->end() );
+    }
+
+    unsigned int nEta = table.etaEdges.size()-1;
+    std::vector<float> etaCenters;
+    for (unsigned int e=0; e<nEta; e++)
+        etaCenters.push_back( 0.5*(table.etaEdges[e]+table.etaEdges[e+1]) );
+
+    // largest difference between the line & the SF in the middle of a cell
+    auto lineError = [&](const float low, const float high){
+        double error(0.);
+        float pt1 = low + 1e-3*(high-low);
+        float mid = 0.5*(low+high);
+        for (const auto& eta : etaCenters){
+            for (const auto& syst : m_systs){
+                double sf1 = reader->eval_auto_bounds(syst, flavor, eta, pt1);
+                double sf2 = reader->eval_auto_bounds(syst, flavor, eta, high);
+                double sfm = reader->eval_auto_bounds(syst, flavor, eta, mid);
+                error = std::max( error, std::abs(sfm - sf1 - (sf2-sf1)*(mid-pt1)/(high-pt1)) );
+            }
+        }
+        return error;
+    };
+
+    // cells are halved where the SF is too curved (e.g., 1/pT^2 terms at low pT)
+    for (unsigned int i=0, size=ptEdges.size(); i+1<size; i++){
+        unsigned int nCells = std::max( 1.f, std::ceil( (ptEdges[i+1]-ptEdges[i])/m_ptStep ) );
+        for (unsigned int c=0; c<nCells; c++){
+            std::vector<std::pair<float,float>> cells = { {ptEdges[i] + c*(ptEdges[i+1]-ptEdges[i])/nCells,
+                                                           ptEdges[i] + (c+1)*(ptEdges[i+1]-ptEdges[i])/nCells} };
+            while (!cells.empty()){
+                auto cell = cells.back();
+                cells.pop_back();
+                float mid = 0.5*(cell.first+cell.second);
+                if (cell.second-cell.first > 1e-2 && lineError(cell.first,cell.second) > 0.1*m_tolerance){
+                    cells.push_back( {mid,cell.second} );
+                    cells.push_back( {cell.first,mid} );
+                }
+                else
+                    table.ptNodes.push_back( cell.first );
+            }
+        }
+    }
+    table.ptNodes.push_back( ptEdges.back() );
+
+    unsigned int nCells = table.ptNodes.size()-1;
+    table.values.resize( nEta*nCells*kNSysts*2 );
+
+    for (unsigned int e=0; e<nEta; e++){
+        float eta = etaCenters[e];
+        auto bounds = reader->min_max_pt(flavor,eta);
+        table.ptMin.push_back(bounds.first);
+        table.ptMax.push_back(bounds.second);
+
+        for (unsigned int c=0; c<nCells; c++){
+            float low  = table.ptNodes[c];
+            float high = table.ptNodes[c+1];
+            float pt1  = low + 1e-3*(high-low);
+            for (unsigned int s=0; s<kNSysts; s++){
+                double sf1 = reader->eval_auto_bounds(m_systs[s], flavor, eta, pt1);
+                double sf2 = reader->eval_auto_bounds(m_systs[s], flavor, eta, high);
+                double slope = (sf2-sf1) / (high-pt1);
+
+                double* v = &table.values[ ((e*nCells + c)*kNSysts + s)*2 ];
+                v[0] = sf1 - slope*(pt1-low);
+                v[1] = slope;
+            }
+        }
+    }
+
+    cma::DEBUG("BTAGTOOLS : WP "+std::to_string(wp)+" & flavor "+std::to_string(flavor)+" tabulated in "+std::to_string(nEta)+
+               " eta bins & "+std::to_string(nCells)+" pT cells");
+
+    return;
+}
+
+
+void BTagTools::validate(){
+    /* Compare the tables with the readers (random points, including out-of-bounds pT & eta) */
+    double maxDiff(0.);
+    const unsigned long long seed(0xB7A6);
+    const unsigned int nPoints(2000);
+
+    for (unsigned int w=0; w<kNWPs; w++){
+        WorkingPoint wp = static_cast<WorkingPoint>(w);
+        if (!m_useWP[wp]) continue;
+        const BTagCalibrationReader* reader = m_btag_readers[wp];
+
+        for (unsigned int f=0; f<kNFlavors; f++){
+            BTagEntry::JetFlavor flav = static_cast<BTagEntry::JetFlavor>(f);
+            for (unsigned int i=0; i<nPoints; i++){
+                unsigned long long counter = 2*((w*kNFlavors + f)*nPoints + i);
+                float eta = -2.6 + 5.2*cma::uniform(seed,counter);
+                float pt  = 10.*std::pow(150.,cma::uniform(seed,counter+1));   // 10 - 1500 GeV
+
+                BTagSF sf = lookup(wp,flav,eta,pt);
+                maxDiff = std::max( maxDiff, std::abs(sf.central - reader->eval_auto_bounds("central",flav,eta,pt)) );
+                maxDiff = std::max( maxDiff, std::abs(sf.up   - reader->eval_auto_bounds("up",flav,eta,pt)) );
+                maxDiff = std::max( maxDiff, std::abs(sf.down - reader->eval_auto_bounds("down",flav,eta,pt)) );
+            }
+        }
+    }
+
+    if (maxDiff>m_tolerance || std::isnan(maxDiff)){
+        cma::WARNING("BTAGTOOLS : Lookup tables differ from the reader by "+std::to_string(maxDiff)+", using the reader");
+        m_useTable = false;
+    }
+    else
+        cma::DEBUG("BTAGTOOLS : Lookup tables agree with the reader within "+std::to_string(maxDiff));
+
+    return;
+}
+
+
+BTagSF BTagTools::lookup(const WorkingPoint wp, const BTagEntry::JetFlavor flavor, const float eta, const float pt) const{
+    /* SF from the tables (same bounds as BTagCalibrationReader::eval_auto_bounds) */
+    const SFTable& table = m_tables[wp][flavor];
+    float absEta = (table.absEta) ? std::abs(eta) : eta;
+
+    if (!m_useTable || table.etaEdges.empty() || absEta<table.etaEdges.front() || absEta>table.etaEdges.back()){
+        BTagSF sf;
+        sf.central = m_btag_readers[wp]->eval_auto_bounds("central", flavor, eta, pt);
+        sf.up      = m_btag_readers[wp]->eval_auto_bounds("up",      flavor, eta, pt);
+        sf.down    = m_btag_readers[wp]->eval_auto_bounds("down",    flavor, eta, pt);
+        return sf;
+    }
+
+    unsigned int nEta   = table.etaEdges.size()-1;
+    unsigned int nCells = table.ptNodes.size()-1;
+    unsigned int e = std::upper_bound( table.etaEdges.begin(), table.etaEdges.end(), absEta ) - table.etaEdges.begin();
+    e = std::min( std::max(e,1u), nEta ) - 1;
+
+    // outside of the pT range: SF at the edge, twice the uncertainty
+    float ptEval(pt);
+    bool outOfBounds(false);
+    if (pt < table.ptMin[e]){
+        ptEval = table.ptMin[e] + .0001;
+        outOfBounds = true;
+    }
+    else if (pt > table.ptMax[e]){
+        ptEval = table.ptMax[e] - .0001;
+        outOfBounds = true;
+    }
+
+    unsigned int c = std::lower_bound( table.ptNodes.begin(), table.ptNodes.end(), ptEval ) - table.ptNodes.begin();
+    c = std::min( std::max(c,1u), nCells ) - 1;
+
+    const double* v = &table.values[ (e*nCells + c)*kNSysts*2 ];
+    double dpt = ptEval - table.ptNodes[c];
+
+    BTagSF sf;
+    sf.central = v[0] + v[1]*dpt;
+    sf.up      = v[2] + v[3]*dpt;
+    sf.down    = v[4] + v[5]*dpt;
+    if (outOfBounds){
+        sf.up   = sf.central + 2.*(sf.up - sf.central);
+        sf.down = sf.central + 2.*(sf.down - sf.central);
+    }
+
+    return sf;
 }
 
 
 std::map<std::string,double> BTagTools::execute(const Jet& jet) const{
     /* Get the SF */
-    BTagEntry::JetFlavor jetFlav;
-    if (jet.true_flavor==5)      jetFlav = BTagEntry::FLAV_B;
-    else if (jet.true_flavor==4) jetFlav = BTagEntry::FLAV_C;
-    else jetFlav = BTagEntry::FLAV_UDSG;
-
-    double btagSF    = m_btag_reader->eval_auto_bounds("central", jetFlav /*BTagEntry::FLAV_B*/, jet.p4.Eta(), jet.p4.Pt());
-    double btagSF_UP = m_btag_reader->eval_auto_bounds("up",      jetFlav /*BTagEntry::FLAV_B*/, jet.p4.Eta(), jet.p4.Pt());
-    double btagSF_DN = m_btag_reader->eval_auto_bounds("down",    jetFlav /*BTagEntry::FLAV_B*/, jet.p4.Eta(), jet.p4.Pt());
+    BTagSF sf = lookup( kLoose, flavor(jet), jet.p4.Eta(), jet.p4.Pt() );
 
     std::map<std::string,double> SFs = {
-                 {"central",btagSF},
-                 {"up",     btagSF_UP},
-                 {"down",   btagSF_DN},
+                 {"central",sf.central},
+                 {"up",     sf.up},
+                 {"down",   sf.down},
     };
 
     return SFs;
 }
 
 
-float BTagTools::getBTagSF(const std::vector<Jet>& jets) const{
+void BTagTools::execute(const std::vector<Jet>& jets, std::vector<BTagSF>& SFs, const WorkingPoint wp) const{
+    /* Get the SFs of all jets */
+    SFs.resize( jets.size() );
+    for (unsigned int i=0, size=jets.size(); i<size; i++)
+        SFs[i] = lookup( wp, flavor(jets[i]), jets[i].p4.Eta(), jets[i].p4.Pt() );
+
+    return;
+}
+
+
+void BTagTools::loadEfficiencies(const std::string& efficiency_file){
+    /* Copy the efficiency maps into flat tables (WPs without maps are not used in getBTagSF) */
+    if (efficiency_file.size()<1){
+        for (unsigned int w=0; w<kNWPs; w++) m_useWP[w] = false;
+        return;
+    }
+
+    TFile* file = TFile::Open(efficiency_file.c_str());
+    if (!file || file->IsZombie()){
+        cma::ERROR("BTAGTOOLS : Cannot open b-tagging efficiency file "+efficiency_file);
+        exit(EXIT_FAILURE);
+    }
+
+    const std::string flavors[kNFlavors] = {"b","c","udsg"};     // BTagEntry::JetFlavor
+    const std::string wps[kNWPs] = {"L","M","T"};
+
+    for (unsigned int w=0; w<kNWPs; w++){
+        for (unsigned int f=0; f<kNFlavors; f++){
+            EfficiencyMap& map = m_efficiencies[w][f];
+            map = {};
+
+            std::string name = flavors[f]+"_"+wps[w];
+            TH2* hist = dynamic_cast<TH2*>( file->Get(name.c_str()) );
+            if (!hist){
+                if (m_useWP[w]) cma::WARNING("BTAGTOOLS : No efficiency "+name+" in "+efficiency_file+", not using WP "+wps[w]);
+                m_useWP[w] = false;
+                continue;
+            }
+
+            unsigned int nPt  = hist->GetNbinsX();
+            unsigned int nEta = hist->GetNbinsY();
+            for (unsigned int i=1; i<=nPt+1; i++)  map.ptEdges.push_back( hist->GetXaxis()->GetBinLowEdge(i) );
+            for (unsigned int j=1; j<=nEta+1; j++) map.etaEdges.push_back( hist->GetYaxis()->GetBinLowEdge(j) );
+            map.absEta = (map.etaEdges.front()>=0);
+
+            map.values.resize(nPt*nEta);
+            for (unsigned int i=0; i<nPt; i++){
+                for (unsigned int j=0; j<nEta; j++){
+                    double eff = hist->GetBinContent(i+1,j+1);
+                    if (!(eff>=m_minEfficiency)) eff = m_minEfficiency;     // also NaN
+                    map.values[i*nEta+j] = std::min( eff, 1-m_minEfficiency );
+                }
+            }
+        }
+    }
+
+    file->Close();
+    delete file;
+
+    orderEfficiencies();
+
+    return;
+}
+
+
+void BTagTools::orderEfficiencies(){
+    /* A tighter WP must have a lower efficiency in every bin, otherwise the probability
+       of a jet between two WPs (eff_loose - eff_tight) in getBTagSF is not positive.
+       Maps from limited MC statistics can violate this: such bins of the tighter WP
+       are set just below the looser WP (and counted).
+       The maps of all WPs of a flavor need the same binning.
+    */
+    const std::string flavors[kNFlavors] = {"b","c","udsg"};
+    const std::string wps[kNWPs] = {"L","M","T"};
+
+    for (unsigned int f=0; f<kNFlavors; f++){
+        int looser(-1);
+        for (unsigned int w=0; w<kNWPs; w++){
+            if (!m_useWP[w]) continue;
+            if (looser<0){
+                looser = w;
+                continue;
+            }
+
+            const EfficiencyMap& loose = m_efficiencies[looser][f];
+            EfficiencyMap& tight = m_efficiencies[w][f];
+            if (loose.absEta!=tight.absEta || loose.ptEdges!=tight.ptEdges || loose.etaEdges!=tight.etaEdges){
+                cma::ERROR("BTAGTOOLS : Efficiencies "+flavors[f]+"_"+wps[looser]+" & "+flavors[f]+"_"+wps[w]+
+                           " have different bins; cannot check that the tighter WP has the lower efficiency");
+                exit(EXIT_FAILURE);
+            }
+
+            unsigned int nReordered(0);
+            for (unsigned int b=0, size=tight.values.size(); b<size; b++){
+                float maxEfficiency = loose.values[b]*(1-m_minEfficiency);
+                if (tight.values[b] > maxEfficiency){
+                    tight.values[b] = maxEfficiency;
+                    nReordered++;
+                }
+            }
+            if (nReordered>0)
+                cma::WARNING("BTAGTOOLS : "+std::to_string(nReordered)+" of "+std::to_string(tight.values.size())+
+                             " bins of "+flavors[f]+"_"+wps[w]+" have a higher efficiency than "+flavors[f]+"_"+wps[looser]+
+                             ", set just below it");
+
+            looser = w;
+        }
+    }
+
+    return;
+}
+
+
+double BTagTools::efficiency(const WorkingPoint wp, const BTagEntry::JetFlavor flavor, const float eta, const float pt) const{
+    /* MC efficiency (under/overflow -> first/last bin) */
+    const EfficiencyMap& map = m_efficiencies[wp][flavor];
+    float y = (map.absEta) ? std::abs(eta) : eta;
+
+    unsigned int nPt  = map.ptEdges.size()-1;
+    unsigned int nEta = map.etaEdges.size()-1;
+    unsigned int i = std::upper_bound( map.ptEdges.begin(), map.ptEdges.end(), pt ) - map.ptEdges.begin();
+    unsigned int j = std::upper_bound( map.etaEdges.begin(), map.etaEdges.end(), y ) - map.etaEdges.begin();
+    i = std::min( std::max(i,1u), nPt ) - 1;
+    j = std::min( std::max(j,1u), nEta ) - 1;
+
+    return map.values[i*nEta+j];
+}
+
+
+BTagSF BTagTools::getBTagSF(const std::vector<Jet>& jets) const{
     /* Calculate the event weight due to b-tagging 
        Method 1a: https://twiki.cern.ch/twiki/bin/viewauth/CMS/BTagSFMethods#1a_Event_reweighting_using_scale
        - accessed on 7 Feb 2018
        Efficiencies will be calculated following:
          https://github.com/rappoccio/usercode/blob/Dev_53x/EDSHyFT/plugins/BTaggingEffAnalyzer.cc
          https://github.com/rappoccio/usercode/blob/Dev_53x/EDSHyFT/test/bTaggingEfficiency/README.txt
+
+       Several WPs: a jet that passes WP i but not the next (tighter) WP j contributes
+         P(MC)   *= eff_i - eff_j
+         P(DATA) *= SF_i*eff_i - SF_j*eff_j
+       (eff = 1 & SF = 1 below the loosest WP, eff = 0 above the tightest WP)
+       The up/down variations (all jets shifted together) are calculated in the same loop.
     */
-    float weight(1.0);
-    float pMC(1.0);
-    float pDATA(1.0);
+    BTagSF weight = {1.0, 1.0, 1.0};
+    double pMC(1.0);
+    double pDATA[3] = {1.0, 1.0, 1.0};       // central, up, down
+
+    for (const auto& jet : jets){
+        BTagEntry::JetFlavor flav = flavor(jet);
+        float eta = jet.p4.Eta();
+        float pt  = jet.p4.Pt();
+
+        // tightest WP that is passed & the next tighter one
+        int passed(-1);
+        int next(-1);
+        for (unsigned int w=0; w<kNWPs; w++){
+            if (!m_useWP[w]) continue;
+            if (jet.bdisc > m_discriminant[w])
+                passed = w;
+            else{
+                next = w;
+                break;
+            }
+        }
+        if (passed<0 && next<0) continue;     // no WPs
+
+        double eff_passed(1.), eff_next(0.);
+        BTagSF sf_passed = {1.,1.,1.};
+        BTagSF sf_next   = {0.,0.,0.};
+        if (passed>=0){
+            eff_passed = efficiency( static_cast<WorkingPoint>(passed), flav, eta, pt );
+            sf_passed  = lookup( static_cast<WorkingPoint>(passed), flav, eta, pt );
+        }
+        if (next>=0){
+            eff_next = efficiency( static_cast<WorkingPoint>(next), flav, eta, pt );
+            sf_next  = lookup( static_cast<WorkingPoint>(next), flav, eta, pt );
+        }
+
+        pMC      *= eff_passed - eff_next;   // > 0: the efficiencies are ordered (orderEfficiencies)
+        pDATA[0] *= sf_passed.central*eff_passed - sf_next.central*eff_next;
+        pDATA[1] *= sf_passed.up*eff_passed      - sf_next.up*eff_next;
+        pDATA[2] *= sf_passed.down*eff_passed    - sf_next.down*eff_next;
+    }
 
-    weight = pDATA/pMC;
+    weight.central = pDATA[0]/pMC;
+    weight.up      = pDATA[1]/pMC;
+    weight.down    = pDATA[2]/pMC;
 
     return weight;
 }
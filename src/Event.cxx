@@ -21,7 +21,12 @@ Event::Event( TTreeReader &myReader, configuration &cmaConfig ) :
   m_ttree(myReader),
   m_treeName("SetMe"),
   m_fileName("SetMe"),
-  m_DNN(0.0){
+  m_DNN(0.0),
+  m_truthDecoded(false),
+  m_truthGraphBuilt(false),
+  m_systWeightsValid(false),
+  m_objectsBuilt(false),
+  m_weightsBuilt(false){
     m_treeName = m_ttree.GetTree()->GetName();      // for systematics
     m_fileName = m_config->filename();              // for accessing file metadata
 
@@ -36,11 +41,15 @@ Event::Event( TTreeReader &myReader, configuration &cmaConfig ) :
     m_useWprime    = m_config->useWprime();         // use reconstructed Wprime in analysis
 
     m_neutrinoReco  = m_config->neutrinoReco();      // reconstruct neutrino
+    m_kinematicFit       = (m_config->neutrinoRecoMethod().compare("sampling")!=0);
+    m_kinematicFitMinuit = (m_config->neutrinoRecoMethod().compare("minuit")==0);
+    m_dileptonReco  = m_config->dileptonReco();      // reconstruct both neutrinos in dilepton events
     m_wprimeReco    = m_config->wprimeReco();        // reconstruct Wprime
     m_DNNinference  = m_config->DNNinference();      // use DNN to predict values
     m_DNNtraining   = m_config->DNNtraining();       // load DNN features (save/use later)
     m_getDNN = (m_DNNinference || m_DNNtraining);
     m_useDNN = m_config->useDNN();                   // use DNN in analysis
+    m_calcBTagSF = (m_isMC && m_useJets && m_config->btagEfficiencies().size()>0);   // b-tagging event weight
 
     // b-tagging working points
     m_CSVv2L  = m_config->CSVv2L();
@@ -92,6 +101,8 @@ Event::Event( TTreeReader &myReader, configuration &cmaConfig ) :
       m_jet_area     = new TTreeReaderValue<std::vector<float>>(m_ttree,"AK4area");
       m_jet_uncorrPt = new TTreeReaderValue<std::vector<float>>(m_ttree,"AK4uncorrPt");
       m_jet_uncorrE  = new TTreeReaderValue<std::vector<float>>(m_ttree,"AK4uncorrE");
+      if (m_calcBTagSF)
+        m_jet_hadronFlavour = new TTreeReaderValue<std::vector<int>>(m_ttree,"AK4hadronFlavour");
     }
 
     if (m_useLargeRJets){
@@ -218,6 +229,15 @@ Event::Event( TTreeReader &myReader, configuration &cmaConfig ) :
 */
     } // end isMC
 
+    m_normalization = (m_isMC) ? sampleNormalization( ss ) : 1.0;
+    std::fill( m_weightComponents, m_weightComponents+kNumberOfWeightComponents, 1.0 );
+
+    // weight systematics (only read when they are used)
+    m_weightSystematics.clear();
+    m_mapOfWeightSystematics.clear();
+    if (m_isMC && m_config->calcWeightSystematics())
+        initialize_eventWeights();
+
 
     // Truth matching tool
     m_truthMatchingTool = new truthMatching(cmaConfig);
@@ -230,7 +250,14 @@ Event::Event( TTreeReader &myReader, configuration &cmaConfig ) :
 
     // Kinematic reconstruction algorithms
     m_neutrinoRecoTool = new NeutrinoReco(cmaConfig);
+    m_kinematicFitTool = new KinematicFit(cmaConfig);
+    m_dileptonRecoTool = new DileptonTtbarReco(cmaConfig);
     m_wprimeTool = new WprimeReco(cmaConfig);
+
+    // b-tagging SFs & event weight
+    m_BTagTool = (m_calcBTagSF) ? new BTagTools(false,"data/",m_config->btagEfficiencies()) : nullptr;
+    m_weight_btag_UP   = 1.0;
+    m_weight_btag_DOWN = 1.0;
 } // end constructor
 
 Event::~Event() {}
@@ -252,6 +279,8 @@ void Event::initialize_eventWeights(){
     for (const auto& nom_syst : m_listOfWeightSystematics){
         if (!m_config->useLeptons() && nom_syst.find("leptonSF")!=std::string::npos)
             continue;
+        if (m_calcBTagSF && (nom_syst.compare("weight_bTagSF_UP")==0 || nom_syst.compare("weight_bTagSF_DOWN")==0))
+            continue;       // calculated with BTagTools
         m_weightSystematicsFloats[nom_syst] = new TTreeReaderValue<float>(m_ttree,nom_syst.c_str());
     }
 
@@ -259,6 +288,42 @@ void Event::initialize_eventWeights(){
     for (const auto& syst : mapWeightSystematics)
         m_weightSystematicsVectorFloats[syst.first] = new TTreeReaderValue<std::vector<float>>(m_ttree,syst.first.c_str());
 
+    // table of the systematics: type & scale factor resolved from the name once
+    std::vector<std::string> names( m_listOfWeightSystematics );
+    for (const auto& syst : mapWeightSystematics){
+        for (unsigned int el=0; el<syst.second; el++)
+            names.push_back( std::to_string(el)+"_"+syst.first );
+    }
+
+    for (const auto& name : names){
+        WeightSystematic syst;
+        syst.value  = nullptr;
+        syst.factor = nullptr;
+
+        if (name.find("pileup")!=std::string::npos)        syst.type = kWeightPileup;
+        else if (name.find("leptonSF")!=std::string::npos) syst.type = kWeightLeptonSF;
+        else if (name.find("bTagSF")!=std::string::npos)   syst.type = kWeightBTagSF;
+        else{
+            cma::WARNING("EVENT : Weight systematic "+name+" is inconsistent with the CyMiniAna options of ");
+            cma::WARNING("EVENT :     nominal, jvt, pileup, leptonSF, and bTagSF. ");
+            cma::WARNING("EVENT : Using a weight of 1.0. ");
+            syst.type = kWeightUnknown;
+        }
+
+        // pileup & leptonSF are scaled by their branch (b-tagging eigenvectors are not applied yet)
+        auto value = m_weightSystematicsFloats.find(name);
+        if (value!=m_weightSystematicsFloats.end() && syst.type!=kWeightBTagSF)
+            syst.value = value->second;
+
+        // b-tagging SF variations from BTagTools
+        if (m_calcBTagSF && name.compare("weight_bTagSF_UP")==0)   syst.factor = &m_weight_btag_UP;
+        if (m_calcBTagSF && name.compare("weight_bTagSF_DOWN")==0) syst.factor = &m_weight_btag_DOWN;
+
+        m_mapOfWeightSystematics[name] = m_weightSystematics.size();
+        m_weightSystematics.push_back( syst );
+    }
+    m_systWeights.assign( m_weightSystematics.size(), 1.0 );
+
     return;
 }
 
@@ -293,7 +358,6 @@ void Event::clear(){
 
     m_btag_jets.clear();
     m_btag_jets_default.clear();
-    m_weight_btag_default = 1.0;
     m_nominal_weight = 1.0;
 
     m_HT = 0;
@@ -313,21 +377,33 @@ void Event::execute(Long64_t entry){
     // Reset many event-level values
     clear();
 
-    // Get the event weights (for cutflow & histograms)
-    initialize_weights();
-    cma::DEBUG("EVENT : Setup weights ");
-
     // Filters
     initialize_filters();
 
     // Triggers
     initialize_triggers();
 
-    // Truth Information
-    if (m_useTruth){
-        initialize_truth();
-        cma::DEBUG("EVENT : Setup truth information ");
-    }
+    // Truth Information -- decoded when it is first needed (e.g., after the event passes a selection)
+    m_truthDecoded = false;
+    m_truthGraphBuilt = false;
+    if (m_useTruth) m_truthMatchingTool->initialize();
+
+    // Physics objects & weights -- built when they are first needed
+    // (events that fail the filters or triggers don't need them)
+    m_objectsBuilt = false;
+    m_weightsBuilt = false;
+
+    cma::DEBUG("EVENT : Setup Event ");
+
+    return;
+}
+
+
+void Event::buildObjects(){
+    /* Setup the physics objects, weights & kinematic reconstruction of this event
+       (called by the event selection when a cut needs them, and for events that pass) */
+    if (m_objectsBuilt) return;
+    m_objectsBuilt = true;
 
     // Jets
     if (m_useJets){
@@ -347,6 +423,9 @@ void Event::execute(Long64_t entry){
         cma::DEBUG("EVENT : Setup leptons ");
     }
 
+    // Get the event weights (for cutflow & histograms) -- b-tagging weight needs the jets
+    buildWeights();
+
     // Get some kinematic variables (MET, HT, ST)
     initialize_kinematics();
     cma::DEBUG("EVENT : Setup kinematic variables ");
@@ -363,12 +442,30 @@ void Event::execute(Long64_t entry){
         wprimeReconstruction();
     }
 
-   if (m_useNeutrinos){
-       deepLearningPrediction();   // store features in map (easily access later)
-       cma::DEBUG("EVENT : Deep learning ");
+    if (m_useNeutrinos){
+        deepLearningPrediction();   // store features in map (easily access later)
+        cma::DEBUG("EVENT : Deep learning ");
     }
 
-    cma::DEBUG("EVENT : Setup Event ");
+    cma::DEBUG("EVENT : Setup objects ");
+
+    return;
+}
+
+
+void Event::buildWeights(){
+    /* Event weights (for the cutflow & histograms)
+       -- the b-tagging weight needs the jets: build the physics objects first */
+    if (m_weightsBuilt) return;
+
+    if (m_isMC && m_calcBTagSF && !m_objectsBuilt){
+        buildObjects();       // calls buildWeights() after the jets are setup
+        return;
+    }
+
+    m_weightsBuilt = true;
+    initialize_weights();
+    cma::DEBUG("EVENT : Setup weights ");
 
     return;
 }
@@ -409,58 +506,21 @@ void Event::initialize_triggers(){
 }
 
 
-void Event::initialize_truth(){
-    /* Setup truth information (MC and physics objects) */
+void Event::initialize_truth() const{
+    /* Setup truth information (MC and physics objects) -- once per event, when it is first needed */
     m_truth_partons.clear();
+    m_truthDecoded = true;
+    if (!m_useTruth) return;
 
     unsigned int nPartons( (*m_mc_pt)->size() );
     cma::DEBUG("EVENT : N Partons = "+std::to_string(nPartons));
 
     // loop over truth partons
-    unsigned int p_idx(0);
-    for (unsigned int i=0; i<nPartons; i++){
-
-        Parton parton;
-        parton.p4.SetPtEtaPhiE((*m_mc_pt)->at(i),(*m_mc_eta)->at(i),(*m_mc_phi)->at(i),(*m_mc_e)->at(i));
-
-        int status = (*m_mc_status)->at(i);
-        int pdgId  = (*m_mc_pdgId)->at(i);
-        unsigned int abs_pdgId = std::abs(pdgId);
-
-        parton.pdgId  = pdgId;
-        parton.status = status;
-
-        // simple booleans for type
-        parton.isWprime = ( abs_pdgId==9900213 );
-        parton.isVLQ    = ( abs_pdgId==8000001 || abs_pdgId==7000001 );
-        parton.isTop = ( abs_pdgId==6 );
-        parton.isW   = ( abs_pdgId==24 );
-        parton.isZ   = ( abs_pdgId==23 );
-        parton.isHiggs  = ( abs_pdgId==25 );
-
-        parton.isLepton = ( abs_pdgId>=11 && abs_pdgId<=16 );
-        parton.isQuark  = ( abs_pdgId<7 );
-
-        if (parton.isLepton){
-            parton.isTau  = ( abs_pdgId==15 );
-            parton.isMuon = ( abs_pdgId==13 );
-            parton.isElectron = ( abs_pdgId==11 );
-            parton.isNeutrino = ( abs_pdgId==12 || abs_pdgId==14 || abs_pdgId==16 );
-        }
-        else if (parton.isQuark){
-            parton.isLight  = ( abs_pdgId<5 );
-            parton.isBottom = ( abs_pdgId==5 );
-        }
-
-        parton.index      = p_idx;                    // index in vector of truth_partons
-        parton.parent_idx = (*m_mc_parent_idx)->at(i);
-        parton.child0_idx = (*m_mc_child0_idx)->at(i);
-        parton.child1_idx = (*m_mc_child1_idx)->at(i);
-
-        m_truth_partons.push_back( parton );
-        p_idx++;
-    }
+    m_truth_partons.reserve(nPartons);
+    for (unsigned int i=0; i<nPartons; i++)
+        m_truth_partons.push_back( truth_parton(i) );
 
+    truth_graph();
     m_truthMatchingTool->setTruthPartons(m_truth_partons);
     m_truthMatchingTool->buildWprimeSystem();
     m_truth_wprime = m_truthMatchingTool->wprime();         // build the truth wprime decay chain
@@ -469,6 +529,60 @@ void Event::initialize_truth(){
 }
 
 
+Parton Event::truth_parton(const unsigned int index) const{
+    /* One particle of the generator record (index in truth_partons = index in the record) */
+    Parton parton = {};
+    parton.p4.SetPtEtaPhiE((*m_mc_pt)->at(index),(*m_mc_eta)->at(index),(*m_mc_phi)->at(index),(*m_mc_e)->at(index));
+
+    int status = (*m_mc_status)->at(index);
+    int pdgId  = (*m_mc_pdgId)->at(index);
+    unsigned int abs_pdgId = std::abs(pdgId);
+
+    parton.pdgId  = pdgId;
+    parton.status = status;
+
+    // simple booleans for type
+    parton.isWprime = ( abs_pdgId==9900213 );
+    parton.isVLQ    = ( abs_pdgId==8000001 || abs_pdgId==7000001 );
+    parton.isTop = ( abs_pdgId==6 );
+    parton.isW   = ( abs_pdgId==24 );
+    parton.isZ   = ( abs_pdgId==23 );
+    parton.isHiggs  = ( abs_pdgId==25 );
+
+    parton.isLepton = ( abs_pdgId>=11 && abs_pdgId<=16 );
+    parton.isQuark  = ( abs_pdgId<7 );
+
+    if (parton.isLepton){
+        parton.isTau  = ( abs_pdgId==15 );
+        parton.isMuon = ( abs_pdgId==13 );
+        parton.isElectron = ( abs_pdgId==11 );
+        parton.isNeutrino = ( abs_pdgId==12 || abs_pdgId==14 || abs_pdgId==16 );
+    }
+    else if (parton.isQuark){
+        parton.isLight  = ( abs_pdgId<5 );
+        parton.isBottom = ( abs_pdgId==5 );
+    }
+
+    parton.index      = index;                    // index in vector of truth_partons
+    parton.parent_idx = (*m_mc_parent_idx)->at(index);
+    parton.child0_idx = (*m_mc_child0_idx)->at(index);
+    parton.child1_idx = (*m_mc_child1_idx)->at(index);
+
+    return parton;
+}
+
+
+const TruthDecayGraph& Event::truth_graph() const{
+    /* Decay graph of the truth record -- built the first time it is needed in an event */
+    if (m_useTruth && !m_truthGraphBuilt){
+        m_truthMatchingTool->buildDecayGraph( **m_mc_pdgId, **m_mc_parent_idx, **m_mc_child0_idx, **m_mc_child1_idx );
+        m_truthGraphBuilt = true;
+    }
+
+    return m_truthMatchingTool->decayGraph();
+}
+
+
 void Event::initialize_jets(){
     /* Setup struct of jets (small-r) and relevant information 
      * b-tagging: https://twiki.cern.ch/twiki/bin/viewauth/CMS/BtagRecommendation80XReReco
@@ -500,6 +614,7 @@ void Event::initialize_jets(){
         jet.area     = (*m_jet_area)->at(i);
         jet.uncorrE  = (*m_jet_uncorrE)->at(i);
         jet.uncorrPt = (*m_jet_uncorrPt)->at(i);
+        jet.true_flavor = (m_calcBTagSF) ? (*m_jet_hadronFlavour)->at(i) : 0;
 
         jet.index  = idx;
         jet.isGood = isGood;
@@ -540,7 +655,7 @@ void Event::initialize_ljets(){
         ljet.tau3   = (*m_ljet_tau3)->at(i);
         ljet.tau21  = ljet.tau2 / ljet.tau1;
         ljet.tau32  = ljet.tau3 / ljet.tau2;
-        //bool toptag = (ljet.softDropMass>105. && ljet.softDropMass<210 && ljet.tau32<0.65);
+        ljet.isTopTagged = (ljet.softDropMass>105. && ljet.softDropMass<210 && ljet.tau32<0.65);
 
         // check if the AK8 is 'good'
         bool isGood(ljet.p4.Pt()>400. && fabs(ljet.p4.Eta())<2.4); // && toptag);
@@ -600,6 +715,7 @@ void Event::initialize_ljets(){
         ljet.truth_partons.clear();
         if (m_useTruth){ // && m_config->isTtbar()) {
             cma::DEBUG("EVENT : Truth match AK8");          // match subjets (and then the AK8 jet) to truth tops
+                                                            // (no match before the truth is decoded)
 
             m_truthMatchingTool->matchJetToTruthTop(ljet);  // match to partons
 
@@ -683,6 +799,7 @@ void Event::initialize_neutrinos(){
 
     Neutrino nu1;
     nu1.p4.SetPtEtaPhiM( m_met.p4.Pt(), 0, m_met.p4.Phi(), 0);   // "dummy" value pz=0
+    nu1.p4_sampling = nu1.p4;
 
     int nlep = m_leptons.size();
     if (nlep<1){
@@ -691,6 +808,43 @@ void Event::initialize_neutrinos(){
         return;
     }
 
+    if (m_neutrinoReco && m_dileptonReco && nlep>1 && m_jets.size()>1){
+        // dilepton ttbar: both neutrinos from the W & top mass constraints
+        // leading lepton & the leading lepton with the opposite charge
+        int other(-1);
+        for (int l=1; l<nlep; l++){
+            if (m_leptons.at(l).charge*m_leptons.at(0).charge < 0){
+                other = l;
+                break;
+            }
+        }
+
+        if (other>0){
+            Lepton lepton     = (m_leptons.at(0).charge<0) ? m_leptons.at(0) : m_leptons.at(other);
+            Lepton antiLepton = (m_leptons.at(0).charge<0) ? m_leptons.at(other) : m_leptons.at(0);
+
+            // two leading b-tagged jets (leading jets if there are fewer b-tags)
+            Jet jet1 = m_jets.at(0);
+            Jet jet2 = m_jets.at(1);
+            if (m_btag_jets_default.size()>1){
+                jet1 = m_jets.at(m_btag_jets_default.at(0));
+                jet2 = m_jets.at(m_btag_jets_default.at(1));
+            }
+
+            m_dileptonRecoTool->setObjects(lepton,antiLepton,jet1,jet2,m_met);
+            if (m_dileptonRecoTool->execute()){
+                // same order as the leptons: m_neutrinos[0] is from the W of m_leptons[0],
+                // m_neutrinos[1] from the W of m_leptons[other]
+                // (neutrino: W+ -> anti-lepton; anti-neutrino: W- -> lepton)
+                Neutrino nu    = m_dileptonRecoTool->neutrino();
+                Neutrino nubar = m_dileptonRecoTool->antiNeutrino();
+                m_neutrinos.push_back( (m_leptons.at(0).charge<0) ? nubar : nu );
+                m_neutrinos.push_back( (m_leptons.at(0).charge<0) ? nu : nubar );
+                return;
+            }
+        }
+    }
+
     m_neutrinoRecoTool->setObjects(m_leptons.at(0),m_met);
     if (m_neutrinoReco){
         // reconstruct neutrinos!
@@ -699,9 +853,26 @@ void Event::initialize_neutrinos(){
         nu1.p4.SetPxPyPzE( m_met.p4.Px(), m_met.p4.Py(), pz, nuE );
         nu1.isImaginary = m_neutrinoRecoTool->isImaginary();
 
-        float pz_samp   = m_neutrinoRecoTool->execute(false);
-        nu1.pz_sampling = pz_samp;
-        nu1.pz_samplings = m_neutrinoRecoTool->pzSolutions();
+        if (m_kinematicFit){
+            // kinematic fit (W mass, MET & b-jet resolutions, VLQ mass) instead of sampling the W mass
+            std::vector<Jet> bjets;
+            for (const auto& b : m_btag_jets_default)
+                bjets.push_back( m_jets.at(b) );
+
+            m_kinematicFitTool->setObjects(m_leptons.at(0),m_met);
+            m_kinematicFitTool->setJets(bjets);
+            m_kinematicFitTool->execute(m_kinematicFitMinuit);
+            nu1.p4_sampling = m_kinematicFitTool->neutrino().p4;   // px, py & pz fitted together
+            nu1.pz_sampling = nu1.p4_sampling.Pz();
+            nu1.pz_samplings.clear();
+        }
+        else{
+            float pz_samp   = m_neutrinoRecoTool->execute(false);
+            float nuE_samp  = sqrt( pow(m_met.p4.Px(),2) + pow(m_met.p4.Py(),2) + pow(pz_samp,2));
+            nu1.p4_sampling.SetPxPyPzE( m_met.p4.Px(), m_met.p4.Py(), pz_samp, nuE_samp );
+            nu1.pz_sampling = pz_samp;
+            nu1.pz_samplings = m_neutrinoRecoTool->pzSolutions();
+        }
 
         m_neutrinos.push_back(nu1);
     }
@@ -716,25 +887,54 @@ void Event::initialize_neutrinos(){
 
 
 void Event::initialize_weights(){
-    /* Event weights */
+    /* Event weights: per-event factors (m_weightComponents) times the normalization of the file
+         nominal = mc * pileup * btag * xsec*kfactor*lumi/sumOfWeights
+    */
     m_nominal_weight = 1.0;
+    m_systWeightsValid = false;     // weight systematics are calculated when they are needed
 
-    m_weight_btag.clear();
     if (m_isMC){
-        m_nominal_weight  = 1.0; //(**m_weight_pileup) * (**m_weight_mc);
-        m_nominal_weight *= (m_xsection) * (m_kfactor) * m_LUMI / (m_sumOfWeights);
+        m_weightComponents[kCompMC]       = weight_mc();
+        m_weightComponents[kCompPileup]   = weight_pileup();
+        m_weightComponents[kCompLeptonSF] = 1.0;
+        m_weightComponents[kCompBTag]     = 1.0;
+        m_weight_btag_UP   = 1.0;
+        m_weight_btag_DOWN = 1.0;
+        if (m_calcBTagSF){
+            // method 1a with the up/down variations in the same loop over the jets
+            BTagSF btagSF = m_BTagTool->getBTagSF(m_jets);
+            m_weightComponents[kCompBTag] = btagSF.central;
+            m_weight_btag_UP   = btagSF.up;
+            m_weight_btag_DOWN = btagSF.down;
+        }
 /*      // event weights
         m_weight_btag["70"] = (**m_weight_btag_70);
         m_weight_btag["77"] = (**m_weight_btag_77);
-        m_weight_btag_default = m_weight_btag[m_config->jet_btagWkpt()];
-        m_nominal_weight *= m_weight_btag_default;
+        m_weightComponents[kCompBTag] = m_weight_btag[m_config->jet_btagWkpt()];
 */
+        m_nominal_weight  = m_weightComponents[kCompMC] * m_weightComponents[kCompPileup] * m_weightComponents[kCompBTag];
+        m_nominal_weight *= m_normalization;
     }
 
     return;
 }
 
 
+double Event::sampleNormalization( const Sample& sample ){
+    /* Cross-section normalization of the sample (calculated once for each primary dataset) */
+    static std::map<std::string,double> normalizations;
+
+    auto norm = normalizations.find( sample.primaryDataset );
+    if (norm!=normalizations.end())
+        return norm->second;
+
+    double normalization = (m_xsection) * (m_kfactor) * (m_LUMI) / (m_sumOfWeights);
+    normalizations[sample.primaryDataset] = normalization;
+
+    return normalization;
+}
+
+
 
 void Event::initialize_kinematics(){
     /* Kinematic variables (HT, ST, MET) */
@@ -824,16 +1024,38 @@ void Event::wprimeReconstruction(){
         if (m_leptons.size()>0 && m_jets.size()>1){
             Neutrino nu = m_neutrinos.at(0);
             m_wprimeTool->setLepton( m_leptons.at(0) );
-            m_wprimeTool->setNeutrino( nu );
             m_wprimeTool->setJets( m_jets );
             m_wprimeTool->setBtagJets( m_btag_jets_default );
-            m_wprime = m_wprimeTool->execute();
 
             Neutrino nu_smp;
-            float nuE = sqrt( pow(nu.p4.Px(),2) + pow(nu.p4.Py(),2) + pow(nu.pz_sampling,2));
-            nu_smp.p4.SetPxPyPzE( nu.p4.Px(), nu.p4.Py(), nu.pz_sampling, nuE );
-            m_wprimeTool->setNeutrino( nu_smp );
-            m_wprime_smp = m_wprimeTool->execute();
+            nu_smp.p4 = nu.p4_sampling;            // sampling or kinematic fit
+
+            if (m_config->wprimeRecoMaxJets()>0){
+                // both neutrino solutions in one pass of the combinatorics:
+                // best candidate (lowest |A_energy|) with each neutrino
+                m_wprimeTool->setNeutrinos( {nu, nu_smp} );
+                m_wprimeTool->execute();
+
+                bool found(false), found_smp(false);
+                for (const auto& candidate : m_wprimeTool->candidates()){
+                    if (candidate.neutrino==0 && !found){
+                        m_wprime = candidate;
+                        found = true;
+                    }
+                    else if (candidate.neutrino==1 && !found_smp){
+                        m_wprime_smp = candidate;
+                        found_smp = true;
+                    }
+                    if (found && found_smp) break;
+                }
+            }
+            else{
+                m_wprimeTool->setNeutrino( nu );
+                m_wprime = m_wprimeTool->execute();
+
+                m_wprimeTool->setNeutrino( nu_smp );
+                m_wprime_smp = m_wprimeTool->execute();
+            }
         }
     }
     else{
@@ -870,50 +1092,53 @@ double Event::getSystEventWeight( const std::string &syst, const int weightIndex
     /* Calculate the event weight given some systematic
        -- only call for nominal events and systematic weights
        -- for non-nominal tree systematics, use the nominal event weight
+       -- to fill all weight systematics, use systEventWeights()
 
        @param syst          Name of systematic (nominal or some weight systematic)
        @param weightIndex   Index of btagging SF; default to -1
     */
-    double syst_event_weight(1.0);
+    if (syst.compare("nominal")==0)
+        return m_nominal_weight;     // nominal event weight
 
-    if (syst.compare("nominal")==0){
-        // nominal event weight
-        syst_event_weight  = m_nominal_weight;
-    }
-    else if (syst.find("pileup")!=std::string::npos){
-        // pileup event weight
-        syst_event_weight  = (**m_weight_mc);
-        syst_event_weight *= m_weight_btag_default;
-        syst_event_weight *= (m_xsection) * (m_kfactor) * (m_LUMI);
-        syst_event_weight /= (m_sumOfWeights);
-
-        syst_event_weight *= **m_weightSystematicsFloats.at(syst);
-    }
-    else if (syst.find("leptonSF")!=std::string::npos){
-        // leptonSF event weight
-        syst_event_weight  = (**m_weight_pileup) * (**m_weight_mc);
-        syst_event_weight *= m_weight_btag_default;
-        syst_event_weight *= (m_xsection) * (m_kfactor) * (m_LUMI);
-        syst_event_weight /= (m_sumOfWeights);
-
-        syst_event_weight *= **m_weightSystematicsFloats.at(syst);
-    }
-    else if (syst.find("bTagSF")!=std::string::npos){
-        // bTagSF event weight -- check indices for eigenvector systematics
-        syst_event_weight  = (**m_weight_pileup) * (**m_weight_mc);
-        syst_event_weight *= (m_xsection) * (m_kfactor) * (m_LUMI);
-        syst_event_weight /= (m_sumOfWeights);
-    }
-    else{
+    std::string name = (weightIndex<0) ? syst : std::to_string(weightIndex)+"_"+syst;
+    auto index = m_mapOfWeightSystematics.find(name);
+    if (index==m_mapOfWeightSystematics.end()){
         // safety to catch something weird -- just return 1.0
-        cma::WARNING("EVENT : Passed systematic variation, "+syst+", to Event::getSystEventWeight() ");
-        cma::WARNING("EVENT : that is inconsistent with the CyMiniAna options of ");
-        cma::WARNING("EVENT :     nominal, jvt, pileup, leptonSF, and bTagSF. ");
+        cma::WARNING("EVENT : Passed systematic variation, "+name+", to Event::getSystEventWeight() ");
+        cma::WARNING("EVENT : that is not in the list of weight systematics. ");
         cma::WARNING("EVENT : Returning a weight of 1.0. ");
-        syst_event_weight = 1.0;
+        return 1.0;
     }
 
-    return syst_event_weight;
+    return systEventWeights()[index->second];
+}
+
+
+const std::vector<double>& Event::systEventWeights(){
+    /* Event weights of all weight systematics in one pass (once per event)
+         pileup    mc * btag * xsec*kfactor*lumi/sumOfWeights * SF
+         leptonSF  pileup * mc * btag * xsec*kfactor*lumi/sumOfWeights * SF
+         bTagSF    pileup * mc * xsec*kfactor*lumi/sumOfWeights
+    */
+    if (m_systWeightsValid) return m_systWeights;
+
+    const double* w = m_weightComponents;
+
+    double base[kNumberOfWeightTypes];
+    base[kWeightPileup]   = w[kCompMC] * w[kCompBTag] * m_normalization;
+    base[kWeightLeptonSF] = w[kCompPileup] * w[kCompMC] * w[kCompBTag] * m_normalization;
+    base[kWeightBTagSF]   = w[kCompPileup] * w[kCompMC] * m_normalization;
+    base[kWeightUnknown]  = 1.0;
+
+    for (unsigned int i=0, size=m_weightSystematics.size(); i<size; i++){
+        const WeightSystematic& syst = m_weightSystematics[i];
+        m_systWeights[i] = base[syst.type];
+        if (syst.value)  m_systWeights[i] *= **syst.value;
+        if (syst.factor) m_systWeights[i] *= *syst.factor;
+    }
+    m_systWeightsValid = true;
+
+    return m_systWeights;
 }
 
 
@@ -954,27 +1179,12 @@ void Event::deepLearningPrediction(){
         // basic kinematic cuts on lepton, MET, jets
         cma::DEBUG("EVENT : DNN Training ");
         if (m_leptons.size()==1 && m_useTruth){
-            cma::DEBUG("EVENT : Begin loop over truth partons ");
-            Parton true_nu;
-            int n_wdecays2leptons(0);
-
-            for (const auto& p : m_truth_partons){
-                if (p.isW && p.child0_idx>=0 && p.child1_idx>=0) {
-                    Parton child0 = m_truth_partons.at( p.child0_idx );
-                    Parton child1 = m_truth_partons.at( p.child1_idx );
-                    if (child0.isNeutrino) {
-                        n_wdecays2leptons++;
-                        true_nu = child0;
-                    }
-                    else if (child1.isNeutrino) {
-                        n_wdecays2leptons++;
-                        true_nu = child1;
-                    }
-                }
-            }
+            cma::DEBUG("EVENT : Find the truth neutrino ");
+            int true_nu_idx = truth_graph().neutrino;
 
             // only want to train on single lepton events (reco & truth-level)
-            if (n_wdecays2leptons==1){
+            if (true_nu_idx>=0){
+                Parton true_nu = truth_parton(true_nu_idx);
                 m_deepLearningTool->setNeutrino( m_neutrinos.at(0) );
                 m_deepLearningTool->setTrueNeutrino( true_nu );
                 m_deepLearningTool->setMET( m_met );
@@ -1043,10 +1253,19 @@ void Event::finalize(){
     // delete variables
     cma::DEBUG("EVENT : Finalize() ");
 
+    if (m_kinematicFit) m_kinematicFitTool->summary();
+    if (m_dileptonReco) m_dileptonRecoTool->summary();
+
     delete m_eventNumber;
     delete m_runNumber;
     delete m_lumiblock;
 
+    for (auto& syst : m_weightSystematicsFloats) delete syst.second;
+    for (auto& syst : m_weightSystematicsVectorFloats) delete syst.second;
+    m_weightSystematicsFloats.clear();
+    m_weightSystematicsVectorFloats.clear();
+    m_weightSystematics.clear();
+
     if (m_useJets){
       delete m_jet_pt;
       delete m_jet_eta;
@@ -1057,6 +1276,7 @@ void Event::finalize(){
       delete m_jet_area;
       delete m_jet_uncorrPt;
       delete m_jet_uncorrE;
+      if (m_calcBTagSF) delete m_jet_hadronFlavour;
     }
 
     if (m_useLargeRJets){
@@ -1169,4 +1389,11 @@ void Event::finalize(){
 }
 
 
+unsigned int Event::definitionsVersion(){
+    /* Version of the object definitions (used to invalidate cached selection results)
+       Increment this when a change in this file modifies which events pass a selection */
+    return 1;
+}
+
+
 // THE END
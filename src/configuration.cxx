@@ -39,6 +39,14 @@ configuration::configuration(const std::string &configFile) :
   m_customDirectory("SetMe"),
   m_makeTTree(false),
   m_makeHistograms(false),
+  m_sparseHistogramBins(100000),
+  m_histogramsFile(""),
+  m_compressionSettings(-1),
+  m_basketSize(0),
+  m_autoFlush(0),
+  m_asyncOutput(false),
+  m_outputQueueSize(1000),
+  m_entryListCache(""),
   m_cma_absPath("SetMe"),
   m_metadataFile("SetMe"),
   m_DNNinference(false),
@@ -49,11 +57,21 @@ configuration::configuration(const std::string &configFile) :
   m_doTruthEventLoop(false),
   m_matchTruthToReco(true),
   m_jet_btag_wkpt("SetMe"),
+  m_btagEfficiencies(""),
   m_calcWeightSystematics(false),
   m_listOfWeightSystematicsFile("SetMe"),
   m_listOfWeightVectorSystematicsFile("SetMe"),
-  m_neutrinoReco(false){
+  m_neutrinoReco(false),
+  m_neutrinoRecoMethod("SetMe"),
+  m_kinfitVLQMass(0),
+  m_dileptonReco(false),
+  m_dileptonSmearings(100),
+  m_wprimeReco(false),
+  m_wprimeRecoMaxJets(0),
+  m_wprimeRecoMaxAsymmetry(1.0){
     m_selections.clear();
+    m_cutOrderWarmup = 0;
+    m_useQCDRegions  = false;
     m_cutsfiles.clear();
 
     m_XSection.clear();
@@ -131,17 +149,20 @@ void configuration::initialize() {
     cma::DEBUG("CONFIG : path set to: "+m_cma_absPath );
 
     // Assign values
-    m_nEventsToProcess = std::stoi(getConfigOption("NEvents"));
-    m_firstEvent       = std::stoi(getConfigOption("firstEvent"));
+    m_nEventsToProcess = getConfigNumber<int>("NEvents");
+    m_firstEvent       = getConfigNumber<int>("firstEvent");
     m_input_selection  = getConfigOption("input_selection"); // "grid", "pre", etc.
     cma::split( m_map_config.at("selection"), ',', m_selections );  // different event selections
     cma::split( m_map_config.at("cutsfile"), ',', m_cutsfiles );  // different event selections
+    m_cutOrderWarmup = getConfigNumber<int>("cutOrderWarmup");
+    m_useQCDRegions  = cma::str2bool( getConfigOption("useQCDRegions") );
 
 
     // check that b-tag and top-tag WPs are recognized as one of supported values
     check_btag_WP(getConfigOption("jet_btag_wkpt"));
 
     m_jet_btag_wkpt    = getConfigOption("jet_btag_wkpt");
+    m_btagEfficiencies = getConfigOption("btagEfficiencies");
     m_outputFilePath   = getConfigOption("output_path");
     m_customDirectory  = getConfigOption("customDirectory");
     m_useTruth         = cma::str2bool( getConfigOption("useTruth") );
@@ -150,11 +171,24 @@ void configuration::initialize() {
     m_useLargeRJets    = cma::str2bool( getConfigOption("useLargeRJets") );
     m_useNeutrinos     = cma::str2bool( getConfigOption("useNeutrinos") );
     m_neutrinoReco     = cma::str2bool( getConfigOption("neutrinoReco") );
+    m_neutrinoRecoMethod = getConfigOption("neutrinoRecoMethod");
+    m_kinfitVLQMass      = getConfigNumber<float>("kinfitVLQMass");
+    m_dileptonReco       = cma::str2bool( getConfigOption("dileptonReco") );
+    m_dileptonSmearings  = getConfigNumber<int>("dileptonSmearings");
+    if (m_neutrinoRecoMethod.compare("sampling")!=0 && m_neutrinoRecoMethod.compare("kinfit")!=0 && m_neutrinoRecoMethod.compare("minuit")!=0){
+        cma::ERROR("CONFIG : neutrinoRecoMethod '"+m_neutrinoRecoMethod+"' is not supported ('sampling', 'kinfit', 'minuit')");
+        exit(EXIT_FAILURE);
+    }
+    m_wprimeReco       = cma::str2bool( getConfigOption("wprimeReco") );
+    m_wprimeRecoMaxJets      = getConfigNumber<int>("wprimeRecoMaxJets");
+    m_wprimeRecoMaxAsymmetry = getConfigNumber<float>("wprimeRecoMaxAsymmetry");
     m_useDNN           = cma::str2bool( getConfigOption("useDNN") );
     m_useWprime        = cma::str2bool( getConfigOption("useWprime") );
     m_makeTTree        = cma::str2bool( getConfigOption("makeTTree") );
     m_makeHistograms   = cma::str2bool( getConfigOption("makeHistograms") );
     m_makeEfficiencies = cma::str2bool( getConfigOption("makeEfficiencies") );
+    m_sparseHistogramBins = getConfigNumber<int>("sparseHistogramBins");
+    m_histogramsFile   = getConfigOption("histogramsFile");
     m_dnnFile          = getConfigOption("dnnFile");
     m_dnnKey           = getConfigOption("dnnKey");
     m_DNNtraining      = cma::str2bool( getConfigOption("DNNtraining") );
@@ -165,6 +199,21 @@ void configuration::initialize() {
     m_listOfWeightSystematicsFile       = getConfigOption("weightSystematicsFile");
     m_listOfWeightVectorSystematicsFile = getConfigOption("weightVectorSystematicsFile");
 
+    // keep/drop statements for the branches written to skims (processed in order)
+    m_branchSlimming.clear();
+    std::string slimmingFile = getConfigOption("slimmingFile");
+    if (slimmingFile.size()>0)
+        cma::read_file( slimmingFile, m_branchSlimming );
+
+    // output compression & TTree buffering
+    // e.g., lz4 for intermediate skims (fast), lzma/zstd for archival (small)
+    set_compression( getConfigOption("compressionAlgorithm"), getConfigNumber<int>("compressionLevel") );
+    m_basketSize = getConfigNumber<int>("basketSize");      // bytes per branch buffer
+    m_autoFlush  = getConfigNumber<long long>("autoFlush");      // >0 entries; <0 bytes per cluster
+    m_asyncOutput     = cma::str2bool( getConfigOption("asyncOutput") );
+    m_outputQueueSize = getConfigNumber<int>("outputQueueSize");
+    m_entryListCache  = getConfigOption("entryListCache");
+
     cma::read_file( getConfigOption("inputfile"), m_filesToProcess );
     cma::read_file( getConfigOption("treenames"), m_treeNames );
 
@@ -191,7 +240,13 @@ void configuration::initialize() {
         std::istream_iterator<std::string> start(cfg), stop;
         std::vector<std::string> tokens(start, stop);
 
-        m_mapOfWeightVectorSystematics.insert( std::pair<std::string,unsigned int>( tokens.at(0),std::stoi(tokens.at(1)) ) );
+        int size(0);
+        if (tokens.size()<2 || !cma::str2number(tokens.at(1),size)){
+            cma::ERROR("CONFIG : Cannot read '"+weightVectorSystematic+"' in "+m_listOfWeightVectorSystematicsFile);
+            cma::ERROR("CONFIG : Expected 'NAME SIZE'");
+            exit(EXIT_FAILURE);
+        }
+        m_mapOfWeightVectorSystematics.insert( std::pair<std::string,unsigned int>( tokens.at(0),size ) );
     }
 
     return;
@@ -470,6 +525,39 @@ void configuration::check_btag_WP(const std::string &wkpt){
     return;
 }
 
+void configuration::set_compression(const std::string &algorithm, const int level){
+    /* Set the compression for output files
+       Same encoding as ROOT::CompressionSettings() :: 100*algorithm + level
+       (zstd requires ROOT 6.20 or newer)
+       "default" keeps the compression of the ROOT version (-1)
+       Benchmark of the settings on a skim: test/testCompression.cpp
+    */
+    if (algorithm.compare("default")==0){
+        m_compressionSettings = -1;
+        return;
+    }
+
+    std::map<std::string,int> algorithms = {
+            {"zlib", 1},
+            {"lzma", 2},
+            {"lz4",  4},
+            {"zstd", 5} };
+
+    if (algorithms.find(algorithm)==algorithms.end()){
+        cma::ERROR("CONFIG : Unknown compression algorithm: "+algorithm+". Aborting!");
+        cma::ERROR("CONFIG : Available algorithms: default,zlib,lzma,lz4,zstd");
+        exit(EXIT_FAILURE);
+    }
+    if (level<0 || level>9){
+        cma::ERROR("CONFIG : Compression level must be in [0,9], not "+std::to_string(level)+". Aborting!");
+        exit(EXIT_FAILURE);
+    }
+
+    m_compressionSettings = 100*algorithms.at(algorithm) + level;
+
+    return;
+}
+
 void configuration::setMatchTruthToReco(bool truthToReco){
     m_matchTruthToReco = truthToReco;
     return;
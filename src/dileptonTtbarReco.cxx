@@ -0,0 +1,405 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Tool for reconstructing the two neutrinos in dilepton ttbar events
+- Analytic solution (L. Sonnenschein, Phys. Rev. D 73 (2006) 054015):
+  the W-mass & top-mass constraints of each top quark give a conic in the
+  neutrino (px,py); the two neutrinos share the MET -> intersection of two
+  conics = real roots of a quartic in the neutrino px
+- The jets (energy resolution) & W masses (width) are smeared many times with
+  counter-based random numbers (seed from cma::setRandomNumberSeeds), all quartics
+  are solved together, and the solution with the smallest m(ttbar) of each smearing
+  is averaged
+*/
+#include "Analysis/CyMiniAna/interface/dileptonTtbarReco.h"
+
+
+DileptonTtbarReco::DileptonTtbarReco( configuration& cmaConfig ) :
+  m_config(&cmaConfig),
+  m_nSolutions(0),
+  m_topMass(172.5),
+  m_wmass(80.4),
+  m_wmassSigma(2.1),
+  m_jetStochastic(1.0),
+  m_jetConstant(0.05),
+  m_nSmearings(100),
+  m_nEvents(0),
+  m_nReconstructed(0),
+  m_time(0.){
+    m_nu = {};
+    m_nubar = {};
+    m_lepton = {};
+    m_antiLepton = {};
+    m_met = {};
+
+    m_nSmearings = std::max( 1u, m_config->dileptonSmearings() );
+  }
+
+DileptonTtbarReco::~DileptonTtbarReco() {}
+
+
+void DileptonTtbarReco::setObjects(Lepton& lepton, Lepton& antiLepton, Jet& jet1, Jet& jet2, MET& met){
+    /* Set the objects from one function call */
+    m_lepton     = lepton;
+    m_antiLepton = antiLepton;
+    m_jet1 = jet1;
+    m_jet2 = jet2;
+    m_met  = met;
+    return;
+}
+
+
+bool DileptonTtbarReco::execute(){
+    /* Build the neutrinos
+       - both assignments of the jets to the top quarks, m_nSmearings times each
+       - momenta in units of 100 GeV to keep the quartic coefficients O(1)
+    */
+    auto start = std::chrono::steady_clock::now();
+    const double unit(100.);
+
+    m_nu = {};
+    m_nubar = {};
+    m_nSolutions = 0;
+
+    unsigned int nQuartics = 2*m_nSmearings;
+    std::vector<double> coefficients(4*nQuartics,0.);
+    std::vector<double> roots(4*nQuartics,0.);
+    std::vector<double> scales(nQuartics,1.);
+    std::vector<unsigned int> nRoots(nQuartics,0);
+    std::vector<bool> valid(nQuartics,false);
+    std::vector<Conic> conics(2*nQuartics);
+    std::vector<TLorentzVector> visible(nQuartics);     // b + bbar + leptons
+    std::vector<double> metx(nQuartics);
+    std::vector<double> mety(nQuartics);
+
+    TLorentzVector lepton     = m_lepton.p4 * (1./unit);
+    TLorentzVector antiLepton = m_antiLepton.p4 * (1./unit);
+
+    for (unsigned int a=0; a<2; a++){
+        const Jet& b    = (a==0) ? m_jet1 : m_jet2;          // from the top (with the anti-lepton)
+        const Jet& bbar = (a==0) ? m_jet2 : m_jet1;
+        unsigned long long seed = cma::setRandomNumberSeeds( m_lepton, m_antiLepton, b, bbar );
+
+        double sigma_b    = std::sqrt( m_jetStochastic*m_jetStochastic/std::max(b.p4.E(),1.) + m_jetConstant*m_jetConstant );
+        double sigma_bbar = std::sqrt( m_jetStochastic*m_jetStochastic/std::max(bbar.p4.E(),1.) + m_jetConstant*m_jetConstant );
+
+        for (unsigned int s=0; s<m_nSmearings; s++){
+            unsigned int q = a*m_nSmearings + s;
+
+            double scale_b(1.), scale_bbar(1.), wmass(m_wmass), wmass_bar(m_wmass);
+            if (s>0){
+                scale_b    = std::max( 0.1, 1. + sigma_b*cma::gaussian(seed,4*s) );
+                scale_bbar = std::max( 0.1, 1. + sigma_bbar*cma::gaussian(seed,4*s+1) );
+                wmass      = m_wmass + m_wmassSigma*cma::gaussian(seed,4*s+2);
+                wmass_bar  = m_wmass + m_wmassSigma*cma::gaussian(seed,4*s+3);
+            }
+
+            // the MET balances the change of the jets
+            TLorentzVector b_p4    = b.p4 * (scale_b/unit);
+            TLorentzVector bbar_p4 = bbar.p4 * (scale_bbar/unit);
+            metx[q] = ( m_met.p4.Px() - (scale_b-1)*b.p4.Px() - (scale_bbar-1)*bbar.p4.Px() ) / unit;
+            mety[q] = ( m_met.p4.Py() - (scale_b-1)*b.p4.Py() - (scale_bbar-1)*bbar.p4.Py() ) / unit;
+            visible[q] = b_p4 + bbar_p4 + lepton + antiLepton;
+
+            conics[2*q]   = topConic( antiLepton, b_p4, wmass/unit, m_topMass/unit );
+            conics[2*q+1] = topConic( lepton, bbar_p4, wmass_bar/unit, m_topMass/unit );
+
+            // shift the anti-neutrino conic to the neutrino (px,py): qx = metx-px, qy = mety-py
+            Conic& nb = conics[2*q+1];
+            double mx(metx[q]), my(mety[q]);
+            Conic shifted = nb;
+            shifted.c10 = -2*nb.c20*mx - nb.c11*my - nb.c10;
+            shifted.c01 = -2*nb.c02*my - nb.c11*mx - nb.c01;
+            shifted.c00 = nb.c20*mx*mx + nb.c02*my*my + nb.c11*mx*my + nb.c10*mx + nb.c01*my + nb.c00;
+            nb = shifted;
+
+            valid[q] = quartic( conics[2*q], conics[2*q+1], &coefficients[4*q], scales[q] );
+            if (!valid[q]) coefficients[4*q] = 1.;           // x^4+1: no real roots
+        } // end loop over smearings
+    } // end loop over jet assignments
+
+    quarticRoots( nQuartics, coefficients.data(), roots.data(), nRoots.data() );
+
+    // smallest m(ttbar) of each smearing, then average
+    double sum[6] = {0.,0.,0.,0.,0.,0.};
+    for (unsigned int s=0; s<m_nSmearings; s++){
+        double best_mtt(-1.);
+        double best[6];
+
+        for (unsigned int a=0; a<2; a++){
+            unsigned int q = a*m_nSmearings + s;
+            if (!valid[q]) continue;
+
+            const Conic& nu = conics[2*q];
+            const Conic& nb = conics[2*q+1];      // shifted: same (px,py) as the neutrino
+
+            for (unsigned int r=0; r<nRoots[q]; r++){
+                double x = roots[4*q+r]*scales[q];
+
+                // common root of the two quadratics in y
+                double A1(nu.c02), B1(nu.c01+nu.c11*x), C1(nu.c00+nu.c10*x+nu.c20*x*x);
+                double A2(nb.c02), B2(nb.c01+nb.c11*x), C2(nb.c00+nb.c10*x+nb.c20*x*x);
+                double G = A1*B2 - A2*B1;
+                if (std::abs(G)<1e-12) continue;
+                double y = -(A1*C2 - A2*C1) / G;
+
+                // both neutrinos need positive energies (the conics also contain E<0)
+                double E = (nu.K + nu.u*x + nu.v*y) / nu.El;
+                double qx = metx[q] - x;
+                double qy = mety[q] - y;
+                double Ebar = (nb.K + nb.u*qx + nb.v*qy) / nb.El;
+                if (!(E>0) || !(Ebar>0)) continue;
+
+                double pz  = nu.alpha*x + nu.beta*y + nu.gamma;
+                double qz  = nb.alpha*qx + nb.beta*qy + nb.gamma;
+                double Ent = std::sqrt(x*x + y*y + pz*pz);
+                double Enb = std::sqrt(qx*qx + qy*qy + qz*qz);
+
+                TLorentzVector ttbar( visible[q].Px()+x+qx, visible[q].Py()+y+qy, visible[q].Pz()+pz+qz, visible[q].E()+Ent+Enb );
+                double mtt = ttbar.M();
+                if (best_mtt<0 || mtt<best_mtt){
+                    best_mtt = mtt;
+                    best[0] = x;  best[1] = y;  best[2] = pz;
+                    best[3] = qx; best[4] = qy; best[5] = qz;
+                }
+            } // end loop over roots
+        } // end loop over jet assignments
+
+        if (best_mtt<0) continue;
+        m_nSolutions++;
+        for (unsigned int i=0; i<6; i++) sum[i] += best[i];
+    } // end loop over smearings
+
+    bool reconstructed = (m_nSolutions>0);
+    if (reconstructed){
+        double px = unit*sum[0]/m_nSolutions;
+        double py = unit*sum[1]/m_nSolutions;
+        double pz = unit*sum[2]/m_nSolutions;
+        m_nu.p4.SetPxPyPzE( px, py, pz, std::sqrt(px*px+py*py+pz*pz) );
+        m_nu.p4_sampling = m_nu.p4;        // no separate sampling: the solved neutrino
+        m_nu.pz_sampling = pz;
+
+        px = unit*sum[3]/m_nSolutions;
+        py = unit*sum[4]/m_nSolutions;
+        pz = unit*sum[5]/m_nSolutions;
+        m_nubar.p4.SetPxPyPzE( px, py, pz, std::sqrt(px*px+py*py+pz*pz) );
+        m_nubar.p4_sampling = m_nubar.p4;
+        m_nubar.pz_sampling = pz;
+        m_nReconstructed++;
+    }
+
+    m_nEvents++;
+    m_time += std::chrono::duration<double,std::micro>( std::chrono::steady_clock::now()-start ).count();
+    cma::DEBUG("DILEPTONTTBARRECO : "+std::to_string(m_nSolutions)+" of "+std::to_string(m_nSmearings)+" smearings with a solution");
+
+    return reconstructed;
+}
+
+
+DileptonTtbarReco::Conic DileptonTtbarReco::topConic( const TLorentzVector& lepton, const TLorentzVector& bjet,
+                                                      const double wmass, const double topmass ) const{
+    /* Neutrino from t->bW->blv:
+         (l+v)^2 = mW^2    ->  E_l*E - p_l.p = a1
+         (b+l+v)^2 = mt^2  ->  (E_b+E_l)*E - (p_b+p_l).p = a2
+       eliminating E gives a plane n.p = d (pz from px,py) and E_l*E = a1 + p_l.p,
+       E^2 = |p|^2 gives the conic in (px,py)
+    */
+    Conic c = {};
+    c.valid = false;
+
+    double El = lepton.E();
+    double a1 = 0.5*(wmass*wmass - lepton.M2());
+    double a2 = 0.5*(topmass*topmass - (bjet+lepton).M2());
+
+    double ratio = bjet.E()/El;
+    double nx = ratio*lepton.Px() - bjet.Px();
+    double ny = ratio*lepton.Py() - bjet.Py();
+    double nz = ratio*lepton.Pz() - bjet.Pz();
+    double d  = a2 - (1.+ratio)*a1;
+    if (std::abs(nz)<1e-9) return c;
+
+    c.alpha = -nx/nz;
+    c.beta  = -ny/nz;
+    c.gamma = d/nz;
+
+    // p_l.p = u*px + v*py + w
+    c.u = lepton.Px() + lepton.Pz()*c.alpha;
+    c.v = lepton.Py() + lepton.Pz()*c.beta;
+    double w = lepton.Pz()*c.gamma;
+    c.K  = a1 + w;
+    c.El = El;
+
+    double El2 = El*El;
+    c.c20 = El2*(1. + c.alpha*c.alpha) - c.u*c.u;
+    c.c02 = El2*(1. + c.beta*c.beta) - c.v*c.v;
+    c.c11 = 2.*(El2*c.alpha*c.beta - c.u*c.v);
+    c.c10 = 2.*(El2*c.alpha*c.gamma - c.K*c.u);
+    c.c01 = 2.*(El2*c.beta*c.gamma - c.K*c.v);
+    c.c00 = El2*c.gamma*c.gamma - c.K*c.K;
+    c.valid = true;
+
+    return c;
+}
+
+
+bool DileptonTtbarReco::quartic( const Conic& nu, const Conic& nubar, double* coefficients, double& scale ) const{
+    /* Resultant of the two conics (quadratics in y): (A1C2-A2C1)^2 - (A1B2-A2B1)(B1C2-B2C1) = 0
+       -> monic quartic in u = px/scale with roots |u| <= 1
+    */
+    if (!nu.valid || !nubar.valid) return false;
+
+    double A1(nu.c02), B1[2] = {nu.c01, nu.c11}, C1[3] = {nu.c00, nu.c10, nu.c20};
+    double A2(nubar.c02), B2[2] = {nubar.c01, nubar.c11}, C2[3] = {nubar.c00, nubar.c10, nubar.c20};
+
+    double F[3], G[2], H[4] = {0.,0.,0.,0.};
+    for (unsigned int i=0; i<3; i++) F[i] = A1*C2[i] - A2*C1[i];
+    for (unsigned int i=0; i<2; i++) G[i] = A1*B2[i] - A2*B1[i];
+    for (unsigned int i=0; i<2; i++){
+        for (unsigned int j=0; j<3; j++) H[i+j] += B1[i]*C2[j] - B2[i]*C1[j];
+    }
+
+    double R[5] = {0.,0.,0.,0.,0.};
+    for (unsigned int i=0; i<3; i++){
+        for (unsigned int j=0; j<3; j++) R[i+j] += F[i]*F[j];
+    }
+    for (unsigned int i=0; i<2; i++){
+        for (unsigned int j=0; j<4; j++) R[i+j] -= G[i]*H[j];
+    }
+
+    double largest(0.);
+    for (unsigned int i=0; i<5; i++) largest = std::max( largest, std::abs(R[i]) );
+    if (!(std::abs(R[4]) > 1e-12*largest)) return false;       // degenerate (not a quartic)
+
+    // monic & scaled (Fujiwara bound on the roots)
+    double a[4];
+    for (unsigned int i=0; i<4; i++) a[i] = R[i]/R[4];
+    scale = 2.*std::max( std::max(std::abs(a[3]), std::sqrt(std::abs(a[2]))),
+                         std::max(std::cbrt(std::abs(a[1])), std::pow(0.5*std::abs(a[0]),0.25)) );
+    if (!(scale>0)) scale = 1.;
+
+    double power(scale);
+    for (int i=3; i>=0; i--){
+        coefficients[i] = a[i]/power;
+        power *= scale;
+    }
+
+    return true;
+}
+
+
+void DileptonTtbarReco::quarticRoots( const unsigned int n, const double* c, double* roots, unsigned int* nRoots ){
+    /* All roots of n monic quartics with Durand-Kerner (Weierstrass) iterations:
+         z_j <- z_j - p(z_j) / prod_{k!=j} (z_j - z_k)
+       Small blocks of quartics are iterated together (fixed-size loops without
+       data-dependent branches -> the compiler can vectorise them) until the
+       largest step in the block is negligible.
+       Real roots are polished with Newton steps.
+    */
+    std::vector<double> re(4*n), im(4*n);
+
+    // starting values (0.4+0.9i)^k
+    const double start_re[4] = {1., 0.4, -0.65, -0.908};
+    const double start_im[4] = {0., 0.9,  0.72, -0.297};
+
+    // blocks of quartics are iterated together until all of them have converged
+    const unsigned int block(8);
+    for (unsigned int first=0; first<n; first+=block){
+        unsigned int last = std::min(n,first+block);
+
+        for (unsigned int i=first; i<last; i++){
+            for (unsigned int j=0; j<4; j++){
+                re[4*i+j] = start_re[j];
+                im[4*i+j] = start_im[j];
+            }
+        }
+
+        for (unsigned int it=0; it<m_rootIterations; it++){
+            double maxStep(0.);
+            for (unsigned int i=first; i<last; i++){
+                const double* ci = &c[4*i];
+                double* zr = &re[4*i];
+                double* zi = &im[4*i];
+
+                // p(z_j) (Horner)
+                double pr[4], pi[4];
+                for (unsigned int j=0; j<4; j++){
+                    double tr = zr[j] + ci[3];
+                    double ti = zi[j];
+                    for (int k=2; k>=0; k--){
+                        double ur = tr*zr[j] - ti*zi[j] + ci[k];
+                        ti = tr*zi[j] + ti*zr[j];
+                        tr = ur;
+                    }
+                    pr[j] = tr;
+                    pi[j] = ti;
+                }
+
+                // prod_{k!=j} (z_j - z_k)
+                double dr[4], di[4];
+                for (unsigned int j=0; j<4; j++){
+                    double xr[3], xi[3];
+                    for (unsigned int k=0, m=0; k<4; k++){
+                        if (k==j) continue;
+                        xr[m] = zr[j]-zr[k];
+                        xi[m] = zi[j]-zi[k];
+                        m++;
+                    }
+                    double tr = xr[0]*xr[1] - xi[0]*xi[1];
+                    double ti = xr[0]*xi[1] + xi[0]*xr[1];
+                    dr[j] = tr*xr[2] - ti*xi[2];
+                    di[j] = tr*xi[2] + ti*xr[2];
+                }
+
+                // simultaneous (Jacobi) update
+                for (unsigned int j=0; j<4; j++){
+                    double norm = dr[j]*dr[j] + di[j]*di[j] + 1e-300;
+                    double sr = (pr[j]*dr[j] + pi[j]*di[j])/norm;
+                    double si = (pi[j]*dr[j] - pr[j]*di[j])/norm;
+                    zr[j] -= sr;
+                    zi[j] -= si;
+                    maxStep = std::max( maxStep, std::abs(sr)+std::abs(si) );
+                }
+            }
+            if (maxStep < 1e-14) break;
+        } // end iterations
+    } // end loop over blocks
+
+    // real roots
+    for (unsigned int i=0; i<n; i++){
+        const double* ci = &c[4*i];
+        nRoots[i] = 0;
+        for (unsigned int j=0; j<4; j++){
+            double x = re[4*i+j];
+            if (std::abs(im[4*i+j]) > 1e-6*std::max(1.,std::abs(x)) || std::isnan(x)) continue;
+
+            for (unsigned int step=0; step<2; step++){
+                double p  = (((x + ci[3])*x + ci[2])*x + ci[1])*x + ci[0];
+                double dp = ((4*x + 3*ci[3])*x + 2*ci[2])*x + ci[1];
+                if (dp!=0) x -= p/dp;
+            }
+            roots[4*i + nRoots[i]++] = x;
+        }
+    }
+
+    return;
+}
+
+
+void DileptonTtbarReco::summary() const{
+    /* Number of events & time per event */
+    if (m_nEvents<1) return;
+
+    cma::INFO("DILEPTONTTBARRECO : "+std::to_string(m_nReconstructed)+" of "+std::to_string(m_nEvents)+
+              " events reconstructed, "+std::to_string(m_time/m_nEvents)+" us per event ("+
+              std::to_string(m_nSmearings)+" smearings)");
+
+    return;
+}
+
+// THE END //
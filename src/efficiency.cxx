@@ -18,6 +18,7 @@ https://root.cern.ch/doc/master/classTEfficiency.html
 efficiency::efficiency(configuration &cmaConfig) : 
   m_config(&cmaConfig){
    m_map_efficiencies.clear();
+   m_handles.clear();
   }
 
 efficiency::~efficiency() {}
@@ -46,16 +47,14 @@ void efficiency::init_eff(const TH1 &passed, const TH1 &total){
 // -- 1D efficiencies
 void efficiency::init_eff( const std::string &name, const unsigned int nBins, const double x_min, const double x_max ){
     /* Initialize efficiency -- equal bins */
-    m_map_efficiencies[name] = new TEfficiency((name).c_str(), (name).c_str(),nBins,x_min,x_max);
-    m_map_efficiencies[name]->SetUseWeightedEvents();
+    book( name, {{nBins,x_min,x_max,{}}} );
 
     return;
 }
 
 void efficiency::init_eff( const std::string &name, const unsigned int nBins, const double *xbins ){
     /* Initialize efficiency -- variable bins */
-    m_map_efficiencies[name] = new TEfficiency((name).c_str(), (name).c_str(),nBins,xbins);
-    m_map_efficiencies[name]->SetUseWeightedEvents();
+    book( name, {{nBins,xbins[0],xbins[nBins],std::vector<double>(xbins,xbins+nBins+1)}} );
 
     return;
 }
@@ -64,9 +63,7 @@ void efficiency::init_eff( const std::string &name, const unsigned int nBins, co
 void efficiency::init_eff( const std::string &name, const unsigned int nBinsX, const double x_min, const double x_max,
                               const unsigned int nBinsY, const double y_min, const double y_max ){
     /* Initialize efficiency -- equal bins */
-    m_map_efficiencies[name] = new TEfficiency((name).c_str(), (name).c_str(),
-                                               nBinsX,x_min,x_max,nBinsY,y_min,y_max);
-    m_map_efficiencies[name]->SetUseWeightedEvents();
+    book( name, {{nBinsX,x_min,x_max,{}}, {nBinsY,y_min,y_max,{}}} );
 
     return;
 }
@@ -74,16 +71,70 @@ void efficiency::init_eff( const std::string &name, const unsigned int nBinsX, c
 void efficiency::init_eff( const std::string &name, const unsigned int nBinsX, const double *xbins,
                               const unsigned int nBinsY, const double *ybins ){
     /* Initialize efficiency -- variable bins */
-    m_map_efficiencies[name] = new TEfficiency((name).c_str(), (name).c_str(),
-                                               nBinsX,xbins,nBinsY,ybins);
-    m_map_efficiencies[name]->SetUseWeightedEvents();
+    book( name, {{nBinsX,xbins[0],xbins[nBinsX],std::vector<double>(xbins,xbins+nBinsX+1)},
+                 {nBinsY,ybins[0],ybins[nBinsY],std::vector<double>(ybins,ybins+nBinsY+1)}} );
+
+    return;
+}
+
+void efficiency::book( const std::string &name, const std::vector<flatHist::Axis>& axes ){
+    /* Book the passed & total histograms (made into a TEfficiency in finalize()) */
+    int passed = m_hists.book( {name+"_passed"}, axes );
+    int total  = m_hists.book( {name+"_total"},  axes );
+    m_handles[name] = std::make_pair( passed, total );
+    m_names.push_back( name );
+
+    return;
+}
+
+
+void efficiency::setNumberOfShards( const unsigned int nShards ){
+    /* One copy of the histograms per thread filling them (after booking) -- see histShards */
+    m_hists.setNumberOfShards( nShards );
+    return;
+}
+
+
+void efficiency::finalize( TFile& outputFile ){
+    /* Make the TEfficiency objects from the passed & total histograms (weighted events) */
+    outputFile.cd();
+    m_hists.merge();    // add the histograms filled by each thread
+
+    for (const auto& name : m_names){
+        std::pair<int,int> handles = m_handles.at(name);
+        TH1* passed = m_hists.merged().at(handles.first).materialize().at(0);
+        TH1* total  = m_hists.merged().at(handles.second).materialize().at(0);
+
+        // book with the bins & attach the histograms without ROOT's consistency check:
+        // with negative weights a bin can have passed > total (accepted by TEfficiency::FillWeighted),
+        // which TEfficiency(passed,total) would reject (replacing the histograms by dummies)
+        std::vector<double> xbins, ybins;
+        for (int i=1; i<=total->GetNbinsX()+1; i++) xbins.push_back( total->GetXaxis()->GetBinLowEdge(i) );
+        for (int i=1; i<=total->GetNbinsY()+1; i++) ybins.push_back( total->GetYaxis()->GetBinLowEdge(i) );
+
+        TEfficiency* eff(nullptr);
+        if (m_hists.merged().at(handles.second).dimension()==1)
+            eff = new TEfficiency( name.c_str(), name.c_str(), xbins.size()-1, xbins.data() );
+        else
+            eff = new TEfficiency( name.c_str(), name.c_str(), xbins.size()-1, xbins.data(), ybins.size()-1, ybins.data() );
+
+        eff->SetUseWeightedEvents();
+        eff->SetTotalHistogram( *total, "f" );
+        eff->SetPassedHistogram( *passed, "f" );
+        eff->SetDirectory( &outputFile );
+        m_map_efficiencies[name] = eff;
+
+        delete passed;   // copied by TEfficiency (Set*Histogram)
+        delete total;
+    }
+    m_hists.clear();
 
     return;
 }
 
 
 
-void efficiency::fill( Event &event, const std::vector<unsigned int>& evtsel_decisions ){
+void efficiency::fill( Event &event, const unsigned int evtsel_decisions ){
     /* Fill efficiencies -- just use information from the event 
        This is the function to modify / inherit for analysis-specific purposes
        Example
@@ -98,16 +149,20 @@ void efficiency::fill( Event &event, const std::vector<unsigned int>& evtsel_dec
 }
 
 void efficiency::fill( const std::string &name, const double &value, const bool &decision, const double &weight ){
-    /* Fill efficiencies with values! */
-    m_map_efficiencies.at(name)->FillWeighted(decision, weight, value);
+    /* Fill efficiencies with values! (like TEfficiency::FillWeighted) */
+    std::pair<int,int> handles = m_handles.at(name);
+    m_hists[handles.second].fill(value, weight);
+    if (decision) m_hists[handles.first].fill(value, weight);
 
     return;
 }
 
 void efficiency::fill( const std::string &name, 
                          const double &xvalue, const double &yvalue, const bool &decision, const double &weight ){
-    /* Fill efficiencies with values! */
-    m_map_efficiencies.at(name)->Fill(decision, weight, xvalue, yvalue);
+    /* Fill efficiencies with values! (like TEfficiency::FillWeighted) */
+    std::pair<int,int> handles = m_handles.at(name);
+    m_hists[handles.second].fill(xvalue, yvalue, weight);
+    if (decision) m_hists[handles.first].fill(xvalue, yvalue, weight);
 
     return;
 }
@@ -0,0 +1,267 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Cache of the event selection results for each input file & tree.
+
+The first run records the entries that pass each selection (and the
+cutflows); later runs with the same selection only process those entries.
+The cache is keyed by:
+  - input file (UUID & size), tree, firstEvent, NEvents
+  - contents of the cuts files
+  - configuration options that can change the objects/selection
+  - definitionsVersion() of Event, eventSelection & selectionEngine
+    (object & quantity definitions; increment them when the definitions change)
+If any of these change, the cache is rebuilt automatically.
+*/
+#include "Analysis/CyMiniAna/interface/entryListCache.h"
+
+
+entryListCache::entryListCache(configuration &cmaConfig) :
+  m_config(&cmaConfig),
+  m_cached(false),
+  m_cacheFile(""),
+  m_key(""),
+  m_nextEntry(0){
+    m_entries.clear();
+    m_allEntries.clear();
+    m_cutflows.clear();
+    m_cutflowsStart.clear();
+  }
+
+entryListCache::~entryListCache() {}
+
+
+bool entryListCache::initialize(TFile& file, std::vector<eventSelection>& selections){
+    /* Setup the cache for this file & tree -- return true if the selection results can be re-used */
+    m_cached    = false;
+    m_nextEntry = 0;
+    m_entries.clear();
+    m_allEntries.clear();
+    m_cutflows.clear();
+    m_cutflowsStart.clear();
+
+    std::string cacheDirectory( m_config->entryListCache() );
+    struct stat dirBuffer;
+    if ( !(stat((cacheDirectory).c_str(),&dirBuffer)==0 && S_ISDIR(dirBuffer.st_mode)) ){
+        cma::DEBUG("ENTRYLISTCACHE : Creating directory for the cache: "+cacheDirectory);
+        if (gSystem->mkdir(cacheDirectory.c_str(), true)!=0){
+            cma::ERROR("ENTRYLISTCACHE : Cannot create the cache directory "+cacheDirectory);
+            cma::ERROR("ENTRYLISTCACHE : Exiting.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    m_cacheFile = cacheDirectory+"/"+md5( m_config->filename()+" "+m_config->treename() )+".txt";
+    m_key       = fingerprint(file,selections);
+
+    m_entries.resize( selections.size() );
+    for (auto& sel : selections)
+        m_cutflowsStart.push_back( sel.cutflowContents() );
+
+    m_cached = read();
+
+    if (m_cached){
+        // entries passing any selection, in the order they appear in the tree
+        for (const auto& entries : m_entries)
+            m_allEntries.insert( m_allEntries.end(), entries.begin(), entries.end() );
+        std::sort( m_allEntries.begin(), m_allEntries.end() );
+        m_allEntries.erase( std::unique(m_allEntries.begin(), m_allEntries.end()), m_allEntries.end() );
+
+        cma::INFO("ENTRYLISTCACHE : Using cached selection "+m_cacheFile+" ("+std::to_string(m_allEntries.size())+" entries)");
+    }
+    else
+        cma::INFO("ENTRYLISTCACHE : No valid cache, selection results will be saved to "+m_cacheFile);
+
+    return m_cached;
+}
+
+
+bool entryListCache::next(TTreeReader& reader){
+    /* Load the next cached entry into the TTreeReader */
+    if (m_nextEntry>=m_allEntries.size()) return false;
+
+    long long entry = m_allEntries.at(m_nextEntry);
+    m_nextEntry++;
+
+    if (reader.SetEntry(entry)!=TTreeReader::kEntryValid){
+        cma::WARNING("ENTRYLISTCACHE : Could not load entry "+std::to_string(entry));
+        return false;
+    }
+
+    return true;
+}
+
+
+void entryListCache::fill(const long long entry, const unsigned int evtsel_decisions){
+    /* Record the entry for each selection it passed */
+    if (m_cached) return;
+
+    for (unsigned int ss=0,size=m_entries.size(); ss<size; ss++){
+        if ((evtsel_decisions >> ss) & 1) m_entries.at(ss).push_back( entry );
+    }
+
+    return;
+}
+
+
+void entryListCache::finalize(std::vector<eventSelection>& selections){
+    /* Cached run:  set the cutflows from the cache (only passing entries were processed)
+       First run:   save the change in the cutflows and the entries to the cache
+    */
+    for (unsigned int ss=0,size=selections.size(); ss<size; ss++){
+        std::vector<double> cutflow = selections.at(ss).cutflowContents();
+        std::vector<double> start   = m_cutflowsStart.at(ss);
+
+        if (m_cached){
+            std::vector<double> delta = m_cutflows.at(ss);
+            for (unsigned int i=0,n=start.size(); i<n; i++)
+                start.at(i) += delta.at(i);
+            selections.at(ss).setCutflowContents( start );
+        }
+        else{
+            for (unsigned int i=0,n=cutflow.size(); i<n; i++)
+                cutflow.at(i) -= start.at(i);
+            m_cutflows.push_back( cutflow );
+        }
+    }
+
+    if (!m_cached) write();
+
+    return;
+}
+
+
+std::string entryListCache::fingerprint(TFile& file, std::vector<eventSelection>& selections){
+    /* Key of the cache: everything that can change which entries pass the selection */
+    std::stringstream key;
+    key << file.GetUUID().AsString() << " " << file.GetSize() << " " << m_config->treename();
+
+    // configuration options that only change the outputs
+    std::vector<std::string> outputOptions = {"makeTTree","makeHistograms","makeEfficiencies",
+                                              "sparseHistogramBins","histogramsFile",
+                                              "slimmingFile","compressionAlgorithm","compressionLevel",
+                                              "basketSize","autoFlush","asyncOutput","outputQueueSize",
+                                              "entryListCache","output_path","customDirectory",
+                                              "calcWeightSystematics","weightSystematicsFile",
+                                              "weightVectorSystematicsFile","inputfile","treenames",
+                                              "verboseLevel"};
+    for (const auto& option : m_config->configOptions()){
+        if (std::find(outputOptions.begin(), outputOptions.end(), option.first)!=outputOptions.end())
+            continue;
+        key << " " << option.first << "=" << option.second;
+    }
+
+    // cuts (ignoring comments)
+    for (auto& sel : selections){
+        std::vector<std::string> cuts;
+        cma::read_file( sel.cutsfile(), cuts );
+
+        key << " " << sel.selection();
+        for (const auto& cut : cuts) key << " " << cut;
+    }
+
+    // object definitions
+    key << " v" << Event::definitionsVersion() << "." << eventSelection::definitionsVersion()
+        << "." << selectionEngine::definitionsVersion();
+
+    return md5( key.str() );
+}
+
+
+bool entryListCache::read(){
+    /* Read the cache file -- return false if it is missing or out-of-date */
+    std::ifstream cache(m_cacheFile);
+    if (!cache.is_open()) return false;
+
+    std::string line;
+    std::string key("");
+    std::vector<std::vector<double>> cutflows( m_entries.size() );
+
+    while (std::getline(cache,line)){
+        std::stringstream lineStream(line);
+        std::string type;
+        unsigned int index(0);
+        unsigned int size(0);
+
+        lineStream >> type;
+        if (type.compare("key")==0){
+            lineStream >> key;
+            if (key.compare(m_key)!=0){
+                cma::INFO("ENTRYLISTCACHE : Selection or input changed, rebuilding "+m_cacheFile);
+                return false;
+            }
+            continue;
+        }
+
+        lineStream >> index >> size;
+        if (index>=m_entries.size()) return false;
+
+        if (type.compare("selection")==0){
+            m_entries.at(index).resize(size);
+            for (unsigned int i=0; i<size; i++) lineStream >> m_entries.at(index).at(i);
+        }
+        else if (type.compare("cutflow")==0){
+            cutflows.at(index).resize(size);
+            for (unsigned int i=0; i<size; i++) lineStream >> cutflows.at(index).at(i);
+        }
+
+        if (lineStream.fail()){
+            cma::WARNING("ENTRYLISTCACHE : Corrupted cache "+m_cacheFile+", rebuilding it");
+            return false;
+        }
+    }
+
+    // the cutflows must match the current histograms
+    if (key.size()<1) return false;
+    for (unsigned int ss=0,size=cutflows.size(); ss<size; ss++){
+        if (cutflows.at(ss).size()!=m_cutflowsStart.at(ss).size()) return false;
+    }
+    m_cutflows = cutflows;
+
+    return true;
+}
+
+
+void entryListCache::write(){
+    /* Write the cache file (to a temporary file first, so a crash never leaves a partial cache) */
+    std::string tmpFile = m_cacheFile+".tmp";
+    std::ofstream cache(tmpFile);
+    cache.precision(17);          // exact round-trip of the cutflow values
+
+    cache << "key " << m_key << std::endl;
+    for (unsigned int ss=0,size=m_entries.size(); ss<size; ss++){
+        cache << "selection " << ss << " " << m_entries.at(ss).size();
+        for (const auto& entry : m_entries.at(ss)) cache << " " << entry;
+        cache << std::endl;
+
+        cache << "cutflow " << ss << " " << m_cutflows.at(ss).size();
+        for (const auto& value : m_cutflows.at(ss)) cache << " " << value;
+        cache << std::endl;
+    }
+    cache.close();
+
+    if (std::rename(tmpFile.c_str(), m_cacheFile.c_str())!=0)
+        cma::WARNING("ENTRYLISTCACHE : Could not write the cache "+m_cacheFile);
+    else
+        cma::INFO("ENTRYLISTCACHE : Saved selection results to "+m_cacheFile);
+
+    return;
+}
+
+
+std::string entryListCache::md5(const std::string& text){
+    /* MD5 checksum of a string */
+    TMD5 checksum;
+    checksum.Update( (const UChar_t*)text.c_str(), text.size() );
+    checksum.Final();
+
+    return checksum.AsString();
+}
+
+// THE END
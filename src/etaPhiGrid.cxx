@@ -0,0 +1,163 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Grid in (eta,phi) to find the objects within DeltaR of another object
+without looping over all pairs.
+Built once per event for a collection (e.g., truth jets), then
+queried for each object that is matched to it.
+*/
+#include "Analysis/CyMiniAna/interface/etaPhiGrid.h"
+
+
+etaPhiGrid::etaPhiGrid( const double radius, const double maxEta ) :
+  m_cellSize(radius),
+  m_maxEta(maxEta),
+  m_phiWidth(2*M_PI),
+  m_margin(1e-5),
+  m_nEta(1),
+  m_nPhi(1){
+    if (!(m_cellSize>0)) m_cellSize = 0.4;
+
+    m_nEta = std::max( 1, int(std::ceil(2*m_maxEta/m_cellSize)) );
+    m_nPhi = std::max( 1, int(std::floor(2*M_PI/m_cellSize)) );
+    m_phiWidth = 2*M_PI / m_nPhi;            // >= cell size
+
+    m_cellStart.assign(m_nEta*m_nPhi+1,0);
+  }
+
+etaPhiGrid::~etaPhiGrid() {}
+
+
+void etaPhiGrid::build( const std::vector<TLorentzVector>& vectors ){
+    /* Index a collection of four-vectors */
+    m_eta.clear();
+    m_phi.clear();
+    for (const auto& p4 : vectors){
+        m_eta.push_back( p4.Eta() );
+        m_phi.push_back( p4.Phi() );
+    }
+    index();
+
+    return;
+}
+
+
+void etaPhiGrid::clear(){
+    /* Remove all objects */
+    m_eta.clear();
+    m_phi.clear();
+    m_cellObjects.clear();
+    std::fill( m_cellStart.begin(), m_cellStart.end(), 0 );
+
+    return;
+}
+
+
+unsigned int etaPhiGrid::etaCell( const double eta ) const{
+    /* Eta cell (objects beyond the grid are in the first/last cell) */
+    double cell = std::floor( (eta+m_maxEta)/m_cellSize );
+    if (cell<0) return 0;
+    else if (cell>=m_nEta) return m_nEta-1;
+    return cell;
+}
+
+
+unsigned int etaPhiGrid::phiCell( const double phi ) const{
+    /* Phi cell of phi in [-pi,pi] */
+    int cell = std::floor( (phi+M_PI)/m_phiWidth );
+    cell %= int(m_nPhi);
+    if (cell<0) cell += m_nPhi;
+    return cell;
+}
+
+
+void etaPhiGrid::index(){
+    /* Sort the objects into the cells (counting sort: objects in each cell keep their order) */
+    unsigned int nObjects = m_eta.size();
+    std::vector<unsigned int> cells(nObjects,0);
+
+    std::fill( m_cellStart.begin(), m_cellStart.end(), 0 );
+    for (unsigned int i=0; i<nObjects; i++){
+        if (std::isnan(m_eta[i]) || std::isnan(m_phi[i])){
+            cells[i] = m_nEta*m_nPhi;              // never within DeltaR of anything
+            continue;
+        }
+        cells[i] = etaCell(m_eta[i])*m_nPhi + phiCell(m_phi[i]);
+        m_cellStart[cells[i]+1]++;
+    }
+    for (unsigned int c=0, nCells=m_nEta*m_nPhi; c<nCells; c++)
+        m_cellStart[c+1] += m_cellStart[c];
+
+    std::vector<unsigned int> next(m_cellStart.begin(),m_cellStart.end()-1);
+    m_cellObjects.assign(m_cellStart.back(),-1);
+    for (unsigned int i=0; i<nObjects; i++){
+        if (cells[i]==m_nEta*m_nPhi) continue;
+        m_cellObjects[ next[cells[i]]++ ] = i;
+    }
+
+    return;
+}
+
+
+double etaPhiGrid::deltaR( const TLorentzVector& p4, const unsigned int index ) const{
+    /* Same as TLorentzVector::DeltaR */
+    double deta = p4.Eta() - m_eta[index];
+    double dphi = TVector2::Phi_mpi_pi( p4.Phi() - m_phi[index] );
+    return std::sqrt( deta*deta + dphi*dphi );
+}
+
+
+void etaPhiGrid::candidates( const TLorentzVector& p4, const double dR, std::vector<int>& indices ) const{
+    /* Objects in the cells that can be within dR */
+    indices.clear();
+    visit( p4.Eta(), p4.Phi(), dR, [&indices](int i){ indices.push_back(i); } );
+    std::sort( indices.begin(), indices.end() );
+
+    return;
+}
+
+
+void etaPhiGrid::within( const TLorentzVector& p4, const double dR, std::vector<int>& indices ) const{
+    /* Objects with DeltaR < dR */
+    indices.clear();
+    double eta = p4.Eta();
+    double phi = p4.Phi();
+
+    visit( eta, phi, dR, [&](int i){
+        double deta = eta - m_eta[i];
+        double dphi = TVector2::Phi_mpi_pi( phi - m_phi[i] );
+        if (std::sqrt(deta*deta + dphi*dphi) < dR) indices.push_back(i);
+    });
+    std::sort( indices.begin(), indices.end() );
+
+    return;
+}
+
+
+int etaPhiGrid::nearest( const TLorentzVector& p4, const double dR ) const{
+    /* Object with the smallest DeltaR < dR (same as looping over the objects with 'if (deltaR<best)') */
+    int best(-1);
+    double bestDR(dR);
+    double eta = p4.Eta();
+    double phi = p4.Phi();
+
+    visit( eta, phi, dR, [&](int i){
+        double deta = eta - m_eta[i];
+        double dphi = TVector2::Phi_mpi_pi( phi - m_phi[i] );
+        double thisDR = std::sqrt( deta*deta + dphi*dphi );
+        if (thisDR < bestDR || (thisDR==bestDR && best>=0 && i<best)){
+            best   = i;
+            bestDR = thisDR;
+        }
+    });
+
+    return best;
+}
+
+// THE END
@@ -24,17 +24,21 @@ Recommended Use:
     argument for 'level' and use 'm_selection' to define the cuts
 */
 #include "Analysis/CyMiniAna/interface/eventSelection.h"
+#include "Analysis/CyMiniAna/interface/selectionEngine.h"
 
 
 eventSelection::eventSelection(configuration &cmaConfig, const std::string &level) :
   m_config(&cmaConfig),
+  m_engine(nullptr),
   m_level(level),
   m_selection("SetMe"),
   m_cutsfile("SetMe"),
   m_numberOfCuts(0),
-  m_dummySelection(false),
-  m_isOneLeptonAnalysis(false),
-  m_isOneLeptonSignalAnalysis(false){
+  m_cutOrderWarmup(0),
+  m_nWarmupEvents(0),
+  m_cutflowHandle(-1),
+  m_cutflowHandle_unw(-1),
+  m_dummySelection(false){
     m_cuts.resize(0);
     m_cutflowNames.clear();
   }
@@ -46,32 +50,27 @@ void eventSelection::initialize(const std::string& selection, const std::string&
     m_selection = selection;
     m_cutsfile  = cutsfile;
 
-    m_ejetsTriggers      = m_config->ejetsTriggers();
-    m_mujetsTriggers     = m_config->mujetsTriggers();
-
     initialize( m_cutsfile );
 
     return;
 }
 
 void eventSelection::initialize(const std::string &cutsfile) {
-    /* Load cut values using specific name for cutsfile */
-    std::ifstream file = cma::open_file(cutsfile);
+    /* Load cut values using specific name for cutsfile 
+       Each line is one cut (one bin in the cutflow), e.g.,
+         N_AK4 >= 2
+         N_LEP == 1 && N_EL == 1
+       All conditions joined by '&&' must pass; the cut is named after the first quantity.
+       The quantities are defined in selectionEngine::quantity()
+    */
+    m_cutsfile = cutsfile;
+
+    std::vector<std::string> lines;
+    cma::read_file( cutsfile, lines );
 
-    // Read one line at a time into the vector of Cut structs:
-    // this only stores information, but can be expanded
     m_cuts.clear();
-    std::string line;
-    if (file.is_open()){
-        while(std::getline(file, line)){
-            std::stringstream  lineStream(line);
-            Cut tmp_cut;
-            // read line
-            lineStream >> tmp_cut.name >> tmp_cut.comparison >> tmp_cut.value;
-            m_cuts.push_back(tmp_cut);
-        }
-        file.close();
-    } // end reading cuts file
+    for (const auto& line : lines)
+        m_cuts.push_back( compileCut(line) );
 
     // Get the number of cuts (for cutflow histogram binning)
     m_numberOfCuts = m_cuts.size();
@@ -83,6 +82,22 @@ void eventSelection::initialize(const std::string &cutsfile) {
     // Identify the selection this instance will apply
     identifySelection();
 
+    // Adaptive cut order (measured over the first 'cutOrderWarmup' events)
+    m_cutOrderWarmup = m_config->cutOrderWarmup();
+    m_nWarmupEvents  = 0;
+    m_cutOrder.clear();
+    for (unsigned int c=0; c<m_numberOfCuts; c++) m_cutOrder.push_back(c);
+    m_cutPass.assign(m_numberOfCuts,0.);
+    m_cutTime.assign(m_numberOfCuts,0.);
+    m_cutEvaluated.assign(m_numberOfCuts,0);
+
+    return;
+}
+
+
+void eventSelection::setEngine(selectionEngine* engine){
+    /* Selection engine that evaluates (and shares) the conditions of the cuts */
+    m_engine = engine;
     return;
 }
 
@@ -91,14 +106,40 @@ void eventSelection::identifySelection(){
     /* Set the booleans for applying the selection below */
     m_dummySelection       = m_selection.compare("none")==0;          // no selection
 
-    // Analysis cuts :: e/mu/l+jets
-    m_isOneLeptonAnalysis       = (m_selection.compare("ejets")==0 || m_selection.compare("mujets")==0 || m_selection.compare("ljets")==0);
-    m_isOneLeptonSignalAnalysis = m_selection.compare("signal_ejets")==0 || m_selection.compare("signal_mujets")==0;
-
     return;
 }
 
 
+eventSelection::Cut eventSelection::compileCut(const std::string& line){
+    /* Turn one line of the cuts file into a list of predicates (from the selection engine) */
+    std::istringstream lineStream(line);
+    std::istream_iterator<std::string> start(lineStream), stop;
+    std::vector<std::string> tokens(start, stop);
+
+    Cut cut;
+    cut.name = (tokens.size()>0) ? tokens.at(0) : "";
+    cut.predicates.clear();
+
+    // expect: QUANTITY COMPARISON VALUE [&& QUANTITY COMPARISON VALUE ...]
+    for (unsigned int t=0, size=tokens.size(); t<size; t+=4){
+        float value(0);
+        bool validCondition = (t+2<size) && (t+3==size || tokens.at(t+3).compare("&&")==0) &&
+                              cma::str2number( tokens.at(t+2), value );
+        int predicate = (validCondition && m_engine) ? m_engine->addPredicate( tokens.at(t), tokens.at(t+1), value ) : -1;
+
+        if (predicate<0){
+            cma::ERROR("EVENTSELECTION : Cannot compile cut '"+line+"' in "+m_cutsfile);
+            cma::ERROR("EVENTSELECTION : Expected 'QUANTITY COMPARISON VALUE', joined by '&&'");
+            exit(EXIT_FAILURE);
+        }
+
+        cut.predicates.push_back( predicate );
+    }
+
+    return cut;
+}
+
+
 void eventSelection::setCutflowHistograms(TFile& outputFile){
     /* Set the cutflow histograms to use in the framework -- 
        can modify this function to generate histograms with different names
@@ -110,16 +151,36 @@ void eventSelection::setCutflowHistograms(TFile& outputFile){
     */
     outputFile.cd();
 
-    m_cutflow     = new TH1D( (m_selection+"_cutflow").c_str(),(m_selection+"_cutflow").c_str(),m_numberOfCuts+1,0,m_numberOfCuts+1);
-    m_cutflow_unw = new TH1D( (m_selection+"_cutflow_unweighted").c_str(),(m_selection+"_cutflow_unweighted").c_str(),m_numberOfCuts+1,0,m_numberOfCuts+1);
+    m_cutflows.clear();
+    flatHist::Axis cuts = {m_numberOfCuts+1,0.,double(m_numberOfCuts+1),{}};
+    m_cutflowHandle     = m_cutflows.book( {m_selection+"_cutflow"}, {cuts} );
+    m_cutflowHandle_unw = m_cutflows.book( {m_selection+"_cutflow_unweighted"}, {cuts} );
+    m_cutflows.merged().at(m_cutflowHandle_unw).setSumw2(false);   // like TH1::Fill without weights
 
-    m_cutflow->GetXaxis()->SetBinLabel(1,"INITIAL");
-    m_cutflow_unw->GetXaxis()->SetBinLabel(1,"INITIAL");
+    return;
+}
+
+
+void eventSelection::setNumberOfShards( const unsigned int nShards ){
+    /* One copy of the cutflows per thread filling them (after setCutflowHistograms) -- see histShards */
+    m_cutflows.setNumberOfShards( nShards );
+    return;
+}
 
-    for (unsigned int c=1;c<=m_numberOfCuts;++c){
-        m_cutflow->GetXaxis()->SetBinLabel(c+1,m_cutflowNames.at(c-1).c_str());
-        m_cutflow_unw->GetXaxis()->SetBinLabel(c+1,m_cutflowNames.at(c-1).c_str());
+
+void eventSelection::finalizeCutflowHistograms(TFile& outputFile){
+    /* Make the cutflow TH1D in the output file (before writing the file) */
+    outputFile.cd();
+    m_cutflows.merge();    // add the cutflows filled by each thread
+
+    for (const auto& handle : {m_cutflowHandle,m_cutflowHandle_unw}){
+        TH1* cutflow = m_cutflows.merged().at(handle).materialize().at(0);
+
+        cutflow->GetXaxis()->SetBinLabel(1,"INITIAL");
+        for (unsigned int c=1;c<=m_numberOfCuts;++c)
+            cutflow->GetXaxis()->SetBinLabel(c+1,m_cutflowNames.at(c-1).c_str());
     }
+    m_cutflows.clear();
 
     return;
 }
@@ -139,7 +200,6 @@ bool eventSelection::applySelection(const Event &event) {
     */
     bool passSelection(false);
 
-    m_nominal_weight = event.nominal_weight();
     double first_bin(0.5);            // first bin value in cutflow histogram ("INITIAL")
 
     // FIRST CHECK IF VALID EVENT FROM TREE
@@ -147,237 +207,188 @@ bool eventSelection::applySelection(const Event &event) {
         return false;             // skip event
 
 
-    // fill cutflow histograms with initial value (before any cuts)
-    fillCutflows(first_bin);
-
-
     // no selection applied
-    if (m_dummySelection)
+    if (m_dummySelection){
+        m_nominal_weight = m_engine->weight();
+        fillCutflows(first_bin);  // fill cutflow histograms with initial value (before any cuts)
         return true;              // event 'passed'  
+    }
 
 
-    // set physics objects
-    m_jets  = event.jets();
-    m_ljets = event.ljets();
-    m_leptons = event.leptons();
-    //m_muons = event.muons();
-    //m_electrons = event.electrons();
-    m_neutrinos = event.neutrinos();
-    m_met = event.met();
-    m_ht  = event.HT();
-    m_st  = event.ST();
-
-    m_triggers = event.triggers();
-    m_filters  = event.filters();
-    // add more objects as needed
-
-    std::vector<int> btags = event.btag_jets();
-    m_Nbtags     = btags.size();
-    m_NLjets     = m_ljets.size();
-    m_NJets      = m_jets.size();
-    m_NLeptons   = m_leptons.size();
-
-    m_NMuons     = 0;   //m_muons.size();
-    m_NElectrons = 0;   //m_electrons.size();
-    for (const auto x : m_leptons){
-        if (x.isMuon) m_NMuons++;
-        else m_NElectrons++;
-    }
+    // Perform selection (compiled from the cuts file)
+    passSelection = evaluateCuts(first_bin);
+
+    return passSelection;
+}
+
 
-    // Perform selections
-    // -- use if/else if statements to maintain orthogonality
+// ******************************************************* //
+
+bool eventSelection::evaluateCuts(double cutflow_bin){
+    /* Apply the cuts 
+       -- stop at the first cut that fails (short-circuit)
+       -- fill the cutflow ("INITIAL" at 'cutflow_bin') and every cut (in the order of the cuts file)
+          before the first failure; the event weight is only requested now, so the cuts decide
+          whether the physics objects have to be built
+    */
+    unsigned int firstFail(m_numberOfCuts);   // first failing cut in the order of the cuts file
 
-    // -- Filter (only necessary for data -- need to pass ALL filters)
-    bool passFilter(true);
-    if (!m_config->isMC()){
-        for (const auto& x : m_filters){
-            if (!x.second){
-                passFilter = false;
+    if (m_cutOrderWarmup<1){
+        for (unsigned int c=0; c<m_numberOfCuts; c++){
+            if (!passCut(c)){
+                firstFail = c;
                 break;
             }
         }
     }
-    if (!passFilter) return false;
-    fillCutflows(first_bin+1);
+    else if (m_nWarmupEvents<m_cutOrderWarmup)
+        firstFail = measureCuts();
+    else
+        firstFail = adaptiveCuts();
 
+    m_nominal_weight = m_engine->weight();
+    for (unsigned int c=0; c<=firstFail; c++)
+        fillCutflows(cutflow_bin+c);
 
+    return (firstFail==m_numberOfCuts);
+}
 
-    // -- Single lepton analysis
-    if (m_isOneLeptonAnalysis){
-        passSelection = oneLeptonSelection(first_bin+2);
-    }
 
-    else if (m_isOneLeptonSignalAnalysis){
-        passSelection = oneLeptonSignalSelection(first_bin+2);
+bool eventSelection::passCut(const unsigned int index){
+    /* Check if all conditions of one cut pass */
+    for (const auto& predicate : m_cuts.at(index).predicates){
+        if ( !m_engine->predicate(predicate) )
+            return false;
     }
 
-    return passSelection;
+    return true;
 }
 
 
-// ******************************************************* //
-
-bool eventSelection::ejetsSelection(double cutflow_bin, const Lepton& lep){
-    /* Check if event passes selection; called from 1-lepton selection
-       -- Following CMS AN-2016/174
+unsigned int eventSelection::measureCuts(){
+    /* Warm-up for the adaptive cut order:
+       evaluate every cut and record its pass rate & time.
+       The predicates are cached as in the normal event loop; the time of a cut is the
+       time its predicates took the first time they were computed in this event
+       (so a cut doesn't look cheap because another cut computed its predicates).
+       Return the first failing cut in the order of the cuts file.
     */
-    bool pass(false);
-
-    // cut5 :: MET > 50 GeV
-    if ( m_met.p4.Pt() < 50 )
-        return false;
-    else{
-        fillCutflows(cutflow_bin);
-        pass = true;
-    }
+    unsigned int firstFail(m_numberOfCuts);
+
+    m_engine->timePredicates(true);
+    for (unsigned int c=0; c<m_numberOfCuts; c++){
+        bool pass(true);
+        for (const auto& predicate : m_cuts.at(c).predicates){
+            pass = m_engine->predicate(predicate);
+            m_cutTime.at(c) += m_engine->predicateTime(predicate);
+            if (!pass) break;      // the rest of the cut is not evaluated (same as passCut)
+        }
 
-/*
-    // cut6 :: DeltaPhi(e,MET)
-    float met_triangle = 1.5*m_met.p4.Pt() / 110.;
-    if ( std::abs(lep.p4.DeltaPhi(m_met.p4)-1.5) > met_triangle )
-        return false;
-    else{
-        fillCutflows(cutflow_bin+1);
-        pass = true;
+        if (pass) m_cutPass.at(c)++;
+        else if (firstFail==m_numberOfCuts) firstFail = c;
     }
+    m_engine->timePredicates(false);
 
-    // cut7 :: DeltaPhi(leading AK4,MET)
-    if ( std::abs(m_jets.at(0).p4.DeltaPhi(m_met.p4)-1.5) > met_triangle )
-        return false;
-    else{
-        fillCutflows(cutflow_bin+2);
-        pass = true;
-    }
-*/
+    m_nWarmupEvents++;
+    if (m_nWarmupEvents==m_cutOrderWarmup) orderCuts();
 
-    return pass;
+    return firstFail;
 }
 
 
-bool eventSelection::mujetsSelection(double cutflow_bin){
-    /* Check if event passes selection; called from 1-lepton selection
-       -- Following CMS AN-2016/174
-    */
-    bool pass(false);
-
-    // cut5 :: MET > 35 GeV
-    if ( m_met.p4.Pt() < 35 )
-        return false;
-    else{
-        fillCutflows(cutflow_bin);
-        pass = true;
+void eventSelection::orderCuts(){
+    /* Evaluate the cuts that reject the most events per unit time first */
+    std::vector<double> score(m_numberOfCuts,0.);
+    for (unsigned int c=0; c<m_numberOfCuts; c++){
+        double rejection = 1. - m_cutPass.at(c)/m_nWarmupEvents;
+        double cost      = m_cutTime.at(c)/m_nWarmupEvents + 1.;   // [ns]; avoid dividing by 0
+        score.at(c) = rejection / cost;
     }
 
-    return pass;
+    std::stable_sort( m_cutOrder.begin(), m_cutOrder.end(),
+                      [&score](const unsigned int a, const unsigned int b){ return score.at(a)>score.at(b); } );
+
+    std::string order("");
+    for (const auto& c : m_cutOrder) order += " "+m_cuts.at(c).name;
+    cma::INFO("EVENTSELECTION : "+m_selection+" cut order after "+std::to_string(m_nWarmupEvents)+" events:"+order);
+
+    return;
 }
 
 
-bool eventSelection::oneLeptonSelection(double cutflow_bin){
-    /* Check if event passes selection 
-       -- Following CMS AN-2016/174
-       -- add b-tagging, others?
-       -- separate boosted (AK8) & resolved (4 AK4)?
+unsigned int eventSelection::adaptiveCuts(){
+    /* Evaluate the cuts in the measured order.
+       When a cut fails, the cuts before it in the cuts file (that were not evaluated yet)
+       are checked to find the first failing cut for the cutflow.
     */
-    bool pass(false);
-
-
-    // selection based on lepton -- e+jets or mu+jets
-    // only do selection if the user requested a specific
-    // lepton flavor
-    // e.g., if user selected "ejets", don't do mu+jets selection!
-    bool ljets  = m_selection.find("ljets")!=std::string::npos;    // general "lepton+jets" selection
-    bool ejets  = m_selection.find("ejets")!=std::string::npos;
-    bool mujets = m_selection.find("mujets")!=std::string::npos;
-
-    // cut0 :: One lepton
-    bool nLeptons(false);
-    if (ejets)       nLeptons = (m_NElectrons==1 && m_NMuons==0);
-    else if (mujets) nLeptons = (m_NMuons==1 && m_NElectrons==0);
-    else if (ljets)  nLeptons = (m_NLeptons==1);
-
-    if ( !nLeptons )
-        return false;          // exit the function now; no need to test other cuts!
-    else{
-        fillCutflows(cutflow_bin);
-        pass = true;
-    }
-
-    Lepton lep = m_leptons.at(0);
+    std::fill( m_cutEvaluated.begin(), m_cutEvaluated.end(), 0 );
 
-    // cut1 :: triggers -- different triggers depending on the lepton
-    // -- Need at least 1 trigger to pass
-    unsigned int passTrig(0);
-    std::vector<std::string> oneLeptonTriggers = (lep.isElectron) ? m_ejetsTriggers : m_mujetsTriggers;
-    for (const auto& trig : oneLeptonTriggers){
-        if (m_triggers.at(trig)) passTrig++;
-    }
+    for (const auto& c : m_cutOrder){
+        if (passCut(c)){
+            m_cutEvaluated.at(c) = 1;
+            continue;
+        }
 
-    if (passTrig<1)
-        return false;
-    else{
-        fillCutflows(cutflow_bin+1);
-        pass = true;
+        for (unsigned int d=0; d<c; d++){
+            if (!m_cutEvaluated.at(d) && !passCut(d)) return d;
+        }
+        return c;
     }
 
+    return m_numberOfCuts;
+}
 
-    // cut2 :: >=2 jets (bblv final state)
-    if ( m_NJets < 2 )
-        return false;  // exit the function now; no need to test other cuts!
-    else{
-        fillCutflows(cutflow_bin+2);
-        pass = true;
-    }
 
-/*
-    if (ljets){
-        // Do the selection based on which lepton flavor we have in the event
-        if (m_NElectrons==1) pass = ejetsSelection(cutflow_bin+3,lep);
-        else pass = mujetsSelection(cutflow_bin+3);
-    }
-    else{
-        // Only do the el (mu) selection if the user request e+jets (mu+jets)
-        pass = (ejets) ? ejetsSelection(cutflow_bin+3,lep) : mujetsSelection(cutflow_bin+3);
-    }
-*/
+// -- Helper functions
 
-    return pass;
+void eventSelection::fillCutflows(double cutflow_bin){
+    /* Fill cutflow histograms with weight at specific bin */
+    m_cutflows[m_cutflowHandle].fill(cutflow_bin,m_nominal_weight);  // fill cutflow
+    m_cutflows[m_cutflowHandle_unw].fill(cutflow_bin,1.0);
+    return;
 }
 
+std::vector<double> eventSelection::cutflowContents(){
+    /* Contents of the cutflow histograms: 
+       (content, error^2) for each bin of the weighted, then the unweighted, cutflow
+    */
+    std::vector<double> contents;
+    m_cutflows.merge();
+    for (const auto& handle : {m_cutflowHandle,m_cutflowHandle_unw}){
+        const flatHist& h = m_cutflows.merged().at(handle);
+        for (unsigned int bin=1; bin<=m_numberOfCuts+1; bin++){
+            contents.push_back( h.binContent(bin) );
+            contents.push_back( h.binError2(bin) );
+        }
+    }
 
-bool eventSelection::oneLeptonSignalSelection(double cutflow_bin){
-    /* */
-    bool pass(false);
-
-    // cut0 :: single lepton
-    pass = oneLeptonSelection(cutflow_bin);  // should be 3 cuts (trigger, lepton, AK4)
-    if (!pass) return pass;
+    return contents;
+}
 
-    // cut1 :: >= 1 b-tag
-    if (m_Nbtags<1)
-        return false;
-    else{
-        fillCutflows(cutflow_bin+3);
-        pass = true;
+void eventSelection::setCutflowContents(const std::vector<double>& contents){
+    /* Set the cutflow histograms from the output of cutflowContents() */
+    if (contents.size()!=4*(m_numberOfCuts+1)){
+        cma::WARNING("EVENTSELECTION : Cannot set cutflow for "+m_selection+" (wrong number of bins)");
+        return;
     }
 
-    // cut2 :: ST > 600 GeV
-    if (m_st<600)
-        return false;
-    else{
-        fillCutflows(cutflow_bin+4);
-        pass = true;
+    unsigned int idx(0);
+    m_cutflows.merge();
+    for (const auto& handle : {m_cutflowHandle,m_cutflowHandle_unw}){
+        flatHist& h = m_cutflows.merged().at(handle);
+        for (unsigned int bin=1; bin<=m_numberOfCuts+1; bin++){
+            h.setBinContent( bin, 0, contents.at(idx), contents.at(idx+1) );
+            idx+=2;
+        }
     }
 
-    return pass;
+    return;
 }
 
-// -- Helper functions
-
-void eventSelection::fillCutflows(double cutflow_bin){
-    /* Fill cutflow histograms with weight at specific bin */
-    m_cutflow->Fill(cutflow_bin,m_nominal_weight);  // fill cutflow
-    m_cutflow_unw->Fill(cutflow_bin);
-    return;
+unsigned int eventSelection::definitionsVersion(){
+    /* Version of the selection code (used to invalidate cached selection results)
+       Increment this when a change in this file modifies which events pass a selection */
+    return 1;
 }
 
 void eventSelection::getCutNames(){
@@ -0,0 +1,221 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Histogram with flat arrays of sum(w) & sum(w^2) for one or more weight variations,
+allocated in blocks on the first fill.
+Filled in the event loop, then converted into a TH1D/TH2D/TH3D
+with the same name when the output file is written.
+*/
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+
+
+flatHist::flatHist( const std::vector<std::string>& names, const std::vector<Axis>& axes, const unsigned int blockSize ) :
+  m_names(names),
+  m_axes(axes),
+  m_nWeights(names.size()),
+  m_nCells(1),
+  m_blockShift(0),
+  m_storeSumw2(true){
+    for (const auto& axis : m_axes)
+        m_nCells *= axis.nBins+2;
+
+    // smallest power of 2 >= block size (all bins for blockSize=0)
+    unsigned int cells = (blockSize>0 && blockSize<m_nCells) ? blockSize : m_nCells;
+    while ((1u << m_blockShift) < cells) m_blockShift++;
+
+    unsigned int nBlocks = ((m_nCells-1) >> m_blockShift) + 1;
+    m_sumw.resize(nBlocks);
+    m_sumw2.resize(nBlocks);
+    m_stats.assign(11*m_nWeights,0.);
+    m_entries.assign(m_nWeights,0.);
+  }
+
+flatHist::~flatHist() {}
+
+
+void flatHist::allocate( const unsigned int block ){
+    /* First fill in this block */
+    m_sumw[block].assign(blockCells(block)*m_nWeights,0.);
+    m_sumw2[block].assign(blockCells(block)*m_nWeights,0.);
+    return;
+}
+
+
+unsigned int flatHist::blockCells( const unsigned int block ) const{
+    /* Number of bins in a block (the last one can be smaller) */
+    unsigned int first = block << m_blockShift;
+    return std::min( 1u << m_blockShift, m_nCells-first );
+}
+
+
+unsigned long long flatHist::allocatedBytes() const{
+    /* Memory used by the bins of all weight variations */
+    unsigned long long bytes(0);
+    for (unsigned int block=0,size=m_sumw.size(); block<size; block++)
+        bytes += sizeof(double)*(m_sumw[block].size()+m_sumw2[block].size());
+
+    return bytes;
+}
+
+
+double flatHist::binContent( const unsigned int bin, const unsigned int variation ) const{
+    /* sum(w) in one bin */
+    unsigned int block = bin >> m_blockShift;
+    if (m_sumw[block].empty()) return 0.;
+    return m_sumw[block][(bin-(block << m_blockShift))*m_nWeights+variation];
+}
+
+
+double flatHist::binError2( const unsigned int bin, const unsigned int variation ) const{
+    /* sum(w^2) in one bin */
+    unsigned int block = bin >> m_blockShift;
+    if (m_sumw2[block].empty()) return 0.;
+    return m_sumw2[block][(bin-(block << m_blockShift))*m_nWeights+variation];
+}
+
+
+std::vector<TH1*> flatHist::materialize() const{
+    /* Make the TH1D/TH2D/TH3D (one per weight variation) with the contents, Sumw2, & statistics */
+    std::vector<TH1*> hists;
+
+    for (unsigned int v=0; v<m_nWeights; v++){
+        TH1* hist(nullptr);
+        const char* name = m_names.at(v).c_str();
+
+        if (m_axes.size()==1){
+            const Axis& x = m_axes.at(0);
+            hist = (x.edges.empty()) ? new TH1D(name,name,x.nBins,x.min,x.max)
+                                     : new TH1D(name,name,x.nBins,x.edges.data());
+        }
+        else if (m_axes.size()==2){
+            // equal & variable bins can be mixed
+            const Axis& x = m_axes.at(0);
+            const Axis& y = m_axes.at(1);
+            if (x.edges.empty() && y.edges.empty())
+                hist = new TH2D(name,name,x.nBins,x.min,x.max,y.nBins,y.min,y.max);
+            else if (x.edges.empty())
+                hist = new TH2D(name,name,x.nBins,x.min,x.max,y.nBins,y.edges.data());
+            else if (y.edges.empty())
+                hist = new TH2D(name,name,x.nBins,x.edges.data(),y.nBins,y.min,y.max);
+            else
+                hist = new TH2D(name,name,x.nBins,x.edges.data(),y.nBins,y.edges.data());
+        }
+        else{
+            // TH3D has no constructor for mixed bins: all variable if one axis is
+            const Axis& x = m_axes.at(0);
+            const Axis& y = m_axes.at(1);
+            const Axis& z = m_axes.at(2);
+            if (x.edges.empty() && y.edges.empty() && z.edges.empty())
+                hist = new TH3D(name,name,x.nBins,x.min,x.max,y.nBins,y.min,y.max,z.nBins,z.min,z.max);
+            else{
+                std::vector<double> xbins = binEdges(x);
+                std::vector<double> ybins = binEdges(y);
+                std::vector<double> zbins = binEdges(z);
+                hist = new TH3D(name,name,x.nBins,xbins.data(),y.nBins,ybins.data(),z.nBins,zbins.data());
+            }
+        }
+        if (m_storeSumw2) hist->Sumw2();
+
+        // TH1D/TH2D/TH3D are also TArrayD -> copy the bins directly
+        double* sumw(nullptr);
+        if (m_axes.size()==1)      sumw = static_cast<TH1D*>(hist)->GetArray();
+        else if (m_axes.size()==2) sumw = static_cast<TH2D*>(hist)->GetArray();
+        else                       sumw = static_cast<TH3D*>(hist)->GetArray();
+
+        double* sumw2 = (m_storeSumw2) ? hist->GetSumw2()->GetArray() : nullptr;
+
+        // blocks that were never filled stay 0
+        for (unsigned int block=0,size=m_sumw.size(); block<size; block++){
+            if (m_sumw[block].empty()) continue;
+            unsigned int first = block << m_blockShift;
+            for (unsigned int i=0,nCells=blockCells(block); i<nCells; i++){
+                sumw[first+i] = m_sumw[block][i*m_nWeights+v];
+                if (sumw2) sumw2[first+i] = m_sumw2[block][i*m_nWeights+v];
+            }
+        }
+
+        double stats[11];
+        std::copy( m_stats.begin()+11*v, m_stats.begin()+11*(v+1), stats );
+        hist->PutStats( stats );
+        hist->SetEntries( m_entries.at(v) );
+
+        hists.push_back( hist );
+    }
+
+    return hists;
+}
+
+
+std::vector<double> flatHist::binEdges( const Axis& axis ) const{
+    /* Bin edges of an axis (same as TAxis::GetBinLowEdge for equal bins) */
+    if (!axis.edges.empty()) return axis.edges;
+
+    std::vector<double> edges(axis.nBins+1);
+    double width = (axis.max-axis.min)/axis.nBins;
+    for (unsigned int i=0; i<axis.nBins; i++)
+        edges.at(i) = axis.min + i*width;
+    edges.at(axis.nBins) = axis.max;
+
+    return edges;
+}
+
+
+void flatHist::add( const flatHist& other ){
+    /* Add the contents of another histogram with the same bins (e.g., from another thread) */
+    if (other.m_nCells!=m_nCells || other.m_blockShift!=m_blockShift || other.m_nWeights!=m_nWeights){
+        cma::WARNING("FLATHIST : Cannot add "+other.m_names.at(0)+" to "+m_names.at(0)+" (different bins)");
+        return;
+    }
+
+    for (unsigned int block=0,size=m_sumw.size(); block<size; block++){
+        if (other.m_sumw[block].empty()) continue;
+        if (m_sumw[block].empty()) allocate(block);
+
+        for (unsigned int i=0,n=m_sumw[block].size(); i<n; i++){
+            m_sumw[block][i]  += other.m_sumw[block][i];
+            m_sumw2[block][i] += other.m_sumw2[block][i];
+        }
+    }
+    for (unsigned int i=0,size=m_stats.size(); i<size; i++)
+        m_stats[i] += other.m_stats[i];
+    for (unsigned int v=0; v<m_nWeights; v++)
+        m_entries[v] += other.m_entries[v];
+
+    return;
+}
+
+
+void flatHist::reset(){
+    /* Empty all bins (& free their memory) */
+    for (unsigned int block=0,size=m_sumw.size(); block<size; block++){
+        std::vector<double>().swap( m_sumw[block] );
+        std::vector<double>().swap( m_sumw2[block] );
+    }
+    std::fill( m_stats.begin(),   m_stats.end(),   0. );
+    std::fill( m_entries.begin(), m_entries.end(), 0. );
+
+    return;
+}
+
+
+void flatHist::setBinContent( const unsigned int bin, const unsigned int variation, const double content, const double error2 ){
+    /* Set one bin -- like TH1::SetBinContent the statistics are recomputed from the bins when written */
+    unsigned int block = bin >> m_blockShift;
+    if (m_sumw[block].empty()) allocate(block);
+
+    unsigned int offset = (bin-(block << m_blockShift))*m_nWeights+variation;
+    m_sumw[block][offset]  = content;
+    m_sumw2[block][offset] = error2;
+    m_entries[variation]++;
+    std::fill( m_stats.begin()+11*variation, m_stats.begin()+11*(variation+1), 0. );
+
+    return;
+}
+
+// THE END
@@ -14,7 +14,11 @@ Create and fill TTree for ML
 
 
 flatTree4ML::flatTree4ML(configuration &cmaConfig) : 
-  m_config(&cmaConfig){}
+  m_config(&cmaConfig),
+  m_asyncOutput(false),
+  m_writer(cmaConfig.outputQueueSize()){
+    m_asyncOutput = m_config->asyncOutput();
+  }
 
 flatTree4ML::~flatTree4ML() {}
 
@@ -71,6 +75,15 @@ void flatTree4ML::initialize(TFile& outputFile) {
     m_metadataTree->Branch( "target",  &m_target_value,  "target/I" );
     m_metadataTree->Branch( "nEvents", &m_nEvents,       "nEvents/I" );
 
+    // Basket & cluster sizes for the features (all branches created above)
+    int basketSize      = m_config->basketSize();
+    long long autoFlush = m_config->autoFlush();
+    if (basketSize>0) m_ttree->SetBasketSize("*",basketSize);
+    if (autoFlush!=0) m_ttree->SetAutoFlush(autoFlush);
+
+    if (m_asyncOutput)
+        m_writer.start( [this](std::map<std::string,double>& features){ fillEvent(features); } );
+
     return;
 } // end initialize
 
@@ -80,6 +93,17 @@ void flatTree4ML::saveEvent(const std::map<std::string,double> features) {
     /* Save the ML features to the ttree! */
     cma::DEBUG("FLATTREE4ML : Save event ");
 
+    if (m_asyncOutput)
+        m_writer.push( features );   // filled on the output thread (same order)
+    else
+        fillEvent( features );
+
+    return;
+}
+
+
+void flatTree4ML::fillEvent(const std::map<std::string,double>& features) {
+    /* Set the branch values and fill the tree */
     m_weight   = features.at("weight");
     m_kfactor  = features.at("kfactor");
     m_xsection = features.at("xsection");
@@ -124,6 +148,8 @@ void flatTree4ML::saveEvent(const std::map<std::string,double> features) {
 
 void flatTree4ML::finalize(){
     /* Finalize the class -- fill in the metadata (only need to do this once!) */
+    m_writer.stop();     // write the remaining entries (if asynchronous)
+
     m_name    = m_config->primaryDataset();
     m_nEvents = m_config->NTotalEvents();
     m_target_value = 0;
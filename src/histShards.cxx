@@ -0,0 +1,100 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Thread-local shards of histograms for filling from several threads.
+Each worker fills its own copy of the histograms; at the end of the file
+the copies are added in a fixed order (pairwise tree) so the output is the
+same for any scheduling of the threads.
+Under/overflow bins are added like all other bins, so over/underflow
+can be moved into the last/first bins after the merge.
+*/
+#include "Analysis/CyMiniAna/interface/histShards.h"
+
+
+thread_local unsigned int histShards::t_worker = 0;
+
+
+histShards::histShards(){
+    m_shards.resize(1);
+  }
+
+histShards::~histShards() {}
+
+
+int histShards::book( const std::vector<std::string>& names, const std::vector<flatHist::Axis>& axes, const unsigned int blockSize ){
+    /* Book the histogram in every shard */
+    for (auto& shard : m_shards)
+        shard.push_back( flatHist(names,axes,blockSize) );
+
+    return m_shards.front().size()-1;
+}
+
+
+void histShards::setNumberOfShards( const unsigned int nShards ){
+    /* Make (empty) copies of the histograms for each worker */
+    if (nShards<1){
+        cma::WARNING("HISTSHARDS : Need at least one shard, keeping "+std::to_string(m_shards.size()));
+        return;
+    }
+
+    merge();
+    m_shards.resize( 1 );
+
+    std::vector<flatHist> empty( m_shards.front() );
+    for (auto& hist : empty) hist.reset();
+    m_shards.resize( nShards, empty );
+
+    return;
+}
+
+
+void histShards::setWorker( const unsigned int worker ){
+    /* Set the shard of this thread */
+    t_worker = worker;
+    return;
+}
+
+
+void histShards::workerOutOfRange() const{
+    /* The worker of this thread has no shard (setWorker >= setNumberOfShards) */
+    cma::ERROR("HISTSHARDS : Worker "+std::to_string(t_worker)+" out of range, only "+std::to_string(m_shards.size())+" shards");
+    cma::ERROR("HISTSHARDS : Call setNumberOfShards() with the number of workers before filling. Exiting.");
+    exit(EXIT_FAILURE);
+}
+
+
+void histShards::merge(){
+    /* Pairwise tree of additions: (0+1),(2+3),... then (0+2),(4+6),... into shard 0 */
+    unsigned int nShards = m_shards.size();
+
+    for (unsigned int step=1; step<nShards; step*=2){
+        for (unsigned int s=0; s+step<nShards; s+=2*step){
+            std::vector<flatHist>& target = m_shards.at(s);
+            std::vector<flatHist>& source = m_shards.at(s+step);
+
+            for (unsigned int h=0,size=target.size(); h<size; h++){
+                target[h].add( source[h] );
+                source[h].reset();
+            }
+        }
+    }
+
+    return;
+}
+
+
+void histShards::clear(){
+    /* Remove all histograms (keep the number of shards) */
+    for (auto& shard : m_shards)
+        std::vector<flatHist>().swap( shard );
+
+    return;
+}
+
+// THE END
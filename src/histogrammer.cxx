@@ -18,11 +18,17 @@ to go into plots || TRexFitter
 histogrammer::histogrammer( configuration& cmaConfig, std::string name ) :
   m_config(&cmaConfig),
   m_name(name),
+  m_useSpecs(false),
   m_putOverflowInLastBin(true),
-  m_putUnderflowInFirstBin(true){
-    m_map_histograms1D.clear();
-    m_map_histograms2D.clear();
-    m_map_histograms3D.clear();
+  m_putUnderflowInFirstBin(true),
+  m_sparseBlockSize(64){
+    m_hists.clear();
+    m_handles.clear();
+
+    if (m_histNames.size()!=kNumberOfHists){
+        cma::ERROR("HISTOGRAMMER : Number of histogram names ("+std::to_string(m_histNames.size())+") does not match histogrammer::Hist");
+        exit(EXIT_FAILURE);
+    }
 
     m_isMC  = m_config->isMC();
 
@@ -30,6 +36,9 @@ histogrammer::histogrammer( configuration& cmaConfig, std::string name ) :
     m_useLargeRJets = m_config->useLargeRJets();
     m_useLeptons    = m_config->useLeptons();
     m_useNeutrinos  = m_config->useNeutrinos();
+    m_useQCDRegions = m_config->useQCDRegions();
+    m_sparseHistogramBins = m_config->sparseHistogramBins();
+    m_histogramsFile = m_config->histogramsFile();
 
     if (m_name.length()>0  && m_name.substr(m_name.length()-1,1).compare("_")!=0)
         m_name = m_name+"_"; // add '_' to end of string, if needed
@@ -41,92 +50,156 @@ histogrammer::~histogrammer() {}
 /**** INITIALIZE HISTOGRAMS ****/
 
 // -- 1D Histograms
-void histogrammer::init_hist( const std::string& name, const unsigned int nBins, const double x_min, const double x_max ){
+int histogrammer::init_hist( const std::string& name, const unsigned int nBins, const double x_min, const double x_max ){
     /* Initialize histogram -- equal bins */
-    m_map_histograms1D["h_"+name] = new TH1D(("h_"+name).c_str(), ("h_"+name).c_str(),nBins,x_min,x_max);
-    m_map_histograms1D["h_"+name]->Sumw2();
-
-    return;
+    return book( "h_"+name, {{nBins,x_min,x_max,{}}} );
 }
-void histogrammer::init_hist( const std::string& name, const unsigned int nBins, const double *xbins ){
+int histogrammer::init_hist( const std::string& name, const unsigned int nBins, const double *xbins ){
     /* Initialize histogram -- variable bins */
-    m_map_histograms1D["h_"+name] = new TH1D(("h_"+name).c_str(), ("h_"+name).c_str(),nBins,xbins);
-    m_map_histograms1D["h_"+name]->Sumw2();
-
-    return;
+    return book( "h_"+name, {{nBins,xbins[0],xbins[nBins],std::vector<double>(xbins,xbins+nBins+1)}} );
 }
 // -- 2D Histograms
-void histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double x_min, const double x_max,
+int histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double x_min, const double x_max,
                               const unsigned int nBinsY, const double y_min, const double y_max ){
     /* Initialize histogram -- equal bins */
-    m_map_histograms2D["h_"+name] = new TH2D(("h_"+name).c_str(), ("h_"+name).c_str(),
-                                            nBinsX,x_min,x_max,nBinsY,y_min,y_max);
-    m_map_histograms2D["h_"+name]->Sumw2();
-
-    return;
+    return book( "h_"+name, {{nBinsX,x_min,x_max,{}}, {nBinsY,y_min,y_max,{}}} );
 }
-void histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double *xbins,
+int histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double *xbins,
                               const unsigned int nBinsY, const double *ybins ){
     /* Initialize histogram -- variable bins */
-    m_map_histograms2D["h_"+name] = new TH2D(("h_"+name).c_str(), ("h_"+name).c_str(),
-                                           nBinsX,xbins,nBinsY,ybins);
-    m_map_histograms2D["h_"+name]->Sumw2();
-
-    return;
+    return book( "h_"+name, {{nBinsX,xbins[0],xbins[nBinsX],std::vector<double>(xbins,xbins+nBinsX+1)},
+                             {nBinsY,ybins[0],ybins[nBinsY],std::vector<double>(ybins,ybins+nBinsY+1)}} );
 }
 // -- 3D Histograms
-void histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double x_min, const double x_max,
+int histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double x_min, const double x_max,
                               const unsigned int nBinsY, const double y_min, const double y_max,
                               const unsigned int nBinsZ, const double z_min, const double z_max ){
     /* Initialize histogram -- equal bins */
-    m_map_histograms3D["h_"+name] = new TH3D(("h_"+name).c_str(), ("h_"+name).c_str(),
-                                            nBinsX,x_min,x_max,nBinsY,y_min,y_max,nBinsZ,z_min,z_max);
-    m_map_histograms3D["h_"+name]->Sumw2();
-
-    return;
+    return book( "h_"+name, {{nBinsX,x_min,x_max,{}}, {nBinsY,y_min,y_max,{}}, {nBinsZ,z_min,z_max,{}}} );
 }
-void histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double *xbins,
+int histogrammer::init_hist( const std::string& name, const unsigned int nBinsX, const double *xbins,
                               const unsigned int nBinsY, const double *ybins,
                               const unsigned int nBinsZ, const double *zbins ){
     /* Initialize histogram -- variable bins */
-    m_map_histograms3D["h_"+name] = new TH3D(("h_"+name).c_str(), ("h_"+name).c_str(),
-                                           nBinsX,xbins,nBinsY,ybins,nBinsZ,zbins);
-    m_map_histograms3D["h_"+name]->Sumw2();
+    return book( "h_"+name, {{nBinsX,xbins[0],xbins[nBinsX],std::vector<double>(xbins,xbins+nBinsX+1)},
+                             {nBinsY,ybins[0],ybins[nBinsY],std::vector<double>(ybins,ybins+nBinsY+1)},
+                             {nBinsZ,zbins[0],zbins[nBinsZ],std::vector<double>(zbins,zbins+nBinsZ+1)}} );
+}
 
-    return;
+int histogrammer::book( const std::string& name, const std::vector<flatHist::Axis>& axes ){
+    /* Book the flat histogram (converted to TH1D/TH2D/TH3D in finalize()) -- return its handle
+       When booking the weight variations of a set (m_variations), one histogram holds all of them:
+       the name ends with the first variation, which is replaced by each of the others
+    */
+    std::vector<std::string> names = {name};
+    if (m_variations.size()>1){
+        std::string prefix = name.substr( 0, name.size()-m_variations.at(0).size() );
+        for (unsigned int v=1,size=m_variations.size(); v<size; v++)
+            names.push_back( prefix+m_variations.at(v) );
+    }
+
+    // large histograms (e.g., truth vs reco) are mostly empty: only allocate the blocks that are filled
+    unsigned int nCells(1);
+    for (const auto& axis : axes) nCells *= axis.nBins+2;
+    unsigned int blockSize = (m_sparseHistogramBins>0 && nCells>m_sparseHistogramBins) ? m_sparseBlockSize : 0;
+
+    int handle = m_hists.book( names,axes,blockSize );
+    for (unsigned int v=0,size=names.size(); v<size; v++)
+        m_handles[names.at(v)] = std::make_pair( handle, v );
+
+    return handle;
 }
 
 
 void histogrammer::initialize( TFile& outputFile, bool doSystWeights ){
-    /* Setup some values and book histograms */
+    /* Setup some values and book histograms
+       The histograms to fill for each selection are resolved here (fill plan),
+       so filling only indexes vectors of handles
+    */
     m_doSystWeights = doSystWeights;
     outputFile.cd();
 
+    m_histSets.clear();
+    m_mapOfHistSets.clear();
+    m_nominalSets.clear();
+    m_nWeightSystematics = 0;
+    m_regionSets.clear();
+    m_specSets.clear();
+
+    // histograms defined in a file (compiled once into the fill plan)
+    m_useSpecs = !m_histogramsFile.empty();
+    if (m_useSpecs) loadSpecs( m_histogramsFile );
+
+    // weight systematics -- same for every selection
+    std::vector<std::string> variations = {""};
+    if (m_isMC && m_doSystWeights){
+        for (const auto& syst : m_config->listOfWeightSystematics()){
+            variations.push_back( syst );
+        } // end weight systematics
+
+        // vector weight systematics
+        for (const auto& syst : m_config->mapOfWeightVectorSystematics()){
+            for (unsigned int el=0;el<syst.second;++el){
+                std::string weightIndex = std::to_string(el);
+                variations.push_back( weightIndex+"_"+syst.first );
+            } // end components of vector
+        } // end vector weight systematics
+    } // end if MC and save weight systematics
+    m_nWeightSystematics = variations.size()-1;     // same order as Event::systEventWeights()
 
     // loop over selections (typically only one treename)
+    // the histograms of each weight systematic are booked with the nominal ones
     for (const auto& sel : m_config->selections() ) {
-        bookHists( m_name+sel );
-
-        // weight systematics
-        if (m_isMC && m_doSystWeights){
-            for (const auto& syst : m_config->listOfWeightSystematics()){
-                bookHists( m_name+sel+syst );
-            } // end weight systematics
-
-            // vector weight systematics
-            for (const auto& syst : m_config->mapOfWeightVectorSystematics()){
-                for (unsigned int el=0;el<syst.second;++el){
-                    std::string weightIndex = std::to_string(el);
-                    bookHists( m_name+sel+weightIndex+"_"+syst.first );
-                } // end components of vector
-            } // end vector weight systematics
-        } // end if MC and save weight systematics
+        m_variations.clear();
+        for (const auto& variation : variations)
+            m_variations.push_back( m_name+sel+variation );
+
+        if (m_useSpecs) bookSpecs( m_name+sel );
+        else bookHists( m_name+sel );
+        m_nominalSets.push_back( resolveHists( m_name+sel ) );
     } // end loop over selections
+    m_variations.clear();
+
+    // QCD/ABCD regions (nominal only) -- filled by the index from regionCategoriser
+    if (m_useQCDRegions){
+        for (const auto& sel : m_config->selections() ) {
+            std::vector<unsigned int> regionSets;
+            for (const auto& region : m_config->qcdSelections() ) {
+                if (m_useSpecs) bookSpecs( m_name+sel+"_"+region );
+                else bookHists( m_name+sel+"_"+region );
+                regionSets.push_back( resolveHists( m_name+sel+"_"+region ) );
+            }
+            m_regionSets.push_back( regionSets );
+        }
+    }
 
     return;
 }
 
 
+unsigned int histogrammer::resolveHists( const std::string& name ){
+    /* Find the handles of the histograms booked by bookHists(name) -- return the index of this set */
+    std::vector<int> hists(kNumberOfHists,-1);
+
+    for (unsigned int h=0; h<kNumberOfHists; h++){
+        auto handle = m_handles.find( "h_"+m_histNames.at(h)+"_"+name );
+        if (handle!=m_handles.end()) hists.at(h) = handle->second.first;
+    }
+
+    std::vector<int> specs(m_specs.size(),-1);
+    for (unsigned int s=0, size=m_specs.size(); s<size; s++){
+        auto handle = m_handles.find( "h_"+m_specs.at(s).name+"_"+name );
+        if (handle!=m_handles.end()) specs.at(s) = handle->second.first;
+    }
+
+    m_histSets.push_back( hists );
+    m_specSets.push_back( specs );
+    m_mapOfHistSets[name] = m_histSets.size()-1;
+
+    return m_histSets.size()-1;
+}
+
+
 void histogrammer::bookHists( std::string name ){
     /* 
       Book histograms -- modify/inherit this function for analysis-specific hists 
@@ -267,15 +340,139 @@ void histogrammer::bookHists( std::string name ){
 }
 
 
+void histogrammer::loadSpecs( const std::string& histogramsFile ){
+    /* Compile the histograms file into a list of histograms to book & fill for each set */
+    std::vector<std::string> lines;
+    cma::read_file( histogramsFile, lines );
+
+    m_specs.clear();
+    m_specCollections.assign(kNumberOfCollections,false);
+    for (const auto& line : lines){
+        HistSpec spec = compileSpec( line );
+        m_specCollections.at(spec.collection) = true;
+        m_specs.push_back( spec );
+    }
+
+    cma::INFO("HISTOGRAMMER : "+std::to_string(m_specs.size())+" histograms from "+histogramsFile);
+
+    return;
+}
+
+
+histogrammer::HistSpec histogrammer::compileSpec( const std::string& line ){
+    /* One line of the histograms file:
+         NAME  COLLECTION[INDEX]  OBSERVABLE[:OBSERVABLE[:OBSERVABLE]]  NBINS MIN MAX (each axis)  [conditions]
+       with conditions 'OBSERVABLE COMPARISON VALUE' joined by '&&' (same as the cuts files)
+    */
+    std::istringstream lineStream(line);
+    std::istream_iterator<std::string> start(lineStream), stop;
+    std::vector<std::string> tokens(start, stop);
+
+    HistSpec spec;
+    bool valid(tokens.size()>=3);
+
+    if (valid){
+        spec.name = tokens.at(0);
+
+        // collection, e.g., "JETS" (all jets) or "JETS[0]" (leading jet)
+        std::string collection = tokens.at(1);
+        spec.index = -1;
+        std::size_t bracket = collection.find("[");
+        if (bracket!=std::string::npos && collection.back()==']'){
+            valid = cma::str2number( collection.substr(bracket+1, collection.size()-bracket-2), spec.index ) && spec.index>=0;
+            collection = collection.substr(0,bracket);
+        }
+        valid = valid && (m_mapOfCollections.find(collection)!=m_mapOfCollections.end());
+        if (valid) spec.collection = m_mapOfCollections.at(collection);
+
+        // observables (one per axis)
+        std::vector<std::string> observables;
+        cma::split( tokens.at(2), ':', observables );
+        for (const auto& obs : observables){
+            valid = valid && (m_mapOfObservables.find(obs)!=m_mapOfObservables.end()) &&
+                             validObservable( spec.collection, m_mapOfObservables.at(obs) );
+            if (valid) spec.observables.push_back( m_mapOfObservables.at(obs) );
+        }
+        unsigned int dimension = observables.size();
+        valid = valid && dimension>0 && dimension<=3 && tokens.size()>=3+3*dimension;
+        valid = valid && (spec.observables.at(0)!=kObsN || dimension==1);   // number of objects is 1D
+
+        // binning
+        for (unsigned int d=0; valid && d<dimension; d++){
+            unsigned int t = 3+3*d;
+            int nbins(0);
+            double min(0), max(0);
+            valid = cma::str2number(tokens.at(t),nbins) && cma::str2number(tokens.at(t+1),min) &&
+                    cma::str2number(tokens.at(t+2),max) && nbins>0;
+            if (valid) spec.axes.push_back( {(unsigned int)nbins, min, max, {}} );
+        }
+
+        // conditions
+        for (unsigned int t=3+3*dimension, size=tokens.size(); valid && t<size; t+=4){
+            valid = (t+2<size) && (t+3==size || tokens.at(t+3).compare("&&")==0) &&
+                    (m_mapOfObservables.find(tokens.at(t))!=m_mapOfObservables.end()) &&
+                    (m_mapOfComparisons.find(tokens.at(t+1))!=m_mapOfComparisons.end());
+            valid = valid && m_mapOfObservables.at(tokens.at(t))!=kObsN &&
+                    validObservable( spec.collection, m_mapOfObservables.at(tokens.at(t)) );
+            float value(0);
+            valid = valid && cma::str2number( tokens.at(t+2), value );
+            if (valid)
+                spec.conditions.push_back( {m_mapOfObservables.at(tokens.at(t)), m_mapOfComparisons.at(tokens.at(t+1)), value} );
+        }
+    }
+
+    if (!valid){
+        cma::ERROR("HISTOGRAMMER : Cannot compile histogram '"+line+"' in "+m_histogramsFile);
+        cma::ERROR("HISTOGRAMMER : Expected 'NAME COLLECTION OBSERVABLE NBINS MIN MAX [OBSERVABLE COMPARISON VALUE && ...]'");
+        exit(EXIT_FAILURE);
+    }
+
+    return spec;
+}
+
+
+bool histogrammer::validObservable( const unsigned int collection, const unsigned int observable ) const{
+    /* Observables that exist for each collection */
+    switch (collection){
+      case kCollEvent:
+        return (observable==kObsHT || observable==kObsST || observable==kObsNBtags);
+      case kCollMET:
+        return (observable==kObsPt || observable==kObsPhi || observable==kObsMTW);
+      case kCollJets:
+        return (observable<=kObsIsGood);
+      case kCollLjets:
+        return (observable<=kObsTau32);
+      case kCollLeptons:
+      case kCollElectrons:
+      case kCollMuons:
+        return (observable<=kObsIsGood && observable!=kObsBdisc);
+      case kCollNeutrinos:
+        return (observable<=kObsEnergy || observable==kObsIsGood);
+    }
+
+    return false;
+}
+
+
+void histogrammer::bookSpecs( const std::string& name ){
+    /* Book the histograms of the histograms file for one set */
+    cma::DEBUG("HISTOGRAMMER : Book histograms "+name+" from "+m_histogramsFile);
+
+    for (const auto& spec : m_specs)
+        book( "h_"+spec.name+"_"+name, spec.axes );
+
+    return;
+}
+
+
 
 
 /**** FILL HISTOGRAMS ****/
 
 void histogrammer::fill( const std::string& name, const double& value, const double& weight ){
     /* TH1D */
-    TH1D* this_hist = m_map_histograms1D.at("h_"+name);
-
-    this_hist->Fill(value,weight);
+    std::pair<int,unsigned int> handle = m_handles.at("h_"+name);
+    m_hists[handle.first].fill(value,weight,handle.second);
 
     return;
 }
@@ -283,9 +480,8 @@ void histogrammer::fill( const std::string& name, const double& value, const dou
 void histogrammer::fill( const std::string& name, 
                          const double& xvalue, const double& yvalue, const double& weight ){
     /* TH2D */
-    TH2D* this_hist = m_map_histograms2D.at("h_"+name);
-
-    this_hist->Fill(xvalue,yvalue,weight);
+    std::pair<int,unsigned int> handle = m_handles.at("h_"+name);
+    m_hists[handle.first].fill(xvalue,yvalue,weight,handle.second);
 
     return;
 }
@@ -293,49 +489,91 @@ void histogrammer::fill( const std::string& name,
 void histogrammer::fill( const std::string& name, 
                          const double& xvalue, const double& yvalue, const double& zvalue, const double& weight ){
     /* TH3D */
-    TH3D* this_hist = m_map_histograms3D.at("h_"+name);
+    std::pair<int,unsigned int> handle = m_handles.at("h_"+name);
+    m_hists[handle.first].fill(xvalue,yvalue,zvalue,weight,handle.second);
+
+    return;
+}
 
-    this_hist->Fill(xvalue,yvalue,zvalue,weight);
+void histogrammer::fill( const int handle, const double& value, const double& weight ){
+    /* TH1D from its handle (-1 = not booked) */
+    if (handle<0) return;
+    m_hists[handle].fill(value,weight);
 
     return;
 }
 
+void histogrammer::fill( const int handle,
+                         const double& xvalue, const double& yvalue, const double& weight ){
+    /* TH2D from its handle (-1 = not booked) */
+    if (handle<0) return;
+    m_hists[handle].fill(xvalue,yvalue,weight);
+
+    return;
+}
+
+void histogrammer::fill( const int handle,
+                         const double& xvalue, const double& yvalue, const double& zvalue, const double& weight ){
+    /* TH3D from its handle (-1 = not booked) */
+    if (handle<0) return;
+    m_hists[handle].fill(xvalue,yvalue,zvalue,weight);
 
-void histogrammer::fill( Event& event, const std::vector<unsigned int>& evtsel_decisions ){
+    return;
+}
+
+void histogrammer::fill( const int handle, const double& value, const std::vector<double>& weights ){
+    /* TH1D, all weight variations at once */
+    if (handle<0) return;
+    m_hists[handle].fill(value,weights.data(),weights.size());
+
+    return;
+}
+
+void histogrammer::fill( const int handle,
+                         const double& xvalue, const double& yvalue, const std::vector<double>& weights ){
+    /* TH2D, all weight variations at once */
+    if (handle<0) return;
+    m_hists[handle].fill(xvalue,yvalue,weights.data(),weights.size());
+
+    return;
+}
+
+void histogrammer::fill( const int handle,
+                         const double& xvalue, const double& yvalue, const double& zvalue, const std::vector<double>& weights ){
+    /* TH3D, all weight variations at once */
+    if (handle<0) return;
+    m_hists[handle].fill(xvalue,yvalue,zvalue,weights.data(),weights.size());
+
+    return;
+}
+
+
+void histogrammer::fill( Event& event, const unsigned int evtsel_decisions, const int region ){
     /* Fill histograms -- fill histograms based on selection, tree, or systematic weights ("nominal" but different weight)
        This is the function to modify / inherit for analysis-specific purposes
     */
-    double event_weight = event.nominal_weight();
-
-    std::vector<std::string> selections = m_config->selections();
-    for (unsigned int ss=0, size=selections.size(); ss<size; ss++){
-        std::string sel( selections.at(ss) );
-        if (!evtsel_decisions.at(ss)) continue;
-        fill( m_name+sel, event, event_weight );
-
-        // if there are systematics stored as weights (e.g., b-tagging, pileup, etc.)
-        // the following calls the fill() function with different event weights
-        // to make histograms
-        bool isNominal = m_config->isNominalTree( event.treeName() );
-        if (m_isMC && isNominal && m_doSystWeights){
-            // weight systematics
-            event_weight = 1.0;
-            for (const auto& syst : m_config->listOfWeightSystematics()){
-                event_weight = event.getSystEventWeight( syst );
-                fill( m_name+sel+syst, event, event_weight );
-            } // end weight systematics
-
-            // vector weight systematics
-            event_weight = 1.0;
-            for (const auto& syst : m_config->mapOfWeightVectorSystematics()){
-                for (unsigned int el=0;el<syst.second;++el){
-                    event_weight = event.getSystEventWeight( syst.first, el );
-                    std::string weightIndex = std::to_string(el);
-
-                    fill( m_name+sel+weightIndex+"_"+syst.first, event, event_weight );
-                } // end components of vector
-            } // end vector weight systematics
-        } // end if nominal and doSystWeights
+    static thread_local std::vector<double> weights;    // one per thread (histogram shards)
+    weights.resize(1);
+    weights[0] = event.nominal_weight();
+
+    // if there are systematics stored as weights (e.g., b-tagging, pileup, etc.)
+    // they are filled at the same time as the nominal histograms (one binning for all weights)
+    if (m_nWeightSystematics>0 && m_config->isNominalTree( event.treeName() )){
+        const std::vector<double>& syst_weights = event.systEventWeights();
+        weights.insert( weights.end(), syst_weights.begin(), syst_weights.end() );
+    }
+
+    for (unsigned int ss=0, size=m_nominalSets.size(); ss<size; ss++){
+        if (!((evtsel_decisions >> ss) & 1)) continue;
+        unsigned int set = m_nominalSets[ss];
+        if (m_useSpecs) fillSpecs( m_specSets[set], event, weights );
+        else fill( m_histSets[set], event, weights );
+
+        if (m_useQCDRegions && region>=0){
+            set = m_regionSets[ss][region];                         // nominal only
+            if (m_useSpecs) fillSpecs( m_specSets[set], event, weights );
+            else fill( m_histSets[set], event, weights );
+        }
     } // end loop over selections
 
     return;
@@ -343,11 +581,24 @@ void histogrammer::fill( Event& event, const std::vector<unsigned int>& evtsel_d
 
 
 void histogrammer::fill( const std::string& name, Event& event, double event_weight){
+    /* Fill histograms of one set by name (not used in the event loop) */
+    unsigned int set = m_mapOfHistSets.at(name);
+    if (m_useSpecs) fillSpecs( m_specSets.at(set), event, std::vector<double>(1,event_weight) );
+    else fill( m_histSets.at(set), event, std::vector<double>(1,event_weight) );
+
+    return;
+}
+
+
+void histogrammer::fill( const std::vector<int>& hists, Event& event, const std::vector<double>& event_weights){
     /* Fill histograms -- just use information from the event and fill histogram
        This is the function to modify / inherit for analysis-specific purposes
+
+       @param hists           Handles of one set of histograms (index = histogrammer::Hist)
+       @param event_weights   Nominal weight, then the weight systematics (if they are filled)
     */
-    cma::DEBUG("HISTOGRAMMER : Fill histograms "+name);
-    cma::DEBUG("HISTOGRAMMER : event weight = "+std::to_string(event_weight) );
+    cma::DEBUG("HISTOGRAMMER : Fill histograms");
+    cma::DEBUG("HISTOGRAMMER : event weight = "+std::to_string(event_weights.at(0)) );
 
     // physics information
     std::vector<Jet> jets = event.jets();
@@ -357,56 +608,55 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
     //std::vector<Electron> electrons = event.electrons();
     std::vector<Neutrino> neutrinos = event.neutrinos();
     MET met = event.met();
-    std::vector<Parton> partons = event.truth_partons();
     Wprime wpreco = event.wprime();
     Wprime wpreco_smp = event.wprime_sampling();
 
     if (m_useJets){
         cma::DEBUG("HISTOGRAMMER : Fill small-R jets");
-        fill("n_btags_"+name, event.btag_jets().size(), event_weight );
-        fill("n_jets_"+name, jets.size(), event_weight );
+        fill(hists[kNBtags], event.btag_jets().size(), event_weights );
+        fill(hists[kNJets], jets.size(), event_weights );
 
         if (jets.size()>1){
             Jet jet0 = jets.at(0);
             Jet jet1 = jets.at(1);
-            fill("jet0_pt_"+name,  jet0.p4.Pt(),   event_weight);
-            fill("jet0_bdisc_"+name, jet0.bdisc,   event_weight);
-            fill("jet1_pt_"+name,  jet1.p4.Pt(),   event_weight);
-            fill("jet1_bdisc_"+name, jet1.bdisc,   event_weight);
+            fill(hists[kJet0Pt],  jet0.p4.Pt(),   event_weights);
+            fill(hists[kJet0Bdisc], jet0.bdisc,   event_weights);
+            fill(hists[kJet1Pt],  jet1.p4.Pt(),   event_weights);
+            fill(hists[kJet1Bdisc], jet1.bdisc,   event_weights);
         }
 
         for (const auto& jet : jets){
             if (!jet.isGood) continue;
-            fill("jet_pt_"+name,  jet.p4.Pt(),   event_weight);
-            fill("jet_eta_"+name, jet.p4.Eta(),  event_weight);
-            fill("jet_phi_"+name, jet.p4.Phi(),  event_weight);
-            fill("jet_bdisc_"+name, jet.bdisc,  event_weight);
+            fill(hists[kJetPt],  jet.p4.Pt(),   event_weights);
+            fill(hists[kJetEta], jet.p4.Eta(),  event_weights);
+            fill(hists[kJetPhi], jet.p4.Phi(),  event_weights);
+            fill(hists[kJetBdisc], jet.bdisc,  event_weights);
         }
     }
 
     if (m_useLargeRJets){
         cma::DEBUG("HISTOGRAMMER : Fill large-R jets");
-        fill("n_ljets_"+name, ljets.size(), event_weight );
+        fill(hists[kNLjets], ljets.size(), event_weights );
 
         for (const auto& ljet : ljets){
-            fill("ljet_pt_"+name,    ljet.p4.Pt(),  event_weight);
-            fill("ljet_eta_"+name,   ljet.p4.Eta(), event_weight);
-            fill("ljet_phi_"+name,   ljet.p4.Phi(), event_weight);
-            fill("ljet_SDmass_"+name,ljet.softDropMass, event_weight);
-            fill("ljet_charge_"+name,ljet.charge,event_weight);
-
-            fill("ljet_tau1_"+name,  ljet.tau1,  event_weight);
-            fill("ljet_tau2_"+name,  ljet.tau2,  event_weight);
-            fill("ljet_tau3_"+name,  ljet.tau3,  event_weight);
-            fill("ljet_tau21_"+name, ljet.tau21, event_weight);
-            fill("ljet_tau32_"+name, ljet.tau32, event_weight);
+            fill(hists[kLjetPt],    ljet.p4.Pt(),  event_weights);
+            fill(hists[kLjetEta],   ljet.p4.Eta(), event_weights);
+            fill(hists[kLjetPhi],   ljet.p4.Phi(), event_weights);
+            fill(hists[kLjetSDmass],ljet.softDropMass, event_weights);
+            fill(hists[kLjetCharge],ljet.charge,event_weights);
+
+            fill(hists[kLjetTau1],  ljet.tau1,  event_weights);
+            fill(hists[kLjetTau2],  ljet.tau2,  event_weights);
+            fill(hists[kLjetTau3],  ljet.tau3,  event_weights);
+            fill(hists[kLjetTau21], ljet.tau21, event_weights);
+            fill(hists[kLjetTau32], ljet.tau32, event_weights);
 
             if (ljet.subjets.size()>0){
-                fill("ljet_subjet0_bdisc_"+name, ljet.subjets.at(0).bdisc, event_weight);
-                fill("ljet_subjet0_charge_"+name,ljet.subjets.at(0).charge,event_weight);
+                fill(hists[kLjetSubjet0Bdisc], ljet.subjets.at(0).bdisc, event_weights);
+                fill(hists[kLjetSubjet0Charge],ljet.subjets.at(0).charge,event_weights);
                 if (ljet.subjets.size()>1){
-                    fill("ljet_subjet1_bdisc_"+name, ljet.subjets.at(1).bdisc, event_weight);
-                    fill("ljet_subjet1_charge_"+name,ljet.subjets.at(1).charge,event_weight);
+                    fill(hists[kLjetSubjet1Bdisc], ljet.subjets.at(1).bdisc, event_weights);
+                    fill(hists[kLjetSubjet1Charge],ljet.subjets.at(1).charge,event_weights);
                 }
             }
         } // end loop over ljets
@@ -416,18 +666,18 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
         cma::DEBUG("HISTOGRAMMER : Fill leptons");
         for (const auto& el : leptons){
             if (el.isMuon || !el.isGood) continue;
-            fill("el_pt_"+name,  el.p4.Pt(),  event_weight);
-            fill("el_eta_"+name, el.p4.Eta(), event_weight);
-            fill("el_phi_"+name, el.p4.Phi(), event_weight);
-            fill("el_charge_"+name, el.charge, event_weight);
+            fill(hists[kElPt],  el.p4.Pt(),  event_weights);
+            fill(hists[kElEta], el.p4.Eta(), event_weights);
+            fill(hists[kElPhi], el.p4.Phi(), event_weights);
+            fill(hists[kElCharge], el.charge, event_weights);
         }
 
         for (const auto& mu : leptons){
             if (mu.isElectron || !mu.isGood) continue;
-            fill("mu_pt_"+name,  mu.p4.Pt(),  event_weight);
-            fill("mu_eta_"+name, mu.p4.Eta(), event_weight);
-            fill("mu_phi_"+name, mu.p4.Phi(), event_weight);
-            fill("mu_charge_"+name, mu.charge, event_weight);
+            fill(hists[kMuPt],  mu.p4.Pt(),  event_weights);
+            fill(hists[kMuEta], mu.p4.Eta(), event_weights);
+            fill(hists[kMuPhi], mu.p4.Phi(), event_weights);
+            fill(hists[kMuCharge], mu.charge, event_weights);
         }
     }
 
@@ -436,66 +686,48 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
         cma::DEBUG("HISTOGRAMMER : Fill neutrinos");
         Neutrino nu = neutrinos.at(0);
 
-        // Neutrino made from sampling
-        TLorentzVector tmp_nu;
-        float nuE = sqrt( pow(nu.p4.Px(),2) + pow(nu.p4.Py(),2) + pow(nu.pz_sampling,2));
-        tmp_nu.SetPxPyPzE( nu.p4.Px(), nu.p4.Py(), nu.pz_sampling, nuE );
+        // Neutrino made from sampling (or the kinematic fit)
+        TLorentzVector tmp_nu = nu.p4_sampling;
 
         // Neutrino made from VIPER (neutrin eta prediction)
         TLorentzVector viper_nu;
         tmp_nu.SetPtEtaPhiM( nu.p4.Pt(), nu.viper, nu.p4.Phi(), 0.0 );
 
-        fill("nu_pt_"+name,  nu.p4.Pt(),  event_weight);
-        fill("nu_eta_"+name, nu.p4.Eta(), event_weight);
-        fill("nu_phi_"+name, nu.p4.Phi(), event_weight);
-        fill("nu_eta_smp_"+name, tmp_nu.Eta(), event_weight);
+        fill(hists[kNuPt],  nu.p4.Pt(),  event_weights);
+        fill(hists[kNuEta], nu.p4.Eta(), event_weights);
+        fill(hists[kNuPhi], nu.p4.Phi(), event_weights);
+        fill(hists[kNuEtaSmp], tmp_nu.Eta(), event_weights);
 
         if (leptons.size()>0){
             TLorentzVector wBoson     = nu.p4 + leptons.at(0).p4;
             TLorentzVector wBoson_smp = tmp_nu+ leptons.at(0).p4;
             TLorentzVector wBoson_viper = viper_nu+ leptons.at(0).p4;
 
-            fill("w_mass_"+name, wBoson.M(),  event_weight);
-            fill("w_pt_"+name,   wBoson.Pt(), event_weight);
-            fill("w_mass_smp_"+name, wBoson_smp.M(),  event_weight);
-            fill("w_pt_smp_"+name,   wBoson_smp.Pt(), event_weight);
-            fill("w_mass_viper_"+name, wBoson_viper.M(),  event_weight);
-            fill("w_pt_viper_"+name,   wBoson_viper.Pt(), event_weight);
+            fill(hists[kWMass], wBoson.M(),  event_weights);
+            fill(hists[kWPt],   wBoson.Pt(), event_weights);
+            fill(hists[kWMassSmp], wBoson_smp.M(),  event_weights);
+            fill(hists[kWPtSmp],   wBoson_smp.Pt(), event_weights);
+            fill(hists[kWMassViper], wBoson_viper.M(),  event_weights);
+            fill(hists[kWPtViper],   wBoson_viper.Pt(), event_weights);
         }
 //        for (const auto pz : nu.pz_samplings)
-//            fill("nu_pz_samples_"+name, pz, 1.0);   // look at the distribution of pz
+//            fill(hists[kNuPzSamples], pz, 1.0);   // look at the distribution of pz
 
         if (m_config->useTruth()){
             cma::DEBUG("HISTOGRAMMER : Fill neutrinos -- truth info");
-            std::vector<Parton> truth_partons = event.truth_partons();
-
             float tru_pz(-999.);
             float tru_eta(-999.);
-            Parton p;
-            unsigned int n_wdecays2leptons(0);
-            // Get truth neutrino
-            for (const auto& pa : truth_partons){
-                if (pa.isW && pa.child0_idx>=0 && pa.child1_idx>=0) {
-                    Parton child0 = truth_partons.at( pa.child0_idx );
-                    Parton child1 = truth_partons.at( pa.child1_idx );
-                    if (child0.isNeutrino) {
-                        n_wdecays2leptons++;
-                        p = child0;
-                    }
-                    else if (child1.isNeutrino) {
-                        n_wdecays2leptons++;
-                        p = child1;
-                    }
-                }
-            }
-            if (n_wdecays2leptons==1){
+            // Get truth neutrino (from the truth decay graph, without decoding all partons)
+            int nu_idx = event.truth_graph().neutrino;
+            if (nu_idx>=0){
+                Parton p = event.truth_parton(nu_idx);
                 tru_pz  = p.p4.Pz();
                 tru_eta = p.p4.Eta();
 
                 float deltaPz     = tru_pz - nu.p4.Pz();
                 float deltaPz_smp = tru_pz - nu.pz_sampling;
-                fill("nu_deltaPz_"+name, deltaPz, event_weight);           // standard reconstruction
-                fill("nu_deltaPz_smp_"+name, deltaPz_smp, event_weight);   // sampling reconstruction
+                fill(hists[kNuDeltaPz], deltaPz, event_weights);           // standard reconstruction
+                fill(hists[kNuDeltaPzSmp], deltaPz_smp, event_weights);   // sampling reconstruction
 
                 float deltaEta     = tru_eta - nu.p4.Eta();
                 float deltaEta_smp = tru_eta - tmp_nu.Eta();
@@ -503,11 +735,11 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
                 float deltaR_smp   = p.p4.DeltaR(tmp_nu);
                 float deltaR_viper = p.p4.DeltaR(viper_nu);
 
-                fill("nu_deltaEta_"+name,     deltaEta,     event_weight);
-                fill("nu_deltaEta_smp_"+name, deltaEta_smp, event_weight);
-                fill("nu_deltaR_"+name,       deltaR,       event_weight);
-                fill("nu_deltaR_smp_"+name,   deltaR_smp,   event_weight);
-                fill("nu_deltaR_viper_"+name, deltaR_viper, event_weight);
+                fill(hists[kNuDeltaEta],     deltaEta,     event_weights);
+                fill(hists[kNuDeltaEtaSmp], deltaEta_smp, event_weights);
+                fill(hists[kNuDeltaR],       deltaR,       event_weights);
+                fill(hists[kNuDeltaRSmp],   deltaR_smp,   event_weights);
+                fill(hists[kNuDeltaRViper], deltaR_viper, event_weights);
 
 //                fill("nu_truth_pz_deltaPz_"+name,     tru_pz, deltaPz,     event_weight);
 //                fill("nu_truth_pz_deltaPz_smp_"+name, tru_pz, deltaPz_smp, event_weight);
@@ -520,17 +752,17 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
 
     // kinematics
     cma::DEBUG("HISTOGRAMMER : Fill kinematics");
-    fill("mtw_"+name,     met.mtw,      event_weight);
-    fill("met_met_"+name, met.p4.Pt(),  event_weight);
-    fill("met_phi_"+name, met.p4.Phi(), event_weight);
-    fill("ht_"+name,      event.HT(),   event_weight);
-    fill("st_"+name,      event.ST(),   event_weight);
+    fill(hists[kMTW],     met.mtw,      event_weights);
+    fill(hists[kMETmet], met.p4.Pt(),  event_weights);
+    fill(hists[kMETphi], met.p4.Phi(), event_weights);
+    fill(hists[kHT],      event.HT(),   event_weights);
+    fill(hists[kST],      event.ST(),   event_weights);
 
     if (m_config->useWprime()){
-        fill("wprimeMass_"+name, wpreco.p4.M(),     event_weight);
-        fill("vlqMass_"+name,    wpreco.vlq.p4.M(), event_weight);
-        fill("wprimeMass_nusmp_"+name, wpreco_smp.p4.M(),     event_weight);
-        fill("vlqMass_nusmp_"+name,    wpreco_smp.vlq.p4.M(), event_weight);
+        fill(hists[kWprimeMass], wpreco.p4.M(),     event_weights);
+        fill(hists[kVLQMass],    wpreco.vlq.p4.M(), event_weights);
+        fill(hists[kWprimeMassNuSmp], wpreco_smp.p4.M(),     event_weights);
+        fill(hists[kVLQMassNuSmp],    wpreco_smp.vlq.p4.M(), event_weights);
     }
 
     if (m_config->useTruth() && m_config->isSignal()){
@@ -538,10 +770,17 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
 
         TruthWprime wp = event.truth_wprime();
 
+        // only the jets in the (eta,phi) cells near the quark can be within drmin
+        static thread_local etaPhiGrid jetGrid(0.4);
+        static thread_local std::vector<int> nearby;
+        jetGrid.build( jets );
+
         float ptmin(0.0);
         float drmin(0.4);
         int j_index(-1);
-        for (const auto& j : jets) {
+        jetGrid.candidates( wp.quark.p4, drmin, nearby );
+        for (const auto& c : nearby) {
+            const Jet& j = jets.at(c);
             if (j.p4.DeltaR(wp.quark.p4)<drmin && j.p4.Pt()>ptmin) {
                 j_index = j.index;
                 drmin = j.p4.DeltaR(wp.quark.p4);
@@ -549,8 +788,8 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
             }
         }
         if (j_index>=0) {
-            fill("jet_pt_truth_quark_Wprime_"+name,   jets.at(j_index).p4.Pt(), event_weight);
-            fill("jet_bdisc_truth_quark_Wprime_"+name,jets.at(j_index).bdisc,   event_weight);
+            fill(hists[kJetPtTruthQuarkWprime],   jets.at(j_index).p4.Pt(), event_weights);
+            fill(hists[kJetBdiscTruthQuarkWprime],jets.at(j_index).bdisc,   event_weights);
         }
 
         TLorentzVector wp_quark = wp.quark.p4;
@@ -560,32 +799,32 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
         TLorentzVector wp_boson_child0 = wp.BosonChildren[0].p4;  // first child from boson (boson from VLQ)
         TLorentzVector wp_boson_child1 = wp.BosonChildren[1].p4;  // second child from boson (boson from VLQ)
 
-        fill("truth_wprime_mass_"+name,  wp.wprime.p4.M(), event_weight );
-        fill("truth_vlq_mass_"+name,     wp_vlq.M(),    event_weight );
-        fill("truth_quark_pt_"+name,     wp_quark.Pt(), event_weight );
-        fill("truth_vlq_boson_pt_"+name, wp_vlq_boson.Pt(), event_weight );
-        fill("truth_vlq_quark_pt_"+name, wp_vlq_quark.Pt(), event_weight );
+        fill(hists[kTruthWprimeMass],  wp.wprime.p4.M(), event_weights );
+        fill(hists[kTruthVLQMass],     wp_vlq.M(),    event_weights );
+        fill(hists[kTruthQuarkPt],     wp_quark.Pt(), event_weights );
+        fill(hists[kTruthVLQBosonPt], wp_vlq_boson.Pt(), event_weights );
+        fill(hists[kTruthVLQQuarkPt], wp_vlq_quark.Pt(), event_weights );
 
-        fill("truth_quark_vlq_energy_"+name,       wp_quark.Pt(), wp_vlq.Pt(), event_weight); // quark vs vlq energy
-        fill("truth_quark_vlq_energy_diff_"+name,  (wp_quark.Pt()-wp_vlq.Pt()),event_weight); // quark vs vlq energy
-        fill("truth_quark_vlq_energy_asymm_"+name, (wp_quark.Pt()-wp_vlq.Pt())/(wp_quark.Pt()+wp_vlq.Pt()),event_weight); // quark vs vlq energy
+        fill(hists[kTruthQuarkVLQEnergy],       wp_quark.Pt(), wp_vlq.Pt(), event_weights); // quark vs vlq energy
+        fill(hists[kTruthQuarkVLQEnergyDiff],  (wp_quark.Pt()-wp_vlq.Pt()),event_weights); // quark vs vlq energy
+        fill(hists[kTruthQuarkVLQEnergyAsymm], (wp_quark.Pt()-wp_vlq.Pt())/(wp_quark.Pt()+wp_vlq.Pt()),event_weights); // quark vs vlq energy
 
-        fill("truth_deltaR_wprime_quark-vlq_"+name, wp_quark.DeltaR( wp_vlq ), event_weight );            // deltaR( VLQ, quark ) from Wprime decay
-        fill("truth_deltaR_vlq_boson-quark_"+name,  wp_vlq_boson.DeltaR( wp_vlq_quark ), event_weight );  // deltaR( boson, quark ) from VLQ decay
-        fill("truth_deltaR_boson_decays_"+name,     wp_boson_child0.DeltaR( wp_boson_child1 ), event_weight );  // deltaR( child0, child1 ) from boson decay
+        fill(hists[kTruthDeltaRWprimeQuarkVLQ], wp_quark.DeltaR( wp_vlq ), event_weights );            // deltaR( VLQ, quark ) from Wprime decay
+        fill(hists[kTruthDeltaRVLQBosonQuark],  wp_vlq_boson.DeltaR( wp_vlq_quark ), event_weights );  // deltaR( boson, quark ) from VLQ decay
+        fill(hists[kTruthDeltaRBosonDecays],     wp_boson_child0.DeltaR( wp_boson_child1 ), event_weights );  // deltaR( child0, child1 ) from boson decay
 
         // Mass resolution
-        fill("vlq_massResolution_"+name,         wp_vlq.M() -wpreco.vlq.p4.M(), event_weight);              // truth-reco
-        fill("vlq_massResolution_norm_"+name,    (wp_vlq.M()-wpreco.vlq.p4.M())/wp_vlq.M(), event_weight); // (truth-reco)/truth
-        fill("vlqMass_truth_vs_reco_"+name,      wp_vlq.M(), wpreco.vlq.p4.M(), event_weight);             // truth vs reco
-        fill("wprime_massResolution_"+name,      wp.wprime.p4.M() -wpreco.p4.M(), event_weight);         // truth-reco
-        fill("wprime_massResolution_norm_"+name, (wp.wprime.p4.M()-wpreco.p4.M())/wp.wprime.p4.M(),event_weight); // (truth-reco)/truth
-        fill("wprimeMass_truth_vs_reco_"+name,   wp.wprime.p4.M(), wpreco.p4.M(), event_weight);         // truth vs reco
+        fill(hists[kVLQMassResolution],         wp_vlq.M() -wpreco.vlq.p4.M(), event_weights);              // truth-reco
+        fill(hists[kVLQMassResolutionNorm],    (wp_vlq.M()-wpreco.vlq.p4.M())/wp_vlq.M(), event_weights); // (truth-reco)/truth
+        fill(hists[kVLQMassTruthVsReco],      wp_vlq.M(), wpreco.vlq.p4.M(), event_weights);             // truth vs reco
+        fill(hists[kWprimeMassResolution],      wp.wprime.p4.M() -wpreco.p4.M(), event_weights);         // truth-reco
+        fill(hists[kWprimeMassResolutionNorm], (wp.wprime.p4.M()-wpreco.p4.M())/wp.wprime.p4.M(),event_weights); // (truth-reco)/truth
+        fill(hists[kWprimeMassTruthVsReco],   wp.wprime.p4.M(), wpreco.p4.M(), event_weights);         // truth vs reco
         // Mass resolution with sampling neutrino
-        fill("vlq_massResolution_norm_nusmp_"+name,    (wp_vlq.M()-wpreco_smp.vlq.p4.M())/wp_vlq.M(), event_weight);
-        fill("vlqMass_truth_vs_reco_nusmp_"+name,      wp_vlq.M(), wpreco_smp.vlq.p4.M(), event_weight);
-        fill("wprime_massResolution_norm_nusmp_"+name, (wp.wprime.p4.M()-wpreco_smp.p4.M())/wp.wprime.p4.M(),event_weight);
-        fill("wprimeMass_truth_vs_reco_nusmp_"+name,   wp.wprime.p4.M(), wpreco_smp.p4.M(), event_weight);
+        fill(hists[kVLQMassResolutionNormNuSmp],    (wp_vlq.M()-wpreco_smp.vlq.p4.M())/wp_vlq.M(), event_weights);
+        fill(hists[kVLQMassTruthVsRecoNuSmp],      wp_vlq.M(), wpreco_smp.vlq.p4.M(), event_weights);
+        fill(hists[kWprimeMassResolutionNormNuSmp], (wp.wprime.p4.M()-wpreco_smp.p4.M())/wp.wprime.p4.M(),event_weights);
+        fill(hists[kWprimeMassTruthVsRecoNuSmp],   wp.wprime.p4.M(), wpreco_smp.p4.M(), event_weights);
     }
 
 /*
@@ -598,102 +837,292 @@ void histogrammer::fill( const std::string& name, Event& event, double event_wei
 }
 
 
+void histogrammer::fillSpecs( const std::vector<int>& hists, Event& event, const std::vector<double>& event_weights ){
+    /* Fill the histograms of the histograms file
+       Only the collections used by these histograms are taken from the event,
+       and only the observables of each histogram are calculated
 
+       @param hists           Handles of one set of histograms (index = m_specs)
+       @param event_weights   Nominal weight, then the weight systematics (if they are filled)
+    */
+    cma::DEBUG("HISTOGRAMMER : Fill histograms from "+m_histogramsFile);
+
+    std::vector<Jet> jets;
+    std::vector<Ljet> ljets;
+    std::vector<Lepton> leptons;
+    std::vector<Lepton> electrons;
+    std::vector<Lepton> muons;
+    std::vector<Neutrino> neutrinos;
+    MET met;
+
+    if (m_specCollections[kCollJets])  jets  = event.jets();
+    if (m_specCollections[kCollLjets]) ljets = event.ljets();
+    if (m_specCollections[kCollLeptons] || m_specCollections[kCollElectrons] || m_specCollections[kCollMuons]){
+        leptons = event.leptons();
+        for (const auto& lep : leptons){
+            if (lep.isElectron) electrons.push_back( lep );
+            else if (lep.isMuon) muons.push_back( lep );
+        }
+    }
+    if (m_specCollections[kCollNeutrinos]) neutrinos = event.neutrinos();
+    if (m_specCollections[kCollMET]) met = event.met();
+
+    for (unsigned int s=0, size=m_specs.size(); s<size; s++){
+        if (hists[s]<0) continue;
+        const HistSpec& spec = m_specs[s];
+
+        switch (spec.collection){
+          case kCollEvent:     fillObject( spec, hists[s], event, event_weights ); break;
+          case kCollMET:       fillObject( spec, hists[s], met,   event_weights ); break;
+          case kCollJets:      fillObjects( spec, hists[s], jets,      event_weights ); break;
+          case kCollLjets:     fillObjects( spec, hists[s], ljets,     event_weights ); break;
+          case kCollLeptons:   fillObjects( spec, hists[s], leptons,   event_weights ); break;
+          case kCollElectrons: fillObjects( spec, hists[s], electrons, event_weights ); break;
+          case kCollMuons:     fillObjects( spec, hists[s], muons,     event_weights ); break;
+          case kCollNeutrinos: fillObjects( spec, hists[s], neutrinos, event_weights ); break;
+        }
+    }
 
+    return;
+}
 
-/**** OVER/UNDERFLOW ****/
 
-void histogrammer::overUnderFlow(){
-    /* Call overflow and underflow functions at once */
-    overFlow();
-    underFlow();
+template<typename T>
+bool histogrammer::passConditions( const HistSpec& spec, const T& object ) const{
+    /* All conditions of the histogram pass for this object */
+    for (const auto& cond : spec.conditions){
+        if (!compare( value(object,cond.observable), cond.comparison, cond.value )) return false;
+    }
+
+    return true;
+}
+
+
+template<typename T>
+void histogrammer::fillObject( const HistSpec& spec, const int handle, const T& object,
+                               const std::vector<double>& event_weights ){
+    /* Fill the observables of one object (or the event) */
+    if (!passConditions(spec,object)) return;
+
+    const std::vector<unsigned int>& obs = spec.observables;
+    if (obs.size()==1)      fill( handle, value(object,obs[0]), event_weights );
+    else if (obs.size()==2) fill( handle, value(object,obs[0]), value(object,obs[1]), event_weights );
+    else                    fill( handle, value(object,obs[0]), value(object,obs[1]), value(object,obs[2]), event_weights );
+
     return;
 }
 
 
-void histogrammer::overFlow() {
-    /* Add overflow to last bin */
-    if (!m_putOverflowInLastBin){
-        cma::INFO("HISTOGRAMMER : Not putting overflow in last bin(s)");
+template<typename T>
+void histogrammer::fillObjects( const HistSpec& spec, const int handle, const std::vector<T>& objects,
+                                const std::vector<double>& event_weights ){
+    /* Fill each object of a collection (or one object by index, or the number of objects) */
+    unsigned int first = (spec.index>=0) ? spec.index : 0;
+    unsigned int last  = (spec.index>=0) ? std::min( (unsigned int)spec.index+1, (unsigned int)objects.size() ) : objects.size();
+
+    if (spec.observables[0]==kObsN){
+        unsigned int nObjects(0);
+        for (unsigned int i=first; i<last; i++){
+            if (passConditions(spec,objects[i])) nObjects++;
+        }
+        fill( handle, nObjects, event_weights );
         return;
     }
-    else{
-        // loop over 1D histograms
-        for (const auto& hist : m_map_histograms1D){
-            unsigned int numBins = hist.second->GetNbinsX();
-            double overflowContent = hist.second->GetBinContent(numBins + 1);
-
-            hist.second->AddBinContent(numBins,overflowContent); // add overflow to last bin
-            hist.second->SetBinContent(numBins+1, 0);            // set overflow to 0
-        }
-        // loop over 2D histograms
-        for (const auto& hist : m_map_histograms2D){
-            unsigned int numBinsX = hist.second->GetXaxis()->GetNbins();
-            unsigned int numBinsY = hist.second->GetYaxis()->GetNbins();
-
-            // x-axis :: overflow in y
-            for (unsigned int xx=1;xx<numBinsX+1;++xx){
-                double overflowContent = hist.second->GetBinContent(xx,numBinsY+1);
-
-                int lastBin     = hist.second->GetBin(xx,numBinsY);
-                int overflowBin = hist.second->GetBin(xx,numBinsY+1);
-                hist.second->AddBinContent(lastBin,overflowContent); // add overflow to last bin
-                hist.second->SetBinContent(overflowBin,0);           // set overflow to 0
-            }
-            // y-axis :: overflow in x
-            for (unsigned int yy=1;yy<numBinsY;++yy){
-                double overflowContent = hist.second->GetBinContent(numBinsX+1,yy);
-
-                int lastBin     = hist.second->GetBin(numBinsX,yy);
-                int overflowBin = hist.second->GetBin(numBinsX+1,yy);
-                hist.second->AddBinContent(lastBin,overflowContent); // add overflow to last bin
-                hist.second->SetBinContent(overflowBin,0);           // set overflow to 0
-            }
-        } // end 2D histogram overflow
-    } // end else put overflow in first bin
+
+    for (unsigned int i=first; i<last; i++)
+        fillObject( spec, handle, objects[i], event_weights );
 
     return;
 }
 
-void histogrammer::underFlow() {
-    /* Add underflow to first bin */
-    if (!m_putUnderflowInFirstBin){
-        cma::INFO("HISTOGRAMMER : Not putting underflow in first bin(s)");
-        return;
+
+bool histogrammer::compare( const double value, const unsigned int comparison, const float cut ) const{
+    /* Condition of the histograms file */
+    switch (comparison){
+      case kLessThan:     return value <  cut;
+      case kLessEqual:    return value <= cut;
+      case kGreaterThan:  return value >  cut;
+      case kGreaterEqual: return value >= cut;
+      case kEqual:        return value == cut;
+      case kNotEqual:     return value != cut;
+    }
+
+    return false;
+}
+
+
+double histogrammer::value( const CmaBase& object, const unsigned int observable ) const{
+    /* Four-vector observables */
+    switch (observable){
+      case kObsPt:     return object.p4.Pt();
+      case kObsEta:    return object.p4.Eta();
+      case kObsPhi:    return object.p4.Phi();
+      case kObsMass:   return object.p4.M();
+      case kObsEnergy: return object.p4.E();
+      case kObsIsGood: return object.isGood;
+    }
+
+    return 0.;
+}
+
+double histogrammer::value( const Jet& jet, const unsigned int observable ) const{
+    if (observable==kObsBdisc)  return jet.bdisc;
+    if (observable==kObsCharge) return jet.charge;
+    return value( static_cast<const CmaBase&>(jet), observable );
+}
+
+double histogrammer::value( const Ljet& ljet, const unsigned int observable ) const{
+    switch (observable){
+      case kObsCharge: return ljet.charge;
+      case kObsSDmass: return ljet.softDropMass;
+      case kObsTau21:  return ljet.tau21;
+      case kObsTau32:  return ljet.tau32;
+    }
+
+    return value( static_cast<const Jet&>(ljet), observable );
+}
+
+double histogrammer::value( const Lepton& lepton, const unsigned int observable ) const{
+    if (observable==kObsCharge) return lepton.charge;
+    return value( static_cast<const CmaBase&>(lepton), observable );
+}
+
+double histogrammer::value( const MET& met, const unsigned int observable ) const{
+    if (observable==kObsMTW) return met.mtw;
+    return value( static_cast<const CmaBase&>(met), observable );
+}
+
+double histogrammer::value( const Event& event, const unsigned int observable ) const{
+    /* Event-level observables */
+    switch (observable){
+      case kObsHT:     return event.HT();
+      case kObsST:     return event.ST();
+      case kObsNBtags: return event.btag_jets().size();
     }
-    else{
-        // loop over 1D histograms
-        for (const auto& hist : m_map_histograms1D){
-            double underflowContent = hist.second->GetBinContent(0);
 
-            hist.second->AddBinContent(1, underflowContent);  // add underflow to first bin
-            hist.second->SetBinContent(0, 0);                 // set underflow to 0
+    return 0.;
+}
+
+
+
+
+
+/**** WRITE HISTOGRAMS ****/
+
+void histogrammer::setNumberOfShards( const unsigned int nShards ){
+    /* One copy of the histograms per thread filling them (after booking) -- see histShards */
+    m_hists.setNumberOfShards( nShards );
+    return;
+}
+
+void histogrammer::finalize( TFile& outputFile ){
+    /* Write the TH1D/TH2D/TH3D of the flat histograms (in the order they were booked, with their weight variations)
+       one at a time: only one dense ROOT histogram is in memory at once
+    */
+    outputFile.cd();
+
+    m_hists.merge();    // add the histograms filled by each thread
+
+    if (!m_putOverflowInLastBin)   cma::INFO("HISTOGRAMMER : Not putting overflow in last bin(s)");
+    if (!m_putUnderflowInFirstBin) cma::INFO("HISTOGRAMMER : Not putting underflow in first bin(s)");
+
+    unsigned long long allocatedBytes(0);
+    unsigned long long denseBytes(0);
+    for (auto& hist : m_hists.merged()){
+        allocatedBytes += hist.allocatedBytes();
+        denseBytes     += hist.denseBytes();
+
+        for (const auto& root_hist : hist.materialize()){
+            overUnderFlow( root_hist );
+            root_hist->Write();
+            delete root_hist;
         }
-        // loop over 2D histograms
-        for (const auto& hist : m_map_histograms2D){
-            unsigned int numBinsX = hist.second->GetXaxis()->GetNbins();
-            unsigned int numBinsY = hist.second->GetYaxis()->GetNbins();
-
-            // x-axis :: underflow in y
-            for (unsigned int xx=1;xx<numBinsX+1;++xx){
-                double underflowContent = hist.second->GetBinContent(xx,numBinsY+1);
-
-                int firstBin     = hist.second->GetBin(xx,1);
-                int underflowBin = hist.second->GetBin(xx,0);
-                hist.second->AddBinContent(firstBin,underflowContent); // add overflow to last bin
-                hist.second->SetBinContent(underflowBin,0);            // set overflow to 0
+        hist.reset();   // free the bins of this histogram
+    }
+
+    cma::INFO("HISTOGRAMMER : Histogram bins used "+std::to_string(allocatedBytes/1024)+" kB ("+
+              std::to_string(denseBytes/1024)+" kB if all bins were allocated)");
+
+    // the flat histograms are not needed anymore
+    m_hists.clear();
+
+    return;
+}
+
+
+
+/**** OVER/UNDERFLOW ****/
+
+void histogrammer::overUnderFlow( TH1* hist ){
+    /* Call overflow and underflow functions at once */
+    overFlow( hist );
+    underFlow( hist );
+    return;
+}
+
+
+void histogrammer::overFlow( TH1* hist ) {
+    /* Add overflow to last bin */
+    if (!m_putOverflowInLastBin) return;
+    fold( hist, true );
+    return;
+}
+
+void histogrammer::underFlow( TH1* hist ) {
+    /* Add underflow to first bin */
+    if (!m_putUnderflowInFirstBin) return;
+    fold( hist, false );
+    return;
+}
+
+
+void histogrammer::fold( TH1* hist, const bool overflow ){
+    /* Move the overflow (underflow) of every axis into the last (first) bin, for sum(w) & sum(w^2)
+       Works on the bin arrays: global bin = x + (nx+2)*(y + (ny+2)*z).
+       The axes are folded one after the other, so the corners end up in the corner bin
+       (e.g., (nx+1,ny+1) -> (nx,ny+1) -> (nx,ny)).
+    */
+    unsigned int dimension = hist->GetDimension();
+
+    double* sumw(nullptr);
+    if (dimension==1)      sumw = static_cast<TH1D*>(hist)->GetArray();
+    else if (dimension==2) sumw = static_cast<TH2D*>(hist)->GetArray();
+    else                   sumw = static_cast<TH3D*>(hist)->GetArray();
+    double* sumw2 = (hist->GetSumw2N()>0) ? hist->GetSumw2()->GetArray() : nullptr;
+
+    unsigned int nBins[3] = {(unsigned int)hist->GetNbinsX()+2, (unsigned int)hist->GetNbinsY()+2, (unsigned int)hist->GetNbinsZ()+2};
+    unsigned int nCells(1);
+    for (unsigned int d=0; d<dimension; d++) nCells *= nBins[d];
+
+    unsigned int stride(1);    // distance between neighbouring bins along this axis
+    for (unsigned int d=0; d<dimension; d++){
+        unsigned int from = (overflow) ? nBins[d]-1 : 0;
+        unsigned int to   = (overflow) ? nBins[d]-2 : 1;
+
+        // each slice of the histogram along this axis: 'stride' contiguous bins at 'from'
+        for (unsigned int slice=0; slice<nCells; slice+=stride*nBins[d]){
+            double* source = sumw + slice + from*stride;
+            double* target = sumw + slice + to*stride;
+            for (unsigned int i=0; i<stride; i++){
+                target[i] += source[i];
+                source[i]  = 0.;
             }
-            // y-axis :: underflow in x
-            for (unsigned int yy=1;yy<numBinsY;++yy){
-                double underflowContent = hist.second->GetBinContent(0,yy);
-
-                int firstBin     = hist.second->GetBin(1,yy);
-                int underflowBin = hist.second->GetBin(0,yy);
-                hist.second->AddBinContent(firstBin,underflowContent); // add overflow to last bin
-                hist.second->SetBinContent(underflowBin,0);           // set overflow to 0
+            if (!sumw2) continue;
+            source = sumw2 + slice + from*stride;
+            target = sumw2 + slice + to*stride;
+            for (unsigned int i=0; i<stride; i++){
+                target[i] += source[i];
+                source[i]  = 0.;
             }
-        } // end 2D histogram underflow
-    } // end else put underflow in first bin
+        }
+        stride *= nBins[d];
+    }
+
+    // like TH1::SetBinContent: keep the entries, recompute the statistics from the bins when needed
+    double stats[11] = {0.};
+    hist->PutStats( stats );
+
+    return;
 }
 
 // THE END
@@ -40,23 +40,35 @@ void histogrammer4ML::bookHists(){
     */
     cma::DEBUG("HISTOGRAMMER : Init. histograms: "+m_name);
 
-    histogrammer::init_hist( "met_met_"+m_name,    500, 0.0, 1000);
-    histogrammer::init_hist( "met_phi_"+m_name,     64, -3.2, 3.2);
-    histogrammer::init_hist( "mtw_"+m_name,        100, 0.0,  500);
-    histogrammer::init_hist( "lepton_pt_"+m_name,  500, 0.0, 2000);
-    histogrammer::init_hist( "lepton_eta_"+m_name,  50, -2.5, 2.5);
-    histogrammer::init_hist( "deltaPhi_lep_met_"+m_name, 16, -4, 4);
-
-    histogrammer::init_hist( "n_jets_"+m_name, 31, -0.5,  30.5 );
+    m_features.clear();
+    m_featureHists.clear();
+
+    bookFeature( "met_met",    "met_met",    500, 0.0, 1000);
+    bookFeature( "met_phi",    "met_phi",     64, -3.2, 3.2);
+    bookFeature( "mtw",        "mtw",        100, 0.0,  500);
+    bookFeature( "lepton_pt",  "lepton_pt",  500, 0.0, 2000);
+    bookFeature( "lepton_eta", "lepton_eta",  50, -2.5, 2.5);
+    bookFeature( "deltaPhi_lep_met", "deltaPhi_lep_met", 16, -4, 4);
+
+    bookFeature( "n_jets", "n_jets", 31, -0.5,  30.5 );
     for (unsigned int b=0; b<4; b++){
         std::string sb = std::to_string(b);
-        histogrammer::init_hist( "deltaPhi_j"+sb+"_met_phi_"+m_name, 16, -4, 4);
-        histogrammer::init_hist( "jet"+sb+"_bdisc_"+m_name, 50, 0, 1);
-        histogrammer::init_hist( "jet"+sb+"_ptrel_"+m_name, 50, 0, 1);
+        bookFeature( "deltaPhi_j"+sb+"_met_phi", "deltaPhi_j"+sb+"_met_phi", 16, -4, 4);
+        bookFeature( "jet"+sb+"_bdisc", "jet"+sb+"_bdisc", 50, 0, 1);
+        bookFeature( "jet"+sb+"_ptrel", "jet"+sb+"_ptrel", 50, 0, 1);
     }
 
-    histogrammer::init_hist( "nu_pz_standard_"+m_name, 1000, -3000, 3000);
-    histogrammer::init_hist( "nu_pz_sampling_"+m_name, 1000, -3000, 3000);
+    bookFeature( "pz_standard", "nu_pz_standard", 1000, -3000, 3000);
+    bookFeature( "pz_sampling", "nu_pz_sampling", 1000, -3000, 3000);
+
+    return;
+}
+
+void histogrammer4ML::bookFeature( const std::string& feature, const std::string& name,
+                                   const unsigned int nBins, const double x_min, const double x_max ){
+    /* Book the histogram of one feature & keep its handle */
+    m_features.push_back( feature );
+    m_featureHists.push_back( histogrammer::init_hist( name+"_"+m_name, nBins, x_min, x_max ) );
 
     return;
 }
@@ -69,23 +81,8 @@ void histogrammer4ML::fill( const std::map<std::string,double> features, double
     */
     cma::DEBUG("HISTOGRAMMER : Fill histograms: "+m_name);
 
-    histogrammer::fill( "met_met_"+m_name,    features.at("met_met"), weight);
-    histogrammer::fill( "met_phi_"+m_name,    features.at("met_phi"), weight);
-    histogrammer::fill( "mtw_"+m_name,        features.at("mtw"), weight);
-    histogrammer::fill( "lepton_pt_"+m_name,  features.at("lepton_pt"),  weight);
-    histogrammer::fill( "lepton_eta_"+m_name, features.at("lepton_eta"), weight);
-    histogrammer::fill( "deltaPhi_lep_met_"+m_name, features.at("deltaPhi_lep_met"), weight);
-
-    histogrammer::fill( "n_jets_"+m_name, features.at("n_jets"), weight);
-    for (unsigned int b=0; b<4; b++){
-        std::string sb = std::to_string(b);
-        histogrammer::fill( "deltaPhi_j"+sb+"_met_phi_"+m_name, features.at("deltaPhi_j"+sb+"_met_phi"), weight);
-        histogrammer::fill( "jet"+sb+"_bdisc_"+m_name, features.at("jet"+sb+"_bdisc"), weight);
-        histogrammer::fill( "jet"+sb+"_ptrel_"+m_name, features.at("jet"+sb+"_ptrel"), weight);
-    }
-
-    histogrammer::fill( "nu_pz_standard_"+m_name, features.at("pz_standard"), weight);
-    histogrammer::fill( "nu_pz_sampling_"+m_name, features.at("pz_sampling"), weight);
+    for (unsigned int f=0,size=m_features.size(); f<size; f++)
+        histogrammer::fill( m_featureHists[f], features.at(m_features[f]), weight );
 
     cma::DEBUG("HISTOGRAMMER : End histograms");
 
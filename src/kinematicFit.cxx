@@ -0,0 +1,412 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Kinematic fit of the 1-lepton W'->bT->bbW->bblv system
+- free parameters: neutrino px, py, pz & energy scale of the b-jet from the VLQ
+- chi2 terms: MET (x,y) resolution, b-jet energy resolution, W mass,
+              VLQ mass (optional, configuration option 'kinfitVLQMass')
+- the chi2 is a sum of squares with analytic derivatives, minimized with a
+  fixed-size Levenberg-Marquardt solver (no memory allocation, few iterations);
+  the same chi2 can be minimized with TMinuit (numerical gradients) for comparison
+*/
+#include "Analysis/CyMiniAna/interface/kinematicFit.h"
+
+namespace {
+    thread_local const KinematicFit* s_minuitFit = nullptr;     // object fitted by TMinuit
+}
+
+
+KinematicFit::KinematicFit( configuration& cmaConfig ) :
+  m_config(&cmaConfig),
+  m_fitJet(nullptr),
+  m_jet(-1),
+  m_jetScale(1.),
+  m_chi2(0.),
+  m_wmass(80.4),
+  m_wmassSigma(2.1),
+  m_vlqMass(0.),
+  m_vlqMassSigma(0.),
+  m_metSigma(20.),
+  m_jetStochastic(1.0),
+  m_jetConstant(0.05),
+  m_jetSigma(0.1),
+  m_maxIterations(50),
+  m_tolerance(1e-8),
+  m_gradTolerance(1e-6),
+  m_minuit(nullptr),
+  m_nFits(0),
+  m_nConverged(0),
+  m_nStalled(0),
+  m_nIterations(0),
+  m_fitTime(0.),
+  m_useMinuit(false){
+    m_nu = {};
+    m_lepton = {};
+    m_met = {};
+    m_jets.clear();
+
+    m_vlqMass      = m_config->kinfitVLQMass();
+    m_vlqMassSigma = 0.1*m_vlqMass;          // VLQ width & resolution
+
+    m_minuit = new TMinuit(kNPars);
+    m_minuit->SetPrintLevel(-1);
+    m_minuit->SetFCN( minuitFCN );
+  }
+
+KinematicFit::~KinematicFit() {
+    delete m_minuit;
+}
+
+
+void KinematicFit::setObjects(Lepton& lepton, MET& met){
+    /* Set lepton and MET from one function call */
+    m_lepton = lepton;
+    m_met    = met;
+    return;
+}
+
+
+void KinematicFit::setJets(std::vector<Jet> jets){
+    /* Candidates for the b-jet from the VLQ decay (only used with a VLQ mass hypothesis) */
+    m_jets = jets;
+    return;
+}
+
+
+bool KinematicFit::execute(const bool minuit){
+    /* Fit the event
+       - starting points: MET & the pz solutions of the W-mass constraint
+       - with a VLQ mass hypothesis each b-jet candidate is fitted, the lowest chi2 is kept
+    */
+    auto start = std::chrono::steady_clock::now();
+    m_useMinuit = minuit;
+
+    m_jet = -1;
+    m_jetScale = 1.;
+    m_chi2 = -1.;
+    m_nu.p4.SetPtEtaPhiM( m_met.p4.Pt(), 0., m_met.p4.Phi(), 0. );
+
+    // starting values of pz: W-mass constraint (real part for imaginary solutions)
+    double lepPt = m_lepton.p4.Pt();
+    double nuPt  = m_met.p4.Pt();
+    double A  = -lepPt*lepPt;
+    double mu = 0.5*m_wmass*m_wmass + lepPt*nuPt;
+    double B  = mu*m_lepton.p4.Pz();
+    double C  = mu*mu - m_lepton.p4.E()*m_lepton.p4.E()*nuPt*nuPt;
+    double discriminant = B*B - A*C;
+
+    std::vector<double> pz_starts;
+    if (A==0)
+        pz_starts.push_back(0.);
+    else if (discriminant<0)
+        pz_starts.push_back(-B/A);
+    else{
+        pz_starts.push_back( (-B-std::sqrt(discriminant))/A );
+        pz_starts.push_back( (-B+std::sqrt(discriminant))/A );
+    }
+
+    int nJets = (m_vlqMass>0) ? m_jets.size() : 0;
+    FitStatus status(kNotConverged);
+
+    for (int j=-1; j<nJets; j++){
+        if (j<0 && nJets>0) continue;              // VLQ mass hypothesis needs a jet
+        m_fitJet = (j>=0) ? &m_jets.at(j) : nullptr;
+
+        double jetE = (m_fitJet) ? std::max(m_fitJet->p4.E(),1.) : 100.;
+        m_jetSigma  = std::sqrt( m_jetStochastic*m_jetStochastic/jetE + m_jetConstant*m_jetConstant );
+
+        for (const auto& pz : pz_starts){
+            double par[kNPars] = {m_met.p4.Px(), m_met.p4.Py(), pz, 1.};
+            double chi2(0.);
+            unsigned int iterations(0);
+
+            FitStatus fit_status = (minuit) ? this->minuit( par, chi2 ) : levenbergMarquardt( par, chi2, iterations );
+            m_nIterations += iterations;
+
+            if (m_chi2<0 || chi2<m_chi2){
+                double E = std::sqrt( par[0]*par[0] + par[1]*par[1] + par[2]*par[2] );
+                m_nu.p4.SetPxPyPzE( par[0], par[1], par[2], E );
+                m_jet      = j;
+                m_jetScale = par[3];
+                m_chi2     = chi2;
+                status     = fit_status;
+            }
+        } // end loop over starting values
+    } // end loop over b-jet candidates
+
+    m_fitJet = nullptr;
+    m_nFits++;
+    if (status==kConverged) m_nConverged++;
+    else if (status==kStalled) m_nStalled++;
+    m_fitTime += std::chrono::duration<double,std::micro>( std::chrono::steady_clock::now()-start ).count();
+
+    cma::DEBUG("KINEMATICFIT : chi2 = "+std::to_string(m_chi2)+", neutrino pz = "+std::to_string(m_nu.p4.Pz()));
+
+    return (status==kConverged);
+}
+
+
+double KinematicFit::residuals( const double* par, double* r, double J[][kNPars] ) const{
+    /* Residuals r (chi2 = sum r^2) and their derivatives J[residual][parameter] (if J!=nullptr) */
+    double px = par[0];
+    double py = par[1];
+    double pz = par[2];
+    double s  = par[3];
+    double E  = std::sqrt( px*px + py*py + pz*pz + 1e-12 );       // massless neutrino
+
+    if (J){
+        for (unsigned int i=0; i<kNResiduals; i++){
+            for (unsigned int p=0; p<kNPars; p++) J[i][p] = 0.;
+        }
+    }
+
+    // MET
+    r[0] = (px - m_met.p4.Px()) / m_metSigma;
+    r[1] = (py - m_met.p4.Py()) / m_metSigma;
+
+    // b-jet energy scale
+    r[2] = (s - 1.) / m_jetSigma;
+
+    // W mass: m^2(lv) = (E_l+E_v)^2 - |p_l+p_v|^2
+    double Ew = m_lepton.p4.E() + E;
+    double wx = m_lepton.p4.Px() + px;
+    double wy = m_lepton.p4.Py() + py;
+    double wz = m_lepton.p4.Pz() + pz;
+    double wnorm = 2*m_wmass*m_wmassSigma;
+    r[3] = (Ew*Ew - wx*wx - wy*wy - wz*wz - m_wmass*m_wmass) / wnorm;
+
+    // VLQ mass: m^2(s*b+l+v)
+    r[4] = 0.;
+    double Et(0.), tx(0.), ty(0.), tz(0.), tnorm(1.);
+    if (m_fitJet){
+        const TLorentzVector& b = m_fitJet->p4;
+        Et = Ew + s*b.E();
+        tx = wx + s*b.Px();
+        ty = wy + s*b.Py();
+        tz = wz + s*b.Pz();
+        tnorm = 2*m_vlqMass*m_vlqMassSigma;
+        r[4] = (Et*Et - tx*tx - ty*ty - tz*tz - m_vlqMass*m_vlqMass) / tnorm;
+    }
+
+    if (J){
+        J[0][0] = 1./m_metSigma;
+        J[1][1] = 1./m_metSigma;
+        J[2][3] = 1./m_jetSigma;
+
+        // d(m^2)/dp_i = 2*(E_sum*p_i/E - p_sum,i)
+        J[3][0] = 2*(Ew*px/E - wx) / wnorm;
+        J[3][1] = 2*(Ew*py/E - wy) / wnorm;
+        J[3][2] = 2*(Ew*pz/E - wz) / wnorm;
+
+        if (m_fitJet){
+            const TLorentzVector& b = m_fitJet->p4;
+            J[4][0] = 2*(Et*px/E - tx) / tnorm;
+            J[4][1] = 2*(Et*py/E - ty) / tnorm;
+            J[4][2] = 2*(Et*pz/E - tz) / tnorm;
+            J[4][3] = 2*(Et*b.E() - tx*b.Px() - ty*b.Py() - tz*b.Pz()) / tnorm;
+        }
+    }
+
+    double chi2(0.);
+    for (unsigned int i=0; i<kNResiduals; i++)
+        chi2 += r[i]*r[i];
+
+    return chi2;
+}
+
+
+void KinematicFit::curvature( const double* par, const double* r, double H[][kNPars] ) const{
+    /* Second-order part of the chi2 Hessian: add sum_i r_i * d^2(r_i)/dp dq to H
+       (only the mass terms are not linear in the parameters)
+    */
+    double p[3] = {par[0], par[1], par[2]};
+    double E = std::sqrt( p[0]*p[0] + p[1]*p[1] + p[2]*p[2] + 1e-12 );
+    double Ew = m_lepton.p4.E() + E;
+
+    // d^2(m^2)/dp_i dp_j = 2*( p_i*p_j/E^2 + E_sum*(delta_ij/E - p_i*p_j/E^3) - delta_ij )
+    double wnorm = 2*m_wmass*m_wmassSigma;
+    double Et(0.), tnorm(1.);
+    const TLorentzVector* b(nullptr);
+    if (m_fitJet){
+        b  = &m_fitJet->p4;
+        Et = Ew + par[3]*b->E();
+        tnorm = 2*m_vlqMass*m_vlqMassSigma;
+    }
+
+    for (unsigned int i=0; i<3; i++){
+        for (unsigned int j=0; j<3; j++){
+            double delta = (i==j) ? 1. : 0.;
+            double pp = p[i]*p[j]/(E*E);
+            H[i][j] += r[3] * 2*( pp + Ew*(delta - pp)/E - delta ) / wnorm;
+            if (b) H[i][j] += r[4] * 2*( pp + Et*(delta - pp)/E - delta ) / tnorm;
+        }
+    }
+
+    if (b){
+        double bp[3] = {b->Px(), b->Py(), b->Pz()};
+        for (unsigned int i=0; i<3; i++){
+            double d2 = r[4] * 2*( b->E()*p[i]/E - bp[i] ) / tnorm;       // d^2(m^2)/ds dp_i
+            H[i][3] += d2;
+            H[3][i] += d2;
+        }
+        H[3][3] += r[4] * 2*b->M2() / tnorm;
+    }
+
+    return;
+}
+
+
+KinematicFit::FitStatus KinematicFit::levenbergMarquardt( double* par, double& chi2, unsigned int& iterations ) const{
+    /* Minimize the chi2: solve (H + lambda*diag(J^T J)) delta = -J^T r
+       with the full Hessian H = J^T J + sum r*d^2r (Newton steps close to the minimum);
+       lambda decreases after a step that lowers the chi2, increases otherwise.
+       Converged when a step changes the chi2 by less than m_tolerance (relative)
+       or the gradient 2 J^T r is below m_gradTolerance;
+       stalled when no step lowers the chi2 before that.
+    */
+    double r[kNResiduals];
+    double J[kNResiduals][kNPars];
+    double trial_r[kNResiduals];
+    double trial[kNPars];
+
+    chi2 = residuals( par, r, J );
+    double lambda(1e-3);
+    FitStatus status(kNotConverged);
+
+    for (iterations=0; iterations<m_maxIterations && status==kNotConverged; iterations++){
+        double JTJ[kNPars][kNPars];
+        double H[kNPars][kNPars];
+        double JTr[kNPars];
+        for (unsigned int p=0; p<kNPars; p++){
+            JTr[p] = 0.;
+            for (unsigned int i=0; i<kNResiduals; i++) JTr[p] += J[i][p]*r[i];
+            for (unsigned int q=0; q<kNPars; q++){
+                JTJ[p][q] = 0.;
+                for (unsigned int i=0; i<kNResiduals; i++) JTJ[p][q] += J[i][p]*J[i][q];
+                H[p][q] = JTJ[p][q];
+            }
+        }
+        curvature( par, r, H );
+
+        double gradient(0.);
+        for (unsigned int p=0; p<kNPars; p++) gradient += 4*JTr[p]*JTr[p];
+        if (std::sqrt(gradient) < m_gradTolerance){
+            status = kConverged;
+            break;
+        }
+
+        // try steps until the chi2 decreases
+        while (lambda<1e10){
+            double A[kNPars][kNPars];
+            double delta[kNPars];
+            for (unsigned int p=0; p<kNPars; p++){
+                for (unsigned int q=0; q<kNPars; q++) A[p][q] = H[p][q];
+                A[p][p] += lambda*JTJ[p][p];
+                delta[p] = -JTr[p];
+            }
+
+            if (solve( A, delta )){
+                for (unsigned int p=0; p<kNPars; p++) trial[p] = par[p] + delta[p];
+                double trial_chi2 = residuals( trial, trial_r, nullptr );
+
+                if (trial_chi2 < chi2){
+                    if (chi2-trial_chi2 < m_tolerance*(1.+chi2)) status = kConverged;
+                    for (unsigned int p=0; p<kNPars; p++) par[p] = trial[p];
+                    chi2    = residuals( par, r, J );
+                    lambda *= 0.1;
+                    break;
+                }
+            }
+            lambda *= 10.;
+        }
+
+        if (lambda>=1e10) status = kStalled;       // no step lowers the chi2 (gradient not small)
+    }
+
+    return status;
+}
+
+
+bool KinematicFit::solve( double A[][kNPars], double* b ){
+    /* Solve A x = b for symmetric positive-definite A (Cholesky), x is returned in b */
+    for (unsigned int i=0; i<kNPars; i++){
+        for (unsigned int j=0; j<=i; j++){
+            double sum = A[i][j];
+            for (unsigned int k=0; k<j; k++) sum -= A[i][k]*A[j][k];
+
+            if (i==j){
+                if (!(sum>0)) return false;
+                A[i][i] = std::sqrt(sum);
+            }
+            else
+                A[i][j] = sum / A[j][j];
+        }
+    }
+
+    // L y = b, then L^T x = y
+    for (unsigned int i=0; i<kNPars; i++){
+        for (unsigned int k=0; k<i; k++) b[i] -= A[i][k]*b[k];
+        b[i] /= A[i][i];
+    }
+    for (int i=kNPars-1; i>=0; i--){
+        for (unsigned int k=i+1; k<kNPars; k++) b[i] -= A[k][i]*b[k];
+        b[i] /= A[i][i];
+    }
+
+    return true;
+}
+
+
+KinematicFit::FitStatus KinematicFit::minuit( double* par, double& chi2 ) const{
+    /* Minimize the same chi2 with TMinuit (MIGRAD, numerical gradients) */
+    s_minuitFit = this;
+
+    const char* names[kNPars] = {"nu_px","nu_py","nu_pz","jet_scale"};
+    double steps[kNPars] = {m_metSigma, m_metSigma, 10., m_jetSigma};
+    for (unsigned int p=0; p<kNPars; p++)
+        m_minuit->DefineParameter( p, names[p], par[p], steps[p], 0., 0. );
+
+    int status = m_minuit->Migrad();
+
+    double error;
+    for (unsigned int p=0; p<kNPars; p++)
+        m_minuit->GetParameter( p, par[p], error );
+
+    double r[kNResiduals];
+    chi2 = residuals( par, r, nullptr );
+    s_minuitFit = nullptr;
+
+    return (status==0) ? kConverged : kNotConverged;
+}
+
+
+void KinematicFit::minuitFCN( int& npar, double* grad, double& f, double* par, int flag ){
+    /* chi2 for TMinuit */
+    double r[kNResiduals];
+    f = s_minuitFit->residuals( par, r, nullptr );
+    return;
+}
+
+
+void KinematicFit::summary() const{
+    /* Number of fits & CPU time per fit (compare the solvers) */
+    if (m_nFits<1) return;
+
+    std::string method = (m_useMinuit) ? "TMinuit" : "Levenberg-Marquardt";
+    cma::INFO("KINEMATICFIT : "+std::to_string(m_nFits)+" fits ("+method+"), "+
+              std::to_string(m_fitTime/m_nFits)+" us per event, "+
+              std::to_string(100.*m_nConverged/m_nFits)+"% converged, "+
+              std::to_string(100.*m_nStalled/m_nFits)+"% stalled");
+    if (!m_useMinuit)
+        cma::INFO("KINEMATICFIT : "+std::to_string(double(m_nIterations)/m_nFits)+" iterations per event");
+
+    return;
+}
+
+// THE END //
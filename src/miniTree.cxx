@@ -13,30 +13,55 @@ Create and fill TTree.
 
 
 miniTree::miniTree(configuration &cmaConfig) : 
-  m_config(&cmaConfig){
+  m_ttree(nullptr),
+  m_oldTTree(nullptr),
+  m_config(&cmaConfig),
+  m_asyncOutput(false),
+  m_inputFile(nullptr),
+  m_writer(cmaConfig.outputQueueSize()){
     m_selections = m_config->selections();
+    m_branchSlimming = m_config->branchSlimming();
+    m_asyncOutput    = m_config->asyncOutput();
   }
 
 miniTree::~miniTree() {}
 
 
 
-void miniTree::initialize(TTree* t, TFile& outputFile, const std::string directory, const int cloneFactor) {
-    /* Setup the new tree
+void miniTree::initialize(TFile& outputFile, const std::string directory, const int cloneFactor) {
+    /* Setup the new tree (copy of the TTree 'treename' in the input file of the configuration)
 
-       @param t    TTree from the original file
+       @param outputFile   File the new tree is written to
        @param directory    Directory the tree may be stored under
        @param cloneFactor  Value used in cloning the tree 
                            (0=clone no events, just branch names; -1=clone all data)
+
+       The entries are copied from a separate handle of the input file, so
+       slimming (SetBranchStatus) never touches the tree that the TTreeReader
+       in the event loop reads, and with 'asyncOutput' the output thread never
+       shares branch buffers with it.
     */
+    m_inputFile = TFile::Open( m_config->filename().c_str() );
+    if (!m_inputFile || m_inputFile->IsZombie()){
+        cma::ERROR("MINITREE : Cannot open the input file "+m_config->filename()+" for the skim");
+        exit(EXIT_FAILURE);
+    }
+    m_oldTTree = (TTree*)m_inputFile->Get( m_config->treename().c_str() );
+    if (!m_oldTTree){
+        cma::ERROR("MINITREE : TTree "+m_config->treename()+" does not exist in "+m_config->filename());
+        exit(EXIT_FAILURE);
+    }
     outputFile.cd(directory.c_str());
-    m_oldTTree = t;
+    cma::getListOfBranches(m_oldTTree,m_listOfBranches);
 
+    disableBranches();    // before cloning: disabled branches are not copied to the new tree
     m_ttree = m_oldTTree->CloneTree(cloneFactor);
-    cma::getListOfBranches(m_oldTTree,m_listOfBranches);
 
     createBranches();
-    disableBranches();
+    setBuffers();
+
+    if (m_asyncOutput)
+        m_writer.start( [this](miniTreeEntry& entry){ fillEntry(entry); } );
 
     return;
 }
@@ -57,6 +82,20 @@ void miniTree::createBranches(){
 }
 
 
+void miniTree::setBuffers(){
+    /* Basket size & cluster size of the output tree (cloned trees keep the input values otherwise) 
+       Call after all branches are created
+    */
+    int basketSize      = m_config->basketSize();
+    long long autoFlush = m_config->autoFlush();
+
+    if (basketSize>0) m_ttree->SetBasketSize("*",basketSize);
+    if (autoFlush!=0) m_ttree->SetAutoFlush(autoFlush);
+
+    return;
+}
+
+
 bool miniTree::branch_exists(const std::string& br){
     /* Check if branch exists in the tree already 
        > True if it exists; False if it does not exist
@@ -67,24 +106,97 @@ bool miniTree::branch_exists(const std::string& br){
 
 void miniTree::disableBranches(){
     /* Disable branches in output file 
-       > m_ttree->SetBranchStatus(branch, 0);
+       > m_oldTTree->SetBranchStatus(branch, 0);
+       Statements from the 'slimmingFile' are processed in order (last match wins):
+         drop *
+         keep AK4*
+         keep HLT_Mu??
+       Dropped branches are neither read (GetEntry in saveEvent) nor written.
+       Only the skim's own copy of the input tree is slimmed, so Event can still
+       read branches that are dropped from the output.
+       The log shows the size of the dropped branches in the input file; the size
+       of the kept branches in the output is reported in finalize().
     */
+    if (m_branchSlimming.size()<1) return;
+
+    std::vector<std::string> actions;
+    std::vector<std::string> patterns;
+    for (const auto& statement : m_branchSlimming){
+        std::istringstream stmt(statement);
+        std::string action;
+        std::string pattern;
+        stmt >> action >> pattern;
+
+        if ( (action.compare("keep")!=0 && action.compare("drop")!=0) || pattern.size()<1 ){
+            cma::WARNING("MINITREE : Unknown slimming statement '"+statement+"', expected 'keep <pattern>' or 'drop <pattern>'");
+            continue;
+        }
+        actions.push_back(action);
+        patterns.push_back(pattern);
+    }
+
+    // size in the input file (compressed) of the branches each pattern removes
+    double totalBytes = m_oldTTree->GetZipBytes();
+    std::map<std::string,unsigned int> droppedBranches;  // pattern -> N branches
+    std::map<std::string,double> droppedBytes;           // pattern -> compressed bytes
+    unsigned int nDropped(0);
+
+    for (const auto& br : m_listOfBranches){
+        int last_match(-1);
+        for (unsigned int i=0,size=patterns.size(); i<size; i++){
+            if (cma::wildcardMatch(patterns.at(i),br)) last_match = i;
+        }
+        if (last_match<0 || actions.at(last_match).compare("keep")==0){
+            m_keptBranches[(last_match<0) ? "(no statement)" : patterns.at(last_match)].push_back(br);
+            continue;
+        }
+
+        m_oldTTree->SetBranchStatus(br.c_str(), 0);
+
+        TBranch* branch = m_oldTTree->GetBranch(br.c_str());
+        std::string pattern = patterns.at(last_match);
+        droppedBranches[pattern]++;
+        droppedBytes[pattern] += (branch) ? branch->GetZipBytes() : 0;
+        nDropped++;
+    }
+
+    cma::INFO("MINITREE : Dropped "+std::to_string(nDropped)+"/"+std::to_string(m_listOfBranches.size())+" branches");
+    for (const auto& drop : droppedBranches){
+        double mbytes   = droppedBytes.at(drop.first) / 1048576.;
+        double fraction = (totalBytes>0) ? 100.*droppedBytes.at(drop.first)/totalBytes : 0.;
+        cma::INFO("MINITREE :   drop "+drop.first+" -> "+std::to_string(drop.second)+" branches, "+
+                  std::to_string(mbytes)+" MB in the input file ("+std::to_string(fraction)+"% of the input tree, all entries)");
+    }
+
     return;
 } 
 
 
-void miniTree::saveEvent(Event& event, const std::vector<unsigned int>& evtsel_decisions) {
+void miniTree::saveEvent(Event& event, const unsigned int evtsel_decisions) {
     /* Save the event to the ttree! */
+    miniTreeEntry entry;
+    entry.entry     = event.entry();
+    entry.decisions = evtsel_decisions;
+
+    if (m_asyncOutput)
+        m_writer.push( entry );   // filled on the output thread
+    else
+        fillEntry( entry );
+
+    return;
+}
+
+
+void miniTree::fillEntry(miniTreeEntry& entry) {
+    /* Copy one entry from the input tree to the output tree */
     cma::DEBUG("MINITREE : Load the entry to be saved");
-    m_oldTTree->GetEntry( event.entry() );  // make sure the original values are loaded for this event
+    m_oldTTree->GetEntry( entry.entry );    // make sure the original values are loaded for this event
                                             // otherwise only the branches accessed in Event are copied (!?)
 
-    // set all decisions to false if they aren't passed here
+    // decisions are false if they aren't passed here
     unsigned int n_sels = m_selections.size();
-    bool generateDecisions = (evtsel_decisions.size()<1);
-
     for (unsigned int idx=0; idx<n_sels; idx++)
-        m_passSelection.at(idx) = (generateDecisions) ? 0 : evtsel_decisions.at(idx); // set to 0 by default
+        m_passSelection.at(idx) = (entry.decisions >> idx) & 1;
 
 
     cma::DEBUG("MINITREE : Fill the tree");
@@ -96,6 +208,30 @@ void miniTree::saveEvent(Event& event, const std::vector<unsigned int>& evtsel_d
 
 void miniTree::finalize(){
     /* Finalize the class */
+    if (m_asyncOutput)
+        m_writer.stop();           // write the remaining entries
+
+    if (m_ttree && m_keptBranches.size()>0){
+        // size in the output file (compressed) of the branches each slimming statement keeps
+        m_ttree->FlushBaskets();
+        double totalBytes = m_ttree->GetZipBytes();
+        cma::INFO("MINITREE : Output tree "+std::to_string(totalBytes/1048576.)+" MB for "+std::to_string(m_ttree->GetEntries())+" entries");
+        for (const auto& keep : m_keptBranches){
+            double bytes(0.);
+            for (const auto& br : keep.second){
+                TBranch* branch = m_ttree->GetBranch(br.c_str());
+                bytes += (branch) ? branch->GetZipBytes("*") : 0;
+            }
+            double fraction = (totalBytes>0) ? 100.*bytes/totalBytes : 0.;
+            cma::INFO("MINITREE :   keep "+keep.first+" -> "+std::to_string(keep.second.size())+" branches, "+
+                      std::to_string(bytes/1048576.)+" MB in the output file ("+std::to_string(fraction)+"% of the output tree)");
+        }
+    }
+
+    delete m_inputFile;
+    m_inputFile = nullptr;
+
+    return;
 }
 
 // THE END
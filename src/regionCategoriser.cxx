@@ -0,0 +1,87 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Categorise selected events into the QCD/ABCD regions
+(configuration::qcdSelections) in one pass:
+the number of b-tags and top-tags is counted once per event and
+the event is routed to the region with index
+
+    region = 3*min(n_btag,2) + min(n_toptag,2)
+
+The histogrammer books/fills one set of histograms per region by this index.
+*/
+#include "Analysis/CyMiniAna/interface/regionCategoriser.h"
+
+
+regionCategoriser::regionCategoriser(configuration &cmaConfig) :
+  m_config(&cmaConfig),
+  m_maxTags(2),
+  m_region(-1){
+    m_selections = m_config->selections();
+    m_regions    = m_config->qcdSelections();
+    m_cutflow.clear();
+    m_cutflow_unw.clear();
+
+    if (m_regions.size()!=(m_maxTags+1)*(m_maxTags+1)){
+        cma::ERROR("REGIONCATEGORISER : Expected "+std::to_string((m_maxTags+1)*(m_maxTags+1))+" QCD regions, found "+std::to_string(m_regions.size()));
+        exit(EXIT_FAILURE);
+    }
+  }
+
+regionCategoriser::~regionCategoriser() {}
+
+
+void regionCategoriser::setCutflowHistograms(TFile& outputFile){
+    /* Number of events in each region, for every selection
+         "<selection>_regions"            event weights
+         "<selection>_regions_unweighted" no event weights -> raw event numbers
+    */
+    outputFile.cd();
+    m_cutflow.clear();
+    m_cutflow_unw.clear();
+
+    unsigned int nRegions = m_regions.size();
+    for (const auto& sel : m_selections){
+        TH1D* cutflow     = new TH1D( (sel+"_regions").c_str(), (sel+"_regions").c_str(), nRegions,0,nRegions );
+        TH1D* cutflow_unw = new TH1D( (sel+"_regions_unweighted").c_str(), (sel+"_regions_unweighted").c_str(), nRegions,0,nRegions );
+
+        for (unsigned int r=0; r<nRegions; r++){
+            cutflow->GetXaxis()->SetBinLabel(r+1,m_regions.at(r).c_str());
+            cutflow_unw->GetXaxis()->SetBinLabel(r+1,m_regions.at(r).c_str());
+        }
+
+        m_cutflow.push_back( cutflow );
+        m_cutflow_unw.push_back( cutflow_unw );
+    }
+
+    return;
+}
+
+
+int regionCategoriser::execute(const Event& event, const unsigned int evtsel_decisions){
+    /* Find the region of this event & fill the region cutflow of each selection it passed */
+    unsigned int nBtags(event.btag_jets().size());
+    unsigned int nToptags(0);
+    for (const auto& ljet : event.ljets()){
+        if (ljet.isTopTagged) nToptags++;
+    }
+
+    m_region = (m_maxTags+1)*std::min(nBtags,m_maxTags) + std::min(nToptags,m_maxTags);
+
+    double weight = event.nominal_weight();
+    for (unsigned int ss=0, size=m_cutflow.size(); ss<size; ss++){
+        if (!((evtsel_decisions >> ss) & 1)) continue;
+        m_cutflow.at(ss)->Fill(m_region+0.5, weight);
+        m_cutflow_unw.at(ss)->Fill(m_region+0.5);
+    }
+
+    return m_region;
+}
+
+// THE END
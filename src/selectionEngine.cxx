@@ -0,0 +1,331 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Evaluate all event selections together.
+
+Every 'QUANTITY COMPARISON VALUE' in the cuts files is a node (predicate)
+in a graph shared by all selections: the physics objects are copied from
+the Event, and each predicate is evaluated, at most once per event no matter
+how many selections use it (e.g., FILTERS, N_LEP, N_AK4 in ejets & mujets).
+The Event only decodes the filters & triggers in Event::execute(); its
+physics objects are built the first time a predicate (or the cutflow
+weight) needs them, so events rejected by FILTERS or TRIGGER skip them.
+
+The result for an event is a bitmask: bit 'ss' is set if selection 'ss'
+(the order in the configuration) passed.
+*/
+#include "Analysis/CyMiniAna/interface/selectionEngine.h"
+
+
+selectionEngine::selectionEngine(configuration &cmaConfig) :
+  m_config(&cmaConfig),
+  m_timePredicates(false),
+  m_event(nullptr),
+  m_loadedLeptons(false),
+  m_loadedJets(false),
+  m_loadedLjets(false),
+  m_loadedKinematics(false),
+  m_loadedTriggers(false),
+  m_loadedFilters(false),
+  m_ht(0),
+  m_st(0),
+  m_NLeptons(0),
+  m_NElectrons(0),
+  m_NMuons(0),
+  m_NJets(0),
+  m_NLjets(0),
+  m_Nbtags(0){
+    m_selections.clear();
+    m_predicates.clear();
+    m_predicateState.clear();
+    m_predicateTime.clear();
+  }
+
+selectionEngine::~selectionEngine() {}
+
+
+void selectionEngine::initialize(const std::vector<std::string>& selections, const std::vector<std::string>& cutsfiles){
+    /* Build the event selections and the shared predicates from their cuts files */
+    if (selections.size()>32){
+        cma::ERROR("SELECTIONENGINE : At most 32 selections can be run together ("+std::to_string(selections.size())+" requested)");
+        exit(EXIT_FAILURE);
+    }
+
+    m_ejetsTriggers  = m_config->ejetsTriggers();
+    m_mujetsTriggers = m_config->mujetsTriggers();
+
+    m_selections.clear();
+    for (unsigned int ss=0, size=selections.size(); ss<size; ss++) {
+        eventSelection evtSel_tmp( *m_config );
+        evtSel_tmp.setEngine( this );
+        evtSel_tmp.initialize( selections.at(ss), cutsfiles.at(ss) );
+
+        m_selections.push_back(evtSel_tmp);
+    }
+
+    m_predicateState.assign( m_predicates.size(), 0 );
+    m_predicateTime.assign( m_predicates.size(), 0. );
+    cma::INFO("SELECTIONENGINE : "+std::to_string(m_selections.size())+" selections use "+std::to_string(m_predicates.size())+" predicates");
+
+    return;
+}
+
+
+void selectionEngine::setCutflowHistograms(TFile& outputFile){
+    /* Setup the cutflow histograms of each selection */
+    for (auto& sel : m_selections)
+        sel.setCutflowHistograms( outputFile );
+
+    return;
+}
+
+
+void selectionEngine::setNumberOfShards(const unsigned int nShards){
+    /* One copy of the cutflows per thread filling them -- see histShards */
+    for (auto& sel : m_selections)
+        sel.setNumberOfShards( nShards );
+
+    return;
+}
+
+
+void selectionEngine::finalizeCutflowHistograms(TFile& outputFile){
+    /* Make the cutflow histograms of each selection in the output file */
+    for (auto& sel : m_selections)
+        sel.finalizeCutflowHistograms( outputFile );
+
+    return;
+}
+
+
+unsigned int selectionEngine::execute(Event& event){
+    /* Apply all selections to the event */
+    m_event = &event;
+    clearEvent();
+
+    unsigned int decisions(0);
+    for (unsigned int ss=0, size=m_selections.size(); ss<size; ss++){
+        if (m_selections.at(ss).applySelection(event))
+            decisions |= (1u << ss);
+    }
+
+    return decisions;
+}
+
+
+void selectionEngine::finalize(){
+    /* Clean-up */
+    for (auto& sel : m_selections)
+        sel.finalize();
+    m_selections.clear();
+
+    return;
+}
+
+
+int selectionEngine::addPredicate(const std::string& quantity, const std::string& comparison, const float value){
+    /* Index of the predicate (added if it doesn't exist yet); -1 if the quantity or comparison is unknown */
+    if (m_mapOfQuantities.find(quantity)==m_mapOfQuantities.end() ||
+        m_mapOfComparisons.find(comparison)==m_mapOfComparisons.end())
+        return -1;
+
+    Predicate pred;
+    pred.quantity   = m_mapOfQuantities.at(quantity);
+    pred.comparison = m_mapOfComparisons.at(comparison);
+    pred.value      = value;
+
+    for (unsigned int p=0, size=m_predicates.size(); p<size; p++){
+        const Predicate& x = m_predicates.at(p);
+        if (x.quantity==pred.quantity && x.comparison==pred.comparison && x.value==pred.value)
+            return p;
+    }
+
+    m_predicates.push_back( pred );
+    m_predicateState.push_back( 0 );
+    m_predicateTime.push_back( 0. );
+
+    return m_predicates.size()-1;
+}
+
+
+bool selectionEngine::predicate(const unsigned int index){
+    /* Result of a predicate for this event (evaluated the first time it is needed) */
+    char& state = m_predicateState.at(index);
+    if (state==0){
+        const Predicate& pred = m_predicates.at(index);
+        if (m_timePredicates){
+            auto start = std::chrono::steady_clock::now();
+            state = compare( quantity(pred.quantity), pred.comparison, pred.value ) ? 1 : 2;
+            auto stop  = std::chrono::steady_clock::now();
+            m_predicateTime.at(index) = std::chrono::duration<double,std::nano>(stop-start).count();
+        }
+        else
+            state = compare( quantity(pred.quantity), pred.comparison, pred.value ) ? 1 : 2;
+    }
+
+    return (state==1);
+}
+
+
+float selectionEngine::weight(){
+    /* Nominal weight of this event (the b-tagging weight builds the objects) */
+    m_event->buildWeights();
+    return m_event->nominal_weight();
+}
+
+
+void selectionEngine::clearEvent(){
+    /* New event: forget the predicates & physics objects of the previous event */
+    std::fill( m_predicateState.begin(), m_predicateState.end(), 0 );
+    std::fill( m_predicateTime.begin(), m_predicateTime.end(), 0. );
+
+    m_loadedLeptons  = false;
+    m_loadedJets     = false;
+    m_loadedLjets    = false;
+    m_loadedKinematics = false;
+    m_loadedTriggers = false;
+    m_loadedFilters  = false;
+    return;
+}
+
+
+void selectionEngine::loadObjects(const unsigned int index){
+    /* Copy the physics objects needed for a quantity from the event
+       (the filters & triggers are decoded for every event, the rest is built here) */
+    if (index!=kFilters && index!=kTrigger)
+        m_event->buildObjects();
+
+    switch (index){
+      case kNLeptons:
+      case kNElectrons:
+      case kNMuons:
+        if (m_loadedLeptons) break;
+        m_leptons    = m_event->leptons();
+        m_NLeptons   = m_leptons.size();
+        m_NMuons     = 0;
+        m_NElectrons = 0;
+        for (const auto& x : m_leptons){
+            if (x.isMuon) m_NMuons++;
+            else m_NElectrons++;
+        }
+        m_loadedLeptons = true;
+        break;
+      case kNJets:
+      case kNBtags:
+        if (m_loadedJets) break;
+        m_NJets  = m_event->jets().size();
+        m_Nbtags = m_event->btag_jets().size();
+        m_loadedJets = true;
+        break;
+      case kNLjets:
+        if (m_loadedLjets) break;
+        m_NLjets = m_event->ljets().size();
+        m_loadedLjets = true;
+        break;
+      case kMET:
+      case kHT:
+      case kST:
+        if (m_loadedKinematics) break;
+        m_met = m_event->met();
+        m_ht  = m_event->HT();
+        m_st  = m_event->ST();
+        m_loadedKinematics = true;
+        break;
+    }
+
+    if (index==kTrigger && !m_loadedTriggers){
+        m_triggers = m_event->triggers();
+        m_loadedTriggers = true;
+    }
+    else if (index==kFilters && !m_loadedFilters){
+        m_filters = m_event->filters();
+        m_loadedFilters = true;
+    }
+
+    return;
+}
+
+
+double selectionEngine::quantity(const unsigned int index){
+    /* Value of a quantity used in the cuts file (only calculated when a cut needs it) */
+    double value(0.);
+    loadObjects(index);
+
+    switch (index){
+      case kNLeptons:   value = m_NLeptons;   break;
+      case kNElectrons: value = m_NElectrons; break;
+      case kNMuons:     value = m_NMuons;     break;
+      case kNJets:      value = m_NJets;      break;
+      case kNLjets:     value = m_NLjets;     break;
+      case kNBtags:     value = m_Nbtags;     break;
+      case kMET:        value = m_met.p4.Pt(); break;
+      case kHT:         value = m_ht; break;
+      case kST:         value = m_st; break;
+      case kTrigger:{
+        // number of triggers that fired for the flavor of the leading lepton (both flavors if no lepton)
+        unsigned int nElectronTriggers(0);
+        unsigned int nMuonTriggers(0);
+        for (const auto& trig : m_ejetsTriggers){
+            if (m_triggers.find(trig)!=m_triggers.end() && m_triggers.at(trig)) nElectronTriggers++;
+        }
+        for (const auto& trig : m_mujetsTriggers){
+            if (m_triggers.find(trig)!=m_triggers.end() && m_triggers.at(trig)) nMuonTriggers++;
+        }
+        if (nElectronTriggers+nMuonTriggers<1) break;   // no trigger fired: the leptons aren't needed
+
+        loadObjects(kNLeptons);
+        bool electron = (m_NLeptons<1 || m_leptons.at(0).isElectron);
+        bool muon     = (m_NLeptons<1 || m_leptons.at(0).isMuon);
+        if (electron) value += nElectronTriggers;
+        if (muon)     value += nMuonTriggers;
+        break;
+      }
+      case kFilters:{
+        // 1 if all filters pass (only necessary for data), 0 otherwise
+        value = 1.;
+        if (!m_config->isMC()){
+            for (const auto& x : m_filters){
+                if (!x.second){
+                    value = 0.;
+                    break;
+                }
+            }
+        }
+        break;
+      }
+    }
+
+    return value;
+}
+
+
+bool selectionEngine::compare(const double quantity, const unsigned int comparison, const float value) const{
+    /* Compare the event quantity with the value from the cuts file */
+    bool pass(false);
+
+    switch (comparison){
+      case kLessThan:       pass = (quantity <  value); break;
+      case kLessEqual:      pass = (quantity <= value); break;
+      case kGreaterThan:    pass = (quantity >  value); break;
+      case kGreaterEqual:   pass = (quantity >= value); break;
+      case kEqual:          pass = (quantity == value); break;
+      case kNotEqual:       pass = (quantity != value); break;
+    }
+
+    return pass;
+}
+
+
+unsigned int selectionEngine::definitionsVersion(){
+    /* Version of the quantity definitions (used to invalidate cached selection results)
+       Increment this when a change in this file modifies the value of a quantity */
+    return 1;
+}
+
+// THE END
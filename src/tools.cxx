@@ -91,6 +91,36 @@ void split(const std::string &s, char delim, std::vector<std::string> &elems) {
 }
 
 
+bool wildcardMatch( const std::string& pattern, const std::string& name ){
+    /* Match name to pattern, e.g., 'AK8subjet*' or 'HLT_Mu??' 
+       - Greedy matching with backtracking on the last '*'
+    */
+    std::size_t p(0), n(0);
+    std::size_t star(std::string::npos), mark(0);
+
+    while (n<name.size()){
+        if (p<pattern.size() && (pattern[p]=='?' || pattern[p]==name[n])){
+            p++;
+            n++;
+        }
+        else if (p<pattern.size() && pattern[p]=='*'){
+            star = p++;
+            mark = n;
+        }
+        else if (star!=std::string::npos){
+            p = star+1;
+            n = ++mark;
+        }
+        else
+            return false;
+    }
+
+    while (p<pattern.size() && pattern[p]=='*') p++;
+
+    return (p==pattern.size());
+}
+
+
 void getListOfBranches( TTree* tree, std::vector<std::string>& treeBranches ){
     /* Find the list of branches in the TTree */
     treeBranches.clear();
@@ -208,6 +238,59 @@ bool str2bool( const std::string value ){
 }
 
 
+bool str2number( const std::string& value, int& number ){
+    /* Turn string into integer (std::stoi throws on invalid input) */
+    std::size_t pos(0);
+    try{
+        number = std::stoi(value,&pos);
+    }
+    catch(const std::exception&){
+        return false;
+    }
+
+    return pos==value.size();
+}
+
+bool str2number( const std::string& value, long long& number ){
+    /* Turn string into (long) integer */
+    std::size_t pos(0);
+    try{
+        number = std::stoll(value,&pos);
+    }
+    catch(const std::exception&){
+        return false;
+    }
+
+    return pos==value.size();
+}
+
+bool str2number( const std::string& value, float& number ){
+    /* Turn string into float */
+    std::size_t pos(0);
+    try{
+        number = std::stof(value,&pos);
+    }
+    catch(const std::exception&){
+        return false;
+    }
+
+    return pos==value.size();
+}
+
+bool str2number( const std::string& value, double& number ){
+    /* Turn string into double */
+    std::size_t pos(0);
+    try{
+        number = std::stod(value,&pos);
+    }
+    catch(const std::exception&){
+        return false;
+    }
+
+    return pos==value.size();
+}
+
+
 std::string vectorToStr( const std::vector<std::string> &vec ){
     std::string str_list;
     for( const std::string &str : vec)
@@ -15,21 +15,30 @@ Match reconstructed objects to truth objects
 
 
 truthMatching::truthMatching(configuration &cmaConfig) : 
-  m_config(&cmaConfig){
+  m_config(&cmaConfig),
+  m_truth_partons(nullptr),
+  m_truth_jets(nullptr),
+  m_partonGrid(0.8),
+  m_truthJetGrid(0.4),
+  m_partonGridBuilt(false){
   }
 
 truthMatching::~truthMatching() {}
 
 void truthMatching::initialize(){
     m_truth_tops.clear();
-    m_truth_partons.clear();
+    m_truth_partons = nullptr;
+    m_truth_jets    = nullptr;
+    m_partonGridBuilt = false;
+    m_graph.clear();
     return;
 }
 
 
-void truthMatching::setTruthPartons(const std::vector<Parton> truth_partons){
-    /* Set truth partons */
-    m_truth_partons = truth_partons;
+void truthMatching::setTruthPartons(const std::vector<Parton>& truth_partons){
+    /* Set truth partons (owned by the Event) */
+    m_truth_partons   = &truth_partons;
+    m_partonGridBuilt = false;
     return;
 }
 
@@ -41,44 +50,109 @@ void truthMatching::setTruthTops(const std::vector<TruthTop> truth_tops){
 }
 
 
-void truthMatching::buildWprimeSystem(){
-    /* Build the truth-level wprime system */
-    m_truth_wp = {};
+void truthMatching::setTruthJets(const std::vector<Jet>& truth_jets){
+    /* Set truth jets (owned by the Event) and put them in the (eta,phi) grid */
+    m_truth_jets = &truth_jets;
+    m_truthJetGrid.build( truth_jets );
+    return;
+}
 
-    for (const auto& p : m_truth_partons){
-        if (p.isWprime && p.child0_idx>=0 && p.child1_idx>=0){
-            m_truth_wp.wprime = p;
 
-            Parton child0 = m_truth_partons.at( p.child0_idx );
-            Parton child1 = m_truth_partons.at( p.child1_idx );
+void truthMatching::buildDecayGraph(const std::vector<int>& pdgId, const std::vector<int>& parent_idx,
+                                    const std::vector<int>& child0_idx, const std::vector<int>& child1_idx){
+    /* Index the truth record once per event: parent/child arrays and the decays used in the analysis
+       (W' -> VLQ+q, VLQ -> boson+q, W -> l nu) so that they can be found without looping over partons
+    */
+    m_graph.clear();
+
+    int nParticles = pdgId.size();
+    m_graph.absPdgId.resize(nParticles);
+    m_graph.parent.resize(nParticles);
+    m_graph.child0.resize(nParticles);
+    m_graph.child1.resize(nParticles);
+
+    for (int i=0; i<nParticles; i++){
+        m_graph.absPdgId[i] = std::abs(pdgId[i]);
+        m_graph.parent[i] = (parent_idx[i]<nParticles) ? parent_idx[i] : -1;
+        m_graph.child0[i] = (child0_idx[i]<nParticles) ? child0_idx[i] : -1;
+        m_graph.child1[i] = (child1_idx[i]<nParticles) ? child1_idx[i] : -1;
+    }
 
-            if (child0.isVLQ && child1.isQuark){
-                m_truth_wp.vlq   = child0;
-                m_truth_wp.quark = child1;
+    const std::vector<int>& id = m_graph.absPdgId;
+    auto isVLQ    = [&id](int i){ return id[i]==8000001 || id[i]==7000001; };
+    auto isQuark  = [&id](int i){ return id[i]<7; };
+    auto isBoson  = [&id](int i){ return id[i]==24 || id[i]==23 || id[i]==25; };
+    auto isNeutrino = [&id](int i){ return id[i]==12 || id[i]==14 || id[i]==16; };
+
+    int neutrino(-1);
+    int leptonicW(-1);
+    for (int i=0; i<nParticles; i++){
+        int c0 = m_graph.child0[i];
+        int c1 = m_graph.child1[i];
+        if (c0<0 || c1<0) continue;
+
+        if (id[i]==9900213){
+            m_graph.wprime = i;
+            if (isVLQ(c0) && isQuark(c1)){
+                m_graph.vlq = c0;
+                m_graph.wprime_quark = c1;
             }
-            else if (child1.isVLQ && child0.isQuark){
-                m_truth_wp.vlq   = child1;
-                m_truth_wp.quark = child0;
+            else if (isVLQ(c1) && isQuark(c0)){
+                m_graph.vlq = c1;
+                m_graph.wprime_quark = c0;
             }
-        } // end Wprime with 2 children
-        else if (p.isVLQ && p.child0_idx>=0 && p.child1_idx>=0) {
-            Parton child0 = m_truth_partons.at( p.child0_idx );
-            Parton child1 = m_truth_partons.at( p.child1_idx );
-
-            m_truth_wp.vlq_boson = (child0.isW || child0.isZ || child0.isHiggs) ? child0 : child1;
-            m_truth_wp.vlq_quark = (child0.isQuark) ? child0 : child1;
         }
-        else if (p.isW && p.child0_idx>=0 && p.child1_idx>=0) {
-            Parton child0 = m_truth_partons.at( p.child0_idx );
-            Parton child1 = m_truth_partons.at( p.child1_idx );
+        else if (isVLQ(i)){
+            m_graph.vlq_boson = isBoson(c0) ? c0 : c1;
+            m_graph.vlq_quark = isQuark(c0) ? c0 : c1;
+        }
+        else if (id[i]==24){
+            m_graph.wBosons.push_back(i);
+            if (isNeutrino(c0) || isNeutrino(c1)){
+                m_graph.nLeptonicW++;
+                leptonicW = i;
+                neutrino  = isNeutrino(c0) ? c0 : c1;
+            }
+        }
+    } // end loop over truth record
+
+    if (m_graph.nLeptonicW==1){
+        m_graph.leptonicW = leptonicW;
+        m_graph.neutrino  = neutrino;
+    }
+
+    return;
+}
+
 
-            m_truth_wp.isLeptonic = (child0.isNeutrino || child0.isLepton);
-            m_truth_wp.isHadronic = (child0.isQuark && child1.isQuark);
+void truthMatching::buildWprimeSystem(){
+    /* Build the truth-level wprime system from the decay graph */
+    m_truth_wp = {};
+    if (!m_truth_partons) return;
 
-            m_truth_wp.BosonChildren.push_back( child0 );
-            m_truth_wp.BosonChildren.push_back( child1 );
+    if (m_graph.wprime>=0){
+        m_truth_wp.wprime = m_truth_partons->at( m_graph.wprime );
+        if (m_graph.vlq>=0){
+            m_truth_wp.vlq   = m_truth_partons->at( m_graph.vlq );
+            m_truth_wp.quark = m_truth_partons->at( m_graph.wprime_quark );
         }
-    } // end loop over truth partons
+    }
+
+    if (m_graph.vlq_boson>=0){
+        m_truth_wp.vlq_boson = m_truth_partons->at( m_graph.vlq_boson );
+        m_truth_wp.vlq_quark = m_truth_partons->at( m_graph.vlq_quark );
+    }
+
+    for (const auto& w : m_graph.wBosons){
+        const Parton& child0 = m_truth_partons->at( m_graph.child0[w] );
+        const Parton& child1 = m_truth_partons->at( m_graph.child1[w] );
+
+        m_truth_wp.isLeptonic = (child0.isNeutrino || child0.isLepton);
+        m_truth_wp.isHadronic = (child0.isQuark && child1.isQuark);
+
+        m_truth_wp.BosonChildren.push_back( child0 );
+        m_truth_wp.BosonChildren.push_back( child1 );
+    }
 
     return;
 }
@@ -90,18 +164,29 @@ void truthMatching::matchJetToTruthTop(Jet& jet){
     jet.matchId     = -1;
     jet.containment = 0;         // initialize containment
     jet.truth_partons.clear();
+    if (!m_truth_partons || m_truth_tops.empty()) return;
+
+    // partons that can be within the jet radius (the DeltaR is checked in parton_match)
+    if (!m_partonGridBuilt){
+        m_partonGrid.build( *m_truth_partons );
+        m_partonGridBuilt = true;
+    }
+    m_partonGrid.candidates( jet.p4, jet.radius, m_candidates );
+    if (m_candidates.empty()) return;
+
+    auto nearby = [this](const int index){ return std::binary_search(m_candidates.begin(), m_candidates.end(), index); };
 
     for (unsigned int t_idx=0, size=m_truth_tops.size(); t_idx<size; t_idx++){
         auto truthtop = m_truth_tops.at(t_idx);
         if (!truthtop.isHadronic) continue;         // only want hadronically-decaying tops
 
-        Parton bottomQ = m_truth_partons.at( truthtop.bottom );
-        Parton wdecay1 = m_truth_partons.at( truthtop.Wdecays.at(0) );
-        Parton wdecay2 = m_truth_partons.at( truthtop.Wdecays.at(1) );
+        const Parton& bottomQ = m_truth_partons->at( truthtop.bottom );
+        const Parton& wdecay1 = m_truth_partons->at( truthtop.Wdecays.at(0) );
+        const Parton& wdecay2 = m_truth_partons->at( truthtop.Wdecays.at(1) );
 
-        parton_match(bottomQ,jet);
-        parton_match(wdecay1,jet);
-        parton_match(wdecay2,jet);
+        if (nearby(truthtop.bottom))        parton_match(bottomQ,jet);
+        if (nearby(truthtop.Wdecays.at(0))) parton_match(wdecay1,jet);
+        if (nearby(truthtop.Wdecays.at(1))) parton_match(wdecay2,jet);
 
         // if the jet is matched to a truth top, exit
         if (jet.containment!=0){
@@ -138,17 +223,20 @@ void truthMatching::parton_match(const Parton& p, Jet& r, double dR){
 }
 
 
-void truthMatching::matchJetToTruthJet(Jet& jet, const std::vector<Jet>& truth_jets){
-    /* Match reco jet to truth jet */
+void truthMatching::matchJetToTruthJet(Jet& jet){
+    /* Match reco jet to truth jet (closest truth jet within the jet radius, see setTruthJets) */
+    if (!m_truth_jets) return;
     float truthDR( jet.radius );
 
-    for (const auto& truth_jet : truth_jets){
+    m_truthJetGrid.candidates( jet.p4, jet.radius, m_candidates );
+    for (const auto& c : m_candidates){
+        const Jet& truth_jet = m_truth_jets->at(c);
         float thisDR = truth_jet.p4.DeltaR( jet.p4 );
         if ( thisDR < truthDR ){
             jet.truth_jet = truth_jet.index;
             truthDR = thisDR;
         }
-    } // end loop over truth jets
+    } // end loop over truth jets near this jet
 
     return;
 }
@@ -13,7 +13,12 @@ Tool for performing reconstruction of Wprime->qQ system
 #include "Analysis/CyMiniAna/interface/wprimeReco.h"
 
 WprimeReco::WprimeReco( configuration& cmaConfig ) :
-  m_config(&cmaConfig){}
+  m_config(&cmaConfig),
+  m_maxJets(0),
+  m_maxAsymmetry(1.0){
+    m_maxJets      = m_config->wprimeRecoMaxJets();
+    m_maxAsymmetry = m_config->wprimeRecoMaxAsymmetry();
+  }
 
 WprimeReco::~WprimeReco() {}
 
@@ -47,6 +52,16 @@ void WprimeReco::setJets(std::vector<Jet>& jets){
 void WprimeReco::setNeutrino(Neutrino& nu){
     /* Set the neutrino (easily test different methods without passing this repeatedly) */
     m_neutrino = nu;
+    m_neutrinos.clear();
+    m_neutrinos.push_back(nu);
+    return;
+}
+
+
+void WprimeReco::setNeutrinos(const std::vector<Neutrino>& neutrinos){
+    /* Set several neutrino solutions -- each one is a hypothesis in the combinatorics */
+    m_neutrinos = neutrinos;
+    if (!m_neutrinos.empty()) m_neutrino = m_neutrinos.at(0);
     return;
 }
 
@@ -57,8 +72,17 @@ Wprime WprimeReco::execute(){
          In W'->bT->bbW->bblv, expect that the b energy and T energy are similar.
          Furthermore, the mass of the reconstructed Wprime should be greater than
            the mass of the reconstructed VLQ.
+       With wprimeRecoMaxJets>0 all jet assignments of the leading jets are considered (combinatorics())
     */
     m_wprime = {};
+    m_candidates.clear();
+
+    if (m_maxJets>0){
+        combinatorics();
+        if (!m_candidates.empty()) m_wprime = m_candidates.front();
+        return m_wprime;
+    }
+
     unsigned int nbtags = m_btag_jets.size();
 
     if (nbtags>=2){
@@ -114,6 +138,8 @@ void WprimeReco::getWprime( const Jet& j0, const Jet& j1 ){
     Wprime0.p4  = j0.p4 + VLQ0.p4;
     Wprime0.vlq = VLQ0;
     Wprime0.jet = j0;
+    Wprime0.vlq_jet  = j1.index;
+    Wprime0.neutrino = 0;
     Wprime0.A_energy = (VLQ0.p4.Pt() - j0.p4.Pt()) / (VLQ0.p4.Pt() + j0.p4.Pt());
     bool massComp0   = (Wprime0.p4.M() > VLQ0.p4.M());
 
@@ -122,6 +148,8 @@ void WprimeReco::getWprime( const Jet& j0, const Jet& j1 ){
     Wprime1.p4  = j1.p4 + VLQ1.p4;
     Wprime1.vlq = VLQ1;
     Wprime1.jet = j1;
+    Wprime1.vlq_jet  = j0.index;
+    Wprime1.neutrino = 0;
     Wprime1.A_energy = (VLQ1.p4.Pt() - j1.p4.Pt()) / (VLQ1.p4.Pt() + j1.p4.Pt());
     bool massComp1   = (Wprime1.p4.M() > VLQ1.p4.M());
 
@@ -139,4 +167,86 @@ void WprimeReco::getWprime( const Jet& j0, const Jet& j1 ){
 }
 
 
+void WprimeReco::combinatorics(){
+    /* Consider every hypothesis W'->bT, T->bW->blv of the leading m_maxJets jets:
+         - b from W' & b from VLQ: any 2 jets, at least one of them b-tagged
+         - every neutrino solution
+       Pruning: |A_energy| <= m_maxAsymmetry -- for each VLQ, only the W' jets in a pT window
+       (binary search) are considered.
+       M(W') > M(VLQ) is required as in getWprime; for physical four-vectors it always holds
+       (M(W')^2 - M(VLQ)^2 = m(b)^2 + 2 p(b).p(VLQ) >= 0), so it only removes unphysical jets.
+       The candidates are ranked by |A_energy| (the b and T energies should be similar)
+    */
+    if (m_btag_jets.empty() || m_neutrinos.empty()){
+        cma::DEBUG("WPRIMERECO : Not enough b-tags");
+        return;
+    }
+
+    // leading jets in ascending pT (for the pT window)
+    unsigned int nJets = std::min( (unsigned int)m_jets.size(), m_maxJets );
+    std::vector<unsigned int> jets(m_jets.size());
+    for (unsigned int i=0,size=m_jets.size(); i<size; i++) jets[i] = i;
+    std::partial_sort( jets.begin(), jets.begin()+nJets, jets.end(),
+                       [this](unsigned int a, unsigned int b){ return m_jets[a].p4.Pt() > m_jets[b].p4.Pt(); } );
+    jets.resize(nJets);
+    std::reverse( jets.begin(), jets.end() );
+
+    std::vector<double> pts(nJets);
+    std::vector<bool> isBtagged(nJets,false);
+    for (unsigned int i=0; i<nJets; i++){
+        pts[i] = m_jets[jets[i]].p4.Pt();
+        isBtagged[i] = std::find( m_btag_jets.begin(), m_btag_jets.end(), int(jets[i]) ) != m_btag_jets.end();
+    }
+
+    // |A| <= a  <=>  pT(VLQ)*(1-a)/(1+a) <= pT(b) <= pT(VLQ)*(1+a)/(1-a)
+    double a  = std::abs(m_maxAsymmetry);
+    double lo = (a<1) ? (1-a)/(1+a) : 0.;
+    double hi = (a<1) ? (1+a)/(1-a) : 0.;
+    const double tolerance(1e-6);        // the window is only a pre-selection
+
+    for (unsigned int n=0,nNu=m_neutrinos.size(); n<nNu; n++){
+        TLorentzVector lepnu = m_lepton.p4 + m_neutrinos[n].p4;
+
+        for (unsigned int v=0; v<nJets; v++){                   // b from the VLQ
+            const Jet& vlq_jet = m_jets[jets[v]];
+            TLorentzVector vlq = vlq_jet.p4 + lepnu;
+            double vlq_pt = vlq.Pt();
+
+            unsigned int first(0);
+            unsigned int last(nJets);
+            if (a<1){
+                first = std::lower_bound( pts.begin(), pts.end(), vlq_pt*lo*(1-tolerance) ) - pts.begin();
+                last  = std::upper_bound( pts.begin(), pts.end(), vlq_pt*hi*(1+tolerance) ) - pts.begin();
+            }
+
+            for (unsigned int w=first; w<last; w++){            // b from the W'
+                if (w==v || !(isBtagged[w] || isBtagged[v])) continue;
+
+                const Jet& wp_jet = m_jets[jets[w]];
+                float A_energy = (vlq_pt - pts[w]) / (vlq_pt + pts[w]);
+                if (std::abs(A_energy) > a) continue;
+
+                Wprime wprime;
+                wprime.p4  = wp_jet.p4 + vlq;
+                wprime.vlq.p4   = vlq;
+                wprime.jet      = wp_jet;
+                wprime.vlq_jet  = vlq_jet.index;
+                wprime.neutrino = n;
+                wprime.A_energy = A_energy;
+                if (wprime.p4.M() <= vlq.M()) continue;
+
+                m_candidates.push_back( wprime );
+            } // end loop over jets from the W'
+        } // end loop over jets from the VLQ
+    } // end loop over neutrino solutions
+
+    std::stable_sort( m_candidates.begin(), m_candidates.end(),
+                      [](const Wprime& x, const Wprime& y){ return std::abs(x.A_energy) < std::abs(y.A_energy); } );
+
+    cma::DEBUG("WPRIMERECO : "+std::to_string(m_candidates.size())+" W' candidates");
+
+    return;
+}
+
+
 // THE END //
@@ -0,0 +1,58 @@
+#!/bin/bash
+#
+# Created:        19 October 2026
+# Last Updated:   19 October 2026
+#
+# Dan Marley
+# daniel.edison.marley@cernSPAMNOT.ch
+# Texas A&M University
+# -----
+#
+# Peak memory (RSS) of one job with & without the sparse histogram storage
+# ('sparseHistogramBins' 0 = all histograms dense, default 100000).
+# Both jobs use the same configuration, files, and number of events.
+#
+#   test/peakRSS.sh <configuration> <list of files> [NEvents]
+#   e.g., test/peakRSS.sh config/cmaConfig.txt config/listOfOneFile.txt 10000
+#
+# (run after 'source setup.sh' so 'run' is in the PATH)
+
+if [ $# -lt 2 ]; then
+    echo " Usage: $0 <configuration> <list of files> [NEvents]"
+    exit 1
+fi
+
+config=$1
+filelist=$2
+nevents=${3:--1}
+workdir=$(mktemp -d peakRSS_XXXX)
+
+echo " peakRSS : configuration ${config}, files ${filelist}, NEvents ${nevents}"
+printf "   %-20s %12s %12s\n" "sparseHistogramBins" "RSS (log)" "RSS (time)"
+
+for sparse in 0 100000; do
+    # same configuration, only the options of this benchmark are replaced
+    cfg=${workdir}/cmaConfig_sparse${sparse}.txt
+    mkdir -p ${workdir}/sparse${sparse}
+    sed -e "/^sparseHistogramBins /d" -e "/^inputfile /d" -e "/^NEvents /d" -e "/^output_path /d" ${config} > ${cfg}
+    echo "sparseHistogramBins ${sparse}"        >> ${cfg}
+    echo "inputfile ${filelist}"                >> ${cfg}
+    echo "NEvents ${nevents}"                   >> ${cfg}
+    echo "output_path ${workdir}/sparse${sparse}/" >> ${cfg}
+
+    log=${workdir}/sparse${sparse}.log
+    if [ -x /usr/bin/time ]; then
+        /usr/bin/time -v run ${cfg} > ${log} 2>&1
+        rssTime=$(grep "Maximum resident set size" ${log} | awk '{print int($NF/1024)" MB"}')
+    else
+        run ${cfg} > ${log} 2>&1
+        rssTime="-"
+    fi
+    rssLog=$(grep "Peak memory (RSS)" ${log} | awk '{print $(NF-1)" MB"}')
+
+    printf "   %-20s %12s %12s\n" "${sparse}" "${rssLog:--}" "${rssTime:--}"
+done
+
+echo " peakRSS : logs & outputs in ${workdir}"
+
+# THE END
@@ -0,0 +1,247 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Benchmark of the output settings 'compressionAlgorithm', 'compressionLevel',
+'basketSize' and 'autoFlush' (config/cmaConfig.txt).
+Each setting writes the same tree to a new file and reads it back:
+prints the write time, read-back time and file size.
+
+  testCompression                              (generated tree, AK4/lepton vectors & scalars)
+  testCompression <file> <treename> [entries]  (copy of a real tree, e.g., a CyMiniAna skim)
+
+The source tree is kept in memory, so the write time is the time to fill, compress
+and write the output file (the time to read the source entries is printed separately).
+The read-back is from the file that was just written (file system cache, not a cold read).
+Fails if a file cannot be written or read back completely.
+*/
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <iostream>
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+
+
+class benchConfiguration : public configuration {
+  public:
+    // compression encoding of the configuration (no configuration file)
+    benchConfiguration() : configuration("") {}
+    int compression( const std::string& algorithm, const int level ){
+        set_compression( algorithm, level );
+        return compressionSettings();
+    }
+};
+
+
+TTree* generate( const unsigned int nEvents ){
+    /* Tree that looks like the CyMiniAna input: vectors of jets & leptons, MET, weights, triggers */
+    std::vector<float> AK4pt, AK4eta, AK4phi, AK4E, AK4bDisc;
+    std::vector<float> ELpt, ELeta, ELphi, ELE;
+    std::vector<float> MUpt, MUeta, MUphi, MUE;
+    float METpt, METphi, weight_mc, weight_pileup;
+    int HLT_Ele115, HLT_Mu50, HLT_PFHT900;
+    unsigned int runNumber, lumiBlock;
+    unsigned long long eventNumber;
+
+    gROOT->cd();       // memory resident
+    TTree* tree = new TTree("eventT","eventT");
+    tree->Branch("AK4pt",  &AK4pt);
+    tree->Branch("AK4eta", &AK4eta);
+    tree->Branch("AK4phi", &AK4phi);
+    tree->Branch("AK4E",   &AK4E);
+    tree->Branch("AK4bDisc",&AK4bDisc);
+    tree->Branch("ELpt",   &ELpt);
+    tree->Branch("ELeta",  &ELeta);
+    tree->Branch("ELphi",  &ELphi);
+    tree->Branch("ELE",    &ELE);
+    tree->Branch("MUpt",   &MUpt);
+    tree->Branch("MUeta",  &MUeta);
+    tree->Branch("MUphi",  &MUphi);
+    tree->Branch("MUE",    &MUE);
+    tree->Branch("METpt",  &METpt,  "METpt/F");
+    tree->Branch("METphi", &METphi, "METphi/F");
+    tree->Branch("weight_mc",     &weight_mc,     "weight_mc/F");
+    tree->Branch("weight_pileup", &weight_pileup, "weight_pileup/F");
+    tree->Branch("HLT_Ele115",  &HLT_Ele115,  "HLT_Ele115/I");
+    tree->Branch("HLT_Mu50",    &HLT_Mu50,    "HLT_Mu50/I");
+    tree->Branch("HLT_PFHT900", &HLT_PFHT900, "HLT_PFHT900/I");
+    tree->Branch("runNumber",   &runNumber,   "runNumber/i");
+    tree->Branch("lumiBlock",   &lumiBlock,   "lumiBlock/i");
+    tree->Branch("eventNumber", &eventNumber, "eventNumber/l");
+
+    unsigned int counter(0);
+    for (unsigned int event=0; event<nEvents; event++){
+        for (auto* v : {&AK4pt,&AK4eta,&AK4phi,&AK4E,&AK4bDisc,&ELpt,&ELeta,&ELphi,&ELE,&MUpt,&MUeta,&MUphi,&MUE})
+            v->clear();
+
+        unsigned int nJets = 2 + 9*cma::uniform(1,event);
+        for (unsigned int j=0; j<nJets; j++){
+            float pt  = 30. - 80.*std::log( 1e-6+cma::uniform(2,counter) );   // falling spectrum
+            float eta = 2.4*(2.*cma::uniform(3,counter)-1.);
+            AK4pt.push_back( pt );
+            AK4eta.push_back( eta );
+            AK4phi.push_back( M_PI*(2.*cma::uniform(4,counter)-1.) );
+            AK4E.push_back( pt*std::cosh(eta) );
+            AK4bDisc.push_back( cma::uniform(5,counter) );
+            counter++;
+        }
+
+        bool electron = (cma::uniform(6,event)<0.5);
+        float pt  = 50. - 60.*std::log( 1e-6+cma::uniform(7,event) );
+        float eta = 2.1*(2.*cma::uniform(8,event)-1.);
+        float phi = M_PI*(2.*cma::uniform(9,event)-1.);
+        auto& lepPt  = (electron) ? ELpt  : MUpt;
+        auto& lepEta = (electron) ? ELeta : MUeta;
+        auto& lepPhi = (electron) ? ELphi : MUphi;
+        auto& lepE   = (electron) ? ELE   : MUE;
+        lepPt.push_back( pt );
+        lepEta.push_back( eta );
+        lepPhi.push_back( phi );
+        lepE.push_back( pt*std::cosh(eta) );
+
+        METpt  = 20. - 50.*std::log( 1e-6+cma::uniform(10,event) );
+        METphi = M_PI*(2.*cma::uniform(11,event)-1.);
+        weight_mc     = (cma::uniform(12,event)<0.02) ? -1. : 1.;
+        weight_pileup = 1. + 0.2*cma::gaussian(13,event);
+        HLT_Ele115    = electron && cma::uniform(14,event)<0.9;
+        HLT_Mu50      = !electron && cma::uniform(14,event)<0.9;
+        HLT_PFHT900   = cma::uniform(15,event)<0.1;
+        runNumber     = 1;
+        lumiBlock     = 1 + event/1000;
+        eventNumber   = event;
+
+        tree->Fill();
+    }
+
+    tree->ResetBranchAddresses();      // the vectors go out of scope
+
+    return tree;
+}
+
+
+TTree* load( const std::string& filename, const std::string& treename, const long long nEntries ){
+    /* Memory resident copy of a tree in a file */
+    TFile* file = TFile::Open( filename.c_str() );
+    if (!file || file->IsZombie()){
+        std::cout << " testCompression : Cannot open " << filename << std::endl;
+        return nullptr;
+    }
+    TTree* input = (TTree*)file->Get( treename.c_str() );
+    if (!input){
+        std::cout << " testCompression : TTree " << treename << " does not exist in " << filename << std::endl;
+        return nullptr;
+    }
+
+    gROOT->cd();
+    TTree* tree = input->CloneTree( nEntries );
+    tree->SetDirectory(0);
+
+    return tree;
+}
+
+
+int main(int argc, char* argv[]) {
+    // -- Source tree
+    TTree* source(nullptr);
+    if (argc>2)
+        source = load( argv[1], argv[2], (argc>3) ? std::stoll(argv[3]) : -1 );
+    else
+        source = generate( 100000 );
+    if (!source) return 1;
+
+    const long long nEntries = source->GetEntries();
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long i=0; i<nEntries; i++)
+        source->GetEntry(i);
+    double sourceTime = std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count();
+
+    std::cout << " testCompression : " << nEntries << " entries, " << source->GetTotBytes()/1e6
+              << " MB uncompressed, " << sourceTime << " s to read the source" << std::endl;
+    std::printf( "   %-8s %5s %10s %10s %9s %9s %9s %7s\n",
+                 "algo","level","basketSize","autoFlush","write [s]","read [s]","size [MB]","ratio" );
+
+    // -- Settings: every algorithm & level with the default buffers, and the buffers with zstd 4
+    struct Setting {
+        std::string algorithm;
+        int level;
+        int basketSize;
+        long long autoFlush;
+    };
+    std::vector<Setting> settings = {{"default",0,0,0}};
+    for (const auto& algorithm : {"zlib","lz4","lzma","zstd"}){
+        for (const auto& level : {1,4,9})
+            settings.push_back( {algorithm,level,0,0} );
+    }
+    for (const auto& basketSize : {16000,64000,256000}){
+        for (const auto& autoFlush : {-30000000LL,1000LL,10000LL})
+            settings.push_back( {"zstd",4,basketSize,autoFlush} );
+    }
+
+    benchConfiguration config;
+    const std::string filename("testCompression.root");
+    unsigned int nFailures(0);
+
+    for (const auto& s : settings){
+        // -- Write
+        start = std::chrono::steady_clock::now();
+        int compression = config.compression( s.algorithm, s.level );
+        TFile* outputFile = (compression>=0) ? TFile::Open( filename.c_str(), "RECREATE", "", compression )
+                                             : TFile::Open( filename.c_str(), "RECREATE" );
+        if (!outputFile || outputFile->IsZombie()){
+            std::cout << " testCompression : Cannot write " << filename << std::endl;
+            return 1;
+        }
+        outputFile->cd();
+        TTree* output = source->CloneTree(0);
+        if (s.basketSize>0) output->SetBasketSize("*",s.basketSize);
+        if (s.autoFlush!=0) output->SetAutoFlush(s.autoFlush);
+        for (long long i=0; i<nEntries; i++){
+            source->GetEntry(i);
+            output->Fill();
+        }
+        outputFile->Write();
+        outputFile->Close();
+        delete outputFile;
+        double writeTime = std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count();
+
+        // -- Read back (all branches)
+        start = std::chrono::steady_clock::now();
+        TFile* inputFile = TFile::Open( filename.c_str() );
+        TTree* input = (TTree*)inputFile->Get( source->GetName() );
+        long long bytes(0);
+        long long entries = (input) ? input->GetEntries() : 0;
+        for (long long i=0; i<entries; i++)
+            bytes += input->GetEntry(i);
+        double readTime = std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count();
+        double size = inputFile->GetSize();
+        inputFile->Close();
+        delete inputFile;
+
+        if (entries!=nEntries || bytes<1) nFailures++;
+
+        std::printf( "   %-8s %5d %10d %10lld %9.2f %9.2f %9.2f %7.2f\n",
+                     s.algorithm.c_str(), s.level, s.basketSize, s.autoFlush,
+                     writeTime, readTime, size/1e6, source->GetTotBytes()/size );
+    }
+    std::remove( filename.c_str() );
+
+    std::cout << " testCompression : " << (nFailures>0 ? "FAILED" : "passed") << std::endl;
+
+    return (nFailures>0) ? 1 : 0;
+}
+
+// THE END
@@ -0,0 +1,131 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Check of etaPhiGrid:
+  within(), nearest() & candidates() give the same objects as
+  looping over all pairs with TLorentzVector::DeltaR, including
+  objects at phi = +/-pi, duplicate objects, and |eta| beyond the grid.
+*/
+#include <cmath>
+#include <vector>
+#include <iostream>
+
+#include "TLorentzVector.h"
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/etaPhiGrid.h"
+
+
+TLorentzVector vector( const double eta, const double phi ){
+    TLorentzVector p4;
+    p4.SetPtEtaPhiM( 50., eta, phi, 0. );
+    return p4;
+}
+
+
+unsigned int compare( const etaPhiGrid& grid, const std::vector<TLorentzVector>& objects,
+                      const TLorentzVector& query, const double dR ){
+    /* Number of differences between the grid & the pairwise loop for one query */
+    std::vector<int> pairwise;
+    int nearest(-1);
+    double bestDR(dR);
+    for (unsigned int i=0; i<objects.size(); i++){
+        double thisDR = query.DeltaR( objects.at(i) );
+        if (thisDR<dR) pairwise.push_back(i);
+        if (thisDR<bestDR){
+            nearest = i;
+            bestDR  = thisDR;
+        }
+    }
+
+    unsigned int nFailures(0);
+
+    std::vector<int> within;
+    grid.within( query, dR, within );
+    if (within!=pairwise) nFailures++;
+
+    if (grid.nearest( query, dR )!=nearest) nFailures++;
+
+    std::vector<int> candidates;
+    grid.candidates( query, dR, candidates );
+    for (const auto& i : pairwise){
+        if (!std::binary_search(candidates.begin(), candidates.end(), i)) nFailures++;
+    }
+
+    if (nFailures>0)
+        std::cout << " query (" << query.Eta() << "," << query.Phi() << ") dR=" << dR << ": "
+                  << within.size() << " objects within (grid) vs " << pairwise.size() << " (pairwise)" << std::endl;
+
+    return nFailures;
+}
+
+
+int main() {
+    unsigned int nFailures(0);
+    unsigned int nQueries(0);
+
+    const double maxEta(5.0);
+    std::vector<double> radii = {0.4, 0.8, 1.5};
+
+    for (const auto& radius : radii){
+        etaPhiGrid grid( radius, maxEta );
+
+        for (unsigned int event=0; event<200; event++){
+            // random objects, some beyond the grid in eta
+            std::vector<TLorentzVector> objects;
+            unsigned int nObjects = 1 + 100*cma::uniform(10,event);
+            for (unsigned int i=0; i<nObjects; i++){
+                double eta = -7. + 14.*cma::uniform(11+event,i);
+                double phi = -M_PI + 2*M_PI*cma::uniform(12+event,i);
+                objects.push_back( vector(eta,phi) );
+            }
+
+            // edge cases: phi = +/-pi, duplicates, far beyond the grid
+            objects.push_back( vector( 0.3, M_PI) );
+            objects.push_back( vector( 0.3,-M_PI) );
+            objects.push_back( vector( 0.3, M_PI-1e-9) );
+            objects.push_back( objects.front() );
+            objects.push_back( objects.front() );
+            objects.push_back( vector( maxEta, 1.0) );
+            objects.push_back( vector(-maxEta-0.1, 1.0) );
+            objects.push_back( vector( 20.0, 2.0) );
+
+            grid.build( objects );
+
+            std::vector<TLorentzVector> queries( objects );   // the objects themselves (DeltaR = 0)
+            for (unsigned int q=0; q<50; q++){
+                double eta = -7. + 14.*cma::uniform(13+event,q);
+                double phi = -M_PI + 2*M_PI*cma::uniform(14+event,q);
+                queries.push_back( vector(eta,phi) );
+            }
+            queries.push_back( vector( 0.3+0.1,-M_PI) );
+            queries.push_back( vector( 0.3-0.1, M_PI) );
+            queries.push_back( vector( maxEta+0.2, 1.0) );
+            queries.push_back( vector(-maxEta, 1.0) );
+
+            for (const auto& query : queries){
+                for (const auto& dR : {0.4, 0.8, 1.2})
+                    nFailures += compare( grid, objects, query, dR );
+                nQueries++;
+            }
+        }
+    }
+
+    // empty grid
+    etaPhiGrid empty(0.4);
+    empty.build( std::vector<TLorentzVector>() );
+    if (empty.nearest( vector(0.,0.), 0.4 )!=-1) nFailures++;
+
+    std::cout << " testEtaPhiGrid : " << nQueries << " queries, " << nFailures << " differences -- "
+              << (nFailures>0 ? "FAILED" : "passed") << std::endl;
+
+    return (nFailures>0) ? 1 : 0;
+}
+
+// THE END
@@ -0,0 +1,184 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Check of flatHist:
+  the same values filled into a flatHist & directly into a TH1D/TH2D/TH3D
+  give exactly the same histograms after flatHist::materialize()
+  (every bin with under/overflow, Sumw2, statistics (GetStats), & entries).
+Prints the time per fill of flatHist::fill & TH1::Fill.
+*/
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "TROOT.h"
+#include "TH1.h"
+#include "TH2.h"
+#include "TH3.h"
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+
+
+struct Values {
+    std::vector<double> x, y, z, w, w2;
+};
+
+
+Values generate( const unsigned int nFills ){
+    /* Values with some under/overflow (and NaN), weights with negative values */
+    Values v;
+    for (unsigned int i=0; i<nFills; i++){
+        v.x.push_back( (i%997==0) ? NAN : -10. + 120.*cma::uniform(1,i) );
+        v.y.push_back( -0.5 + 3.*cma::uniform(2,i) );
+        v.z.push_back( -4. + 8.*cma::uniform(3,i) );
+        v.w.push_back( -0.2 + 1.5*cma::uniform(4,i) );
+        v.w2.push_back( 1. + 0.1*cma::gaussian(5,i) );
+    }
+    return v;
+}
+
+
+TH1* rootHist( const std::string& name, const std::vector<flatHist::Axis>& axes ){
+    /* TH1D/TH2D/TH3D filled directly (the binnings used in this test) */
+    TH1* hist(nullptr);
+    const flatHist::Axis& x = axes.at(0);
+    if (axes.size()==1){
+        hist = (x.edges.empty()) ? new TH1D(name.c_str(),name.c_str(),x.nBins,x.min,x.max)
+                                 : new TH1D(name.c_str(),name.c_str(),x.nBins,x.edges.data());
+    }
+    else if (axes.size()==2){
+        const flatHist::Axis& y = axes.at(1);
+        hist = (y.edges.empty()) ? new TH2D(name.c_str(),name.c_str(),x.nBins,x.min,x.max,y.nBins,y.min,y.max)
+                                 : new TH2D(name.c_str(),name.c_str(),x.nBins,x.min,x.max,y.nBins,y.edges.data());
+    }
+    else{
+        const flatHist::Axis& y = axes.at(1);
+        const flatHist::Axis& z = axes.at(2);
+        hist = new TH3D(name.c_str(),name.c_str(),x.nBins,x.min,x.max,y.nBins,y.min,y.max,z.nBins,z.min,z.max);
+    }
+    hist->Sumw2();
+
+    return hist;
+}
+
+
+unsigned int compare( const std::string& name, const TH1* flat, const TH1* root, const unsigned int nCells, const unsigned int dimension ){
+    /* Number of differences (exact comparison) */
+    unsigned int nDiff(0);
+    for (unsigned int bin=0; bin<nCells; bin++){
+        if (flat->GetBinContent(bin)!=root->GetBinContent(bin) || flat->GetSumw2()->At(bin)!=root->GetSumw2()->At(bin)){
+            if (nDiff<5)
+                std::cout << "   " << name << " bin " << bin << ": " << flat->GetBinContent(bin) << " +/- " << flat->GetSumw2()->At(bin)
+                          << " (flatHist) != " << root->GetBinContent(bin) << " +/- " << root->GetSumw2()->At(bin) << " (TH1)" << std::endl;
+            nDiff++;
+        }
+    }
+
+    double statsFlat[11] = {0.};
+    double statsRoot[11] = {0.};
+    flat->GetStats(statsFlat);
+    root->GetStats(statsRoot);
+    unsigned int nStats = (dimension==1) ? 4 : (dimension==2) ? 7 : 11;
+    for (unsigned int s=0; s<nStats; s++){
+        if (statsFlat[s]!=statsRoot[s]){
+            std::cout << "   " << name << " stats[" << s << "]: " << statsFlat[s] << " (flatHist) != " << statsRoot[s] << " (TH1)" << std::endl;
+            nDiff++;
+        }
+    }
+
+    if (flat->GetEntries()!=root->GetEntries()){
+        std::cout << "   " << name << " entries: " << flat->GetEntries() << " (flatHist) != " << root->GetEntries() << " (TH1)" << std::endl;
+        nDiff++;
+    }
+
+    return nDiff;
+}
+
+
+int main() {
+    const unsigned int nFills(1000000);
+    TH1::AddDirectory(false);
+
+    Values values = generate( nFills );
+
+    struct Case {
+        std::string name;
+        std::vector<flatHist::Axis> axes;
+        unsigned int blockSize;
+    };
+    std::vector<Case> cases = {
+        {"1d",          { {50,0.,100.,{}} }, 0},
+        {"1d_variable", { {5,0.,100.,{0.,10.,25.,50.,75.,100.}} }, 0},
+        {"2d_mixed",    { {20,0.,100.,{}}, {5,0.,2.,{0.,0.2,0.5,1.,1.5,2.}} }, 0},
+        {"2d_sparse",   { {100,0.,100.,{}}, {40,0.,2.,{}} }, 64},
+        {"3d",          { {10,0.,100.,{}}, {8,0.,2.,{}}, {6,-3.,3.,{}} }, 0} };
+
+    unsigned int nFailures(0);
+    for (const auto& c : cases){
+        unsigned int dimension = c.axes.size();
+
+        // two weight variations filled together (e.g., weight systematics)
+        flatHist flat( {c.name+"_flat",c.name+"_flat_var"}, c.axes, c.blockSize );
+        TH1* root    = rootHist( c.name+"_root", c.axes );
+        TH1* rootVar = rootHist( c.name+"_root_var", c.axes );
+
+        double flatTime(0.), rootTime(0.);
+        double w[2];
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i=0; i<nFills; i++){
+            w[0] = values.w[i];
+            w[1] = values.w[i]*values.w2[i];
+            if (dimension==1)      flat.fill( values.x[i], w, 2 );
+            else if (dimension==2) flat.fill( values.x[i], values.y[i], w, 2 );
+            else                   flat.fill( values.x[i], values.y[i], values.z[i], w, 2 );
+        }
+        flatTime = std::chrono::duration<double,std::nano>( std::chrono::steady_clock::now()-start ).count();
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned int i=0; i<nFills; i++){
+            double wVar = values.w[i]*values.w2[i];
+            if (dimension==1){
+                root->Fill( values.x[i], values.w[i] );
+                rootVar->Fill( values.x[i], wVar );
+            }
+            else if (dimension==2){
+                static_cast<TH2D*>(root)->Fill( values.x[i], values.y[i], values.w[i] );
+                static_cast<TH2D*>(rootVar)->Fill( values.x[i], values.y[i], wVar );
+            }
+            else{
+                static_cast<TH3D*>(root)->Fill( values.x[i], values.y[i], values.z[i], values.w[i] );
+                static_cast<TH3D*>(rootVar)->Fill( values.x[i], values.y[i], values.z[i], wVar );
+            }
+        }
+        rootTime = std::chrono::duration<double,std::nano>( std::chrono::steady_clock::now()-start ).count();
+
+        std::vector<TH1*> hists = flat.materialize();
+        unsigned int nDiff = compare( c.name, hists.at(0), root, flat.numberOfCells(), dimension )
+                           + compare( c.name+"_var", hists.at(1), rootVar, flat.numberOfCells(), dimension );
+        if (nDiff>0) nFailures++;
+
+        std::cout << " testFlatHist : " << c.name << " " << (nDiff>0 ? "FAILED" : "identical")
+                  << ", 2 weights per fill: flatHist " << flatTime/nFills << " ns, TH1::Fill " << rootTime/nFills
+                  << " ns (x" << rootTime/flatTime << ")" << std::endl;
+
+        for (auto* h : hists) delete h;
+        delete root;
+        delete rootVar;
+    }
+
+    std::cout << " testFlatHist : " << (nFailures>0 ? "FAILED" : "passed") << std::endl;
+
+    return (nFailures>0) ? 1 : 0;
+}
+
+// THE END
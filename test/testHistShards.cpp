@@ -0,0 +1,100 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Check of histShards:
+  the same events filled into N shards (one thread per shard) & merged
+  give the same histograms as filling a single shard.
+*/
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/flatHist.h"
+#include "Analysis/CyMiniAna/interface/histShards.h"
+
+
+void fillEvents( histShards& hists, const unsigned int first, const unsigned int last ){
+    /* Fill events [first,last) into the shard of the current thread */
+    for (unsigned int e=first; e<last; e++){
+        double x = -10. + 120.*cma::uniform(1,e);       // some under/overflow
+        double y = -1.  + 4.*cma::uniform(2,e);
+        double w[2] = {0.5 + cma::uniform(3,e), 1.};
+        hists[0].fill( x, w, 2 );
+        hists[1].fill( x, y, w[0] );
+    }
+    return;
+}
+
+
+int main() {
+    const unsigned int nEvents(100000);
+    const unsigned int nWorkers(4);
+
+    std::vector<flatHist::Axis> axis1d  = { {50,0.,100.,{}} };
+    std::vector<flatHist::Axis> axis2d  = { {20,0.,100.,{}}, {5,0.,2.,{0.,0.2,0.5,1.,1.5,2.}} };
+
+    // single shard
+    histShards single;
+    single.book( {"x","x_var"}, axis1d );
+    single.book( {"xy"}, axis2d );
+    histShards::setWorker(0);
+    fillEvents( single, 0, nEvents );
+    single.merge();
+
+    // one shard per thread
+    histShards sharded;
+    sharded.book( {"x","x_var"}, axis1d );
+    sharded.book( {"xy"}, axis2d );
+    sharded.setNumberOfShards( nWorkers );
+
+    std::vector<std::thread> workers;
+    for (unsigned int t=0; t<nWorkers; t++){
+        workers.push_back( std::thread( [&sharded,t,nEvents,nWorkers](){
+            histShards::setWorker(t);
+            fillEvents( sharded, t*nEvents/nWorkers, (t+1)*nEvents/nWorkers );
+        }) );
+    }
+    for (auto& worker : workers) worker.join();
+    sharded.merge();
+
+    // compare every bin (sums in a different order: allow rounding)
+    unsigned int nFailures(0);
+    for (unsigned int h=0; h<single.size(); h++){
+        const flatHist& a = single.merged().at(h);
+        const flatHist& b = sharded.merged().at(h);
+        for (unsigned int v=0; v<a.numberOfWeights(); v++){
+            for (unsigned int bin=0; bin<a.numberOfCells(); bin++){
+                double diff  = std::abs( a.binContent(bin,v)-b.binContent(bin,v) );
+                double diff2 = std::abs( a.binError2(bin,v)-b.binError2(bin,v) );
+                if (diff>1e-9*std::abs(a.binContent(bin,v)) || diff2>1e-9*std::abs(a.binError2(bin,v))){
+                    std::cout << " histogram " << h << " variation " << v << " bin " << bin << ": "
+                              << a.binContent(bin,v) << " (1 shard) != " << b.binContent(bin,v)
+                              << " (" << nWorkers << " shards)" << std::endl;
+                    nFailures++;
+                }
+            }
+        }
+    }
+
+    // merge() empties all shards except the first
+    for (unsigned int h=0; h<sharded.size(); h++){
+        histShards::setWorker(nWorkers-1);
+        for (unsigned int bin=0; bin<sharded[h].numberOfCells(); bin++){
+            if (sharded[h].binContent(bin)!=0.) nFailures++;
+        }
+    }
+
+    std::cout << " testHistShards : " << (nFailures>0 ? "FAILED" : "passed") << std::endl;
+
+    return (nFailures>0) ? 1 : 0;
+}
+
+// THE END
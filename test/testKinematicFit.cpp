@@ -0,0 +1,121 @@
+/*
+Created:        19 October 2026
+Last Updated:   19 October 2026
+
+Dan Marley
+daniel.edison.marley@cernSPAMNOT.ch
+Texas A&M University
+-----
+
+Benchmark of the kinematic fit: Levenberg-Marquardt ('kinfit') vs TMinuit ('minuit')
+on the same events (W->lv with MET resolution, optional VLQ mass hypothesis).
+Prints the time per fit, the converged & stalled fractions (KinematicFit::summary)
+and how often each solver finds the lower chi2.
+Fails if Levenberg-Marquardt is worse than TMinuit in more than 1% of the events.
+*/
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include "Analysis/CyMiniAna/interface/tools.h"
+#include "Analysis/CyMiniAna/interface/configuration.h"
+#include "Analysis/CyMiniAna/interface/physicsObjects.h"
+#include "Analysis/CyMiniAna/interface/kinematicFit.h"
+
+
+class benchConfiguration : public configuration {
+  public:
+    // only the options used by KinematicFit (no configuration file)
+    benchConfiguration( const float vlqMass ) : configuration("") {m_kinfitVLQMass = vlqMass;}
+};
+
+
+void generate( const unsigned int event, Lepton& lepton, MET& met, std::vector<Jet>& jets ){
+    /* W->lv (isotropic in the W rest frame), MET = neutrino pT smeared by 20 GeV, two b-jets */
+    const double wmass(80.4);
+    lepton = {};
+    met = {};
+    jets.clear();
+
+    TLorentzVector w;
+    w.SetPtEtaPhiM( 400*cma::uniform(1,event), -2.+4.*cma::uniform(2,event), -M_PI+2*M_PI*cma::uniform(3,event), wmass );
+
+    double cosTheta = -1.+2.*cma::uniform(4,event);
+    double sinTheta = std::sqrt(1.-cosTheta*cosTheta);
+    double phi = -M_PI+2*M_PI*cma::uniform(5,event);
+    double p   = 0.5*wmass;
+    TLorentzVector nu;
+    lepton.p4.SetPxPyPzE(  p*sinTheta*std::cos(phi),  p*sinTheta*std::sin(phi),  p*cosTheta, p );
+    nu.SetPxPyPzE(        -p*sinTheta*std::cos(phi), -p*sinTheta*std::sin(phi), -p*cosTheta, p );
+    lepton.p4.Boost( w.BoostVector() );
+    nu.Boost( w.BoostVector() );
+
+    double metPx = nu.Px() + 20.*cma::gaussian(6,event);
+    double metPy = nu.Py() + 20.*cma::gaussian(7,event);
+    met.p4.SetPxPyPzE( metPx, metPy, 0., std::sqrt(metPx*metPx+metPy*metPy) );
+
+    for (unsigned int j=0; j<2; j++){
+        Jet jet;
+        jet.p4.SetPtEtaPhiM( 50+400*cma::uniform(8+j,event), -2.4+4.8*cma::uniform(10+j,event), -M_PI+2*M_PI*cma::uniform(12+j,event), 5. );
+        jets.push_back( jet );
+    }
+
+    return;
+}
+
+
+int main() {
+    const unsigned int nEvents(10000);
+    unsigned int nFailures(0);
+
+    for (const auto& vlqMass : {0.f, 1000.f}){
+        benchConfiguration config( vlqMass );
+        KinematicFit lm( config );
+        KinematicFit minuit( config );
+
+        unsigned int nFits(0), nSame(0), nBetterLM(0), nBetterMinuit(0);
+        double timeLM(0.), timeMinuit(0.);
+
+        for (unsigned int event=0; event<nEvents; event++){
+            Lepton lepton;
+            MET met;
+            std::vector<Jet> jets;
+            generate( event, lepton, met, jets );
+
+            lm.setObjects( lepton, met );
+            lm.setJets( jets );
+            auto start = std::chrono::steady_clock::now();
+            lm.execute( false );
+            timeLM += std::chrono::duration<double,std::micro>( std::chrono::steady_clock::now()-start ).count();
+
+            minuit.setObjects( lepton, met );
+            minuit.setJets( jets );
+            start = std::chrono::steady_clock::now();
+            minuit.execute( true );
+            timeMinuit += std::chrono::duration<double,std::micro>( std::chrono::steady_clock::now()-start ).count();
+
+            double tolerance = 1e-4*(1.+minuit.chi2());
+            if (lm.chi2() < minuit.chi2()-tolerance)      nBetterLM++;
+            else if (minuit.chi2() < lm.chi2()-tolerance) nBetterMinuit++;
+            else nSame++;
+            nFits++;
+        }
+
+        std::cout << " testKinematicFit : VLQ mass " << vlqMass << ", " << nFits << " events" << std::endl;
+        std::cout << "   Levenberg-Marquardt " << timeLM/nFits << " us per event" << std::endl;
+        std::cout << "   TMinuit             " << timeMinuit/nFits << " us per event (x" << timeMinuit/timeLM << ")" << std::endl;
+        std::cout << "   same chi2 " << nSame << ", lower chi2: Levenberg-Marquardt " << nBetterLM
+                  << ", TMinuit " << nBetterMinuit << std::endl;
+        lm.summary();
+        minuit.summary();
+
+        if (nBetterMinuit > 0.01*nFits) nFailures++;
+    }
+
+    std::cout << " testKinematicFit : " << (nFailures>0 ? "FAILED" : "passed") << std::endl;
+
+    return (nFailures>0) ? 1 : 0;
+}
+
+// THE END